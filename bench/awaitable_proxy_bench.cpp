@@ -0,0 +1,221 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// compares the per-request overhead of `foxy::proxy`, whose relay is a hand-written callback state
+// machine, with `foxy::forward_requests`, the coroutine loop built on the awaitable overloads
+//
+// a single client sends `num_requests` absolute-form GETs over one persistent connection through
+// each proxy to a loopback origin that answers with a small body, so the upstream connection stays
+// warm and the numbers are dominated by what each proxy does per request
+//
+// every socket along the way has Nagle's algorithm turned off, the proxies do that to their own
+// sockets and the bench to the origin's and the client's, otherwise a message written in more than
+// one piece stalls on a delayed ACK and that's all the numbers would show
+//
+
+#include <foxy/awaitable.hpp>
+
+#include <iostream>
+
+#ifdef FOXY_HAS_CO_AWAIT
+
+#include <foxy/proxy.hpp>
+#include <foxy/server_session.hpp>
+#include <foxy/forward_requests.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <thread>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+namespace
+{
+auto
+loopback() -> tcp::endpoint
+{
+  return tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0);
+}
+
+auto
+serve_origin(std::shared_ptr<foxy::server_session> origin) -> foxy::awaitable<void>
+{
+  while (true) {
+    auto ec     = boost::system::error_code();
+    auto parser = http::request_parser<http::empty_body>();
+
+    try {
+      co_await origin->async_read(parser);
+    }
+    catch (boost::system::system_error const& e) {
+      ec = e.code();
+    }
+
+    if (ec) { co_return; }
+
+    auto res   = http::response<http::string_body>(http::status::ok, 11);
+    res.body() = "hello, world!";
+    res.prepare_payload();
+
+    co_await origin->async_write(res);
+  }
+}
+
+auto
+accept_origins(asio::io_context& io, tcp::acceptor& acceptor) -> foxy::awaitable<void>
+{
+  while (true) {
+    auto origin = std::make_shared<foxy::server_session>(foxy::multi_stream(io));
+    co_await acceptor.async_accept(origin->stream.plain(), asio::use_awaitable);
+    origin->stream.plain().set_option(tcp::no_delay(true));
+    asio::co_spawn(io, serve_origin(std::move(origin)), asio::detached);
+  }
+}
+
+auto
+accept_clients(asio::io_context& io, tcp::acceptor& acceptor) -> foxy::awaitable<void>
+{
+  while (true) {
+    auto server = std::make_shared<foxy::server_session>(foxy::multi_stream(io));
+    co_await acceptor.async_accept(server->stream.plain(), asio::use_awaitable);
+    server->stream.plain().set_option(tcp::no_delay(true));
+
+    asio::co_spawn(
+      io,
+      [server]() -> foxy::awaitable<void> {
+        auto const client_opts = foxy::session_opts();
+        co_await foxy::forward_requests(*server, client_opts);
+      },
+      asio::detached);
+  }
+}
+
+// send_requests is the blocking client, it runs on a thread of its own and reports the average time
+// a request took
+//
+auto
+send_requests(tcp::endpoint const proxy,
+              tcp::endpoint const origin,
+              std::size_t const   num_requests) -> double
+{
+  asio::io_context io;
+
+  auto socket = tcp::socket(io);
+  socket.connect(proxy);
+  socket.set_option(tcp::no_delay(true));
+
+  auto const target = "http://127.0.0.1:" + std::to_string(origin.port()) + "/";
+
+  auto req = http::request<http::empty_body>(http::verb::get, target, 11);
+  req.set(http::field::host, "127.0.0.1");
+
+  auto buffer = boost::beast::flat_buffer();
+
+  auto const start = std::chrono::steady_clock::now();
+  for (std::size_t idx = 0; idx < num_requests; ++idx) {
+    http::write(socket, req);
+
+    auto res = http::response<http::string_body>();
+    http::read(socket, buffer, res);
+  }
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+
+  auto ec = boost::system::error_code();
+  socket.shutdown(tcp::socket::shutdown_both, ec);
+
+  return std::chrono::duration<double, std::micro>(elapsed).count() / num_requests;
+}
+
+template <class StartProxy>
+auto
+run(std::size_t const num_requests, StartProxy start_proxy) -> double
+{
+  asio::io_context io(1);
+
+  auto origin_acceptor = tcp::acceptor(io, loopback());
+  asio::co_spawn(io, accept_origins(io, origin_acceptor), asio::detached);
+
+  // either proxy is only good for as long as the io_context it was started on
+  //
+  auto const proxy = start_proxy(io);
+
+  auto work = asio::make_work_guard(io);
+  auto ioth = std::thread([&] { io.run(); });
+
+  auto const us =
+    send_requests(proxy->local_endpoint(), origin_acceptor.local_endpoint(), num_requests);
+
+  work.reset();
+  io.stop();
+  ioth.join();
+
+  return us;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const num_requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500ul;
+
+  auto const start_callback_proxy = [](asio::io_context& io) {
+    auto proxy = std::make_shared<foxy::proxy>(io, loopback());
+    proxy->async_accept();
+    return proxy;
+  };
+
+  auto const start_coro_proxy = [](asio::io_context& io) {
+    auto acceptor = std::make_unique<tcp::acceptor>(io, loopback());
+    asio::co_spawn(io, accept_clients(io, *acceptor), asio::detached);
+    return acceptor;
+  };
+
+  std::cout << "proxy                us/request\n";
+
+  // the first run only warms up the loopback interface and the allocator
+  //
+  run(num_requests / 10, start_callback_proxy);
+
+  auto const report = [](char const* name, double const us) {
+    std::cout << std::left << std::setw(21) << name << us << "\n";
+  };
+
+  report("callback relay", run(num_requests, start_callback_proxy));
+  report("coroutine loop", run(num_requests, start_coro_proxy));
+
+  return 0;
+}
+
+#else
+
+int
+main()
+{
+  std::cout << "this benchmark needs C++20 coroutines and Boost 1.70 or newer\n";
+  return 0;
+}
+
+#endif // FOXY_HAS_CO_AWAIT
@@ -0,0 +1,260 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// compares `foxy::detail::export_connect_fields` with the version it replaced, which copied every
+// Connection option into a vector of strings and searched the hop-by-hop fields linearly
+//
+// Every header set is copied once per call up front so only the export itself is timed. Each
+// field that's moved costs an allocation in `dst` either way, the allocations/call column is what
+// an implementation needs on top of those.
+//
+
+#include <foxy/detail/export_connect_fields.hpp>
+
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/fields.hpp>
+#include <boost/beast/http/rfc7230.hpp>
+
+#include <boost/range/algorithm.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+bool is_counted = false;
+
+std::size_t num_allocations = 0;
+
+} // namespace
+
+void*
+operator new(std::size_t size)
+{
+  if (is_counted) { ++num_allocations; }
+  if (auto* const p = std::malloc(size > 0 ? size : 1)) { return p; }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace http  = boost::beast::http;
+namespace range = boost::range;
+
+namespace
+{
+// previous_export_connect_fields is the implementation as it was before it stopped allocating
+//
+template <class Allocator>
+void
+previous_export_connect_fields(http::basic_fields<Allocator>& src,
+                               http::basic_fields<Allocator>& dst)
+{
+  using string_type =
+    std::basic_string<char, std::char_traits<char>,
+                      typename std::allocator_traits<Allocator>::template rebind_alloc<char>>;
+
+  auto connect_opts =
+    std::vector<string_type,
+                typename std::allocator_traits<Allocator>::template rebind_alloc<string_type>>(
+      src.get_allocator());
+
+  connect_opts.reserve(128);
+
+  auto const connect_fields = src.equal_range(http::field::connection);
+  auto       out            = std::back_inserter(connect_opts);
+
+  range::for_each(connect_fields, [&src, out](auto const& connect_field) {
+    range::transform(
+      http::token_list(connect_field.value()), out, [&src](auto const token_view) -> string_type {
+        return string_type(token_view.begin(), token_view.end(), src.get_allocator());
+      });
+  });
+
+  range::sort(connect_opts);
+  range::unique(connect_opts);
+
+  auto const hop_by_hops = std::array<http::field, 11>{http::field::connection,
+                                                       http::field::keep_alive,
+                                                       http::field::proxy_authenticate,
+                                                       http::field::proxy_authentication_info,
+                                                       http::field::proxy_authorization,
+                                                       http::field::proxy_connection,
+                                                       http::field::proxy_features,
+                                                       http::field::proxy_instruction,
+                                                       http::field::te,
+                                                       http::field::trailer,
+                                                       http::field::transfer_encoding};
+
+  auto const is_connect_opt =
+    [&connect_opts,
+     &hop_by_hops](typename http::basic_fields<Allocator>::value_type const& field) -> bool {
+    if (range::find(hop_by_hops, field.name()) != hop_by_hops.end()) { return true; }
+
+    for (auto const opt : connect_opts) {
+      if (field.name_string() == opt) { return true; }
+    }
+    return false;
+  };
+
+  for (auto it = src.begin(); it != src.end();) {
+    auto const& field = *it;
+
+    if (!is_connect_opt(field)) {
+      ++it;
+      continue;
+    }
+
+    dst.insert(field.name_string(), field.value());
+    it = src.erase(it);
+  }
+}
+
+auto
+browser_request() -> http::fields
+{
+  auto fields = http::fields();
+  fields.set(http::field::host, "www.example.com");
+  fields.set(http::field::user_agent,
+             "Mozilla/5.0 (X11; Linux x86_64; rv:66.0) Gecko/20100101 Firefox/66.0");
+  fields.set(http::field::accept,
+             "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+  fields.set(http::field::accept_language, "en-US,en;q=0.5");
+  fields.set(http::field::accept_encoding, "gzip, deflate, br");
+  fields.set(http::field::referer, "https://www.example.com/index.html");
+  fields.set(http::field::cookie, "session=0123456789abcdef; theme=dark; tracking=opt-out");
+  fields.set("DNT", "1");
+  fields.set("Upgrade-Insecure-Requests", "1");
+  fields.set(http::field::cache_control, "max-age=0");
+  fields.set(http::field::proxy_connection, "keep-alive");
+  fields.set(http::field::connection, "keep-alive");
+  return fields;
+}
+
+auto
+origin_response() -> http::fields
+{
+  auto fields = http::fields();
+  fields.set(http::field::date, "Tue, 02 Apr 2019 18:42:12 GMT");
+  fields.set(http::field::server, "nginx/1.14.0");
+  fields.set(http::field::content_type, "text/html; charset=utf-8");
+  fields.set(http::field::transfer_encoding, "chunked");
+  fields.set(http::field::connection, "keep-alive");
+  fields.set(http::field::keep_alive, "timeout=5, max=100");
+  fields.set(http::field::vary, "Accept-Encoding");
+  fields.set(http::field::cache_control, "private, max-age=0");
+  fields.set(http::field::etag, "W/\"5c9f8a3c-1d2a\"");
+  fields.set(http::field::content_encoding, "gzip");
+  fields.set("X-Frame-Options", "SAMEORIGIN");
+  fields.set("Strict-Transport-Security", "max-age=31536000");
+  return fields;
+}
+
+// connection_options names a handful of extension headers as hop-by-hop, the way tracing and
+// upgrade-capable clients do
+//
+auto
+connection_options() -> http::fields
+{
+  auto fields = browser_request();
+  fields.set(http::field::connection, "keep-alive, Upgrade, HTTP2-Settings, X-Trace, X-Span");
+  fields.set(http::field::te, "trailers");
+  fields.set(http::field::upgrade, "h2c");
+  fields.set("HTTP2-Settings", "AAMAAABkAARAAAAAAAIAAAAA");
+  fields.set("X-Trace", "a1b2c3d4e5f6");
+  fields.set("X-Span", "0042");
+  return fields;
+}
+
+struct result
+{
+  double ns;
+  double allocations;
+};
+
+template <class Export>
+auto
+run(http::fields const& proto, std::size_t const num_calls, Export export_fields) -> result
+{
+  auto srcs = std::vector<http::fields>(num_calls, proto);
+  auto dsts = std::vector<http::fields>(num_calls);
+
+  auto const start_allocations = num_allocations;
+  auto const start             = std::chrono::steady_clock::now();
+
+  is_counted = true;
+  for (std::size_t idx = 0; idx < num_calls; ++idx) { export_fields(srcs[idx], dsts[idx]); }
+  is_counted = false;
+
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+
+  // each moved field is an allocation in `dst` no matter the implementation
+  //
+  auto const num_moved = static_cast<std::size_t>(std::distance(dsts[0].begin(), dsts[0].end()));
+
+  return {std::chrono::duration<double, std::nano>(elapsed).count() / num_calls,
+          static_cast<double>(num_allocations - start_allocations - num_moved * num_calls) /
+            num_calls};
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const num_calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000ul;
+
+  auto const current = [](http::fields& src, http::fields& dst) {
+    foxy::detail::export_connect_fields(src, dst);
+  };
+
+  auto const previous = [](http::fields& src, http::fields& dst) {
+    previous_export_connect_fields(src, dst);
+  };
+
+  std::cout << "headers              implementation  ns/call     allocations/call\n";
+
+  auto const report = [](char const* name, char const* impl, result const r) {
+    std::cout << std::left << std::setw(21) << name << std::setw(16) << impl << std::setw(12)
+              << r.ns << r.allocations << "\n";
+  };
+
+  auto const sets = {std::make_pair("browser request", browser_request()),
+                     std::make_pair("origin response", origin_response()),
+                     std::make_pair("connection options", connection_options())};
+
+  for (auto const& set : sets) {
+    // the first run only warms up the allocator
+    //
+    run(set.second, num_calls / 10, current);
+
+    report(set.first, "previous", run(set.second, num_calls, previous));
+    report(set.first, "current", run(set.second, num_calls, current));
+  }
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// compares the x3 parse Via loop detection used to run with `foxy::detail::icontains` over Via
+// values of growing length, none of which contain our entry so every value is scanned in full
+//
+// the long values are what a response looks like after a few CDN and caching hops
+//
+
+#include <foxy/detail/has_token.hpp>
+
+#include <boost/spirit/home/x3.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace x3 = boost::spirit::x3;
+
+namespace
+{
+auto
+x3_contains(boost::string_view const value) -> bool
+{
+  auto       begin = value.begin();
+  auto const end   = value.end();
+
+  return x3::parse(begin, end,
+                   x3::no_case[*(x3::char_ - "1.1 foxy") >> x3::lit("1.1 foxy") >> *x3::char_]);
+}
+
+auto
+via_value(std::size_t const num_hops) -> std::string
+{
+  auto const hops = {"1.1 varnish (Varnish/6.0)", "1.1 b2c4d.cloudfront.net (CloudFront)",
+                     "1.1 google", "1.1 Fastly-cache-ams21"};
+
+  auto value = std::string();
+  for (std::size_t idx = 0; idx < num_hops; ++idx) {
+    if (!value.empty()) { value += ", "; }
+    value += *(hops.begin() + idx % hops.size());
+  }
+  return value;
+}
+
+template <class Contains>
+auto
+run(std::string const& value, std::size_t const num_calls, Contains contains) -> double
+{
+  auto num_found = std::size_t{0};
+
+  // reading the value's address through a volatile keeps the search from being hoisted out of the
+  // loop
+  //
+  char const* volatile data = value.data();
+
+  auto const start = std::chrono::steady_clock::now();
+  for (std::size_t idx = 0; idx < num_calls; ++idx) {
+    num_found += contains(boost::string_view(data, value.size())) ? 1 : 0;
+  }
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+
+  if (num_found != 0) { std::cerr << "unexpected match\n"; }
+
+  return std::chrono::duration<double, std::nano>(elapsed).count() / num_calls;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const num_calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000ul;
+
+  auto const icontains = [](boost::string_view const value) {
+    return foxy::detail::icontains(value, "1.1 foxy");
+  };
+
+  std::cout << "hops  bytes  x3 ns/value  icontains ns/value\n";
+
+  for (std::size_t const num_hops : {1, 2, 4, 8, 16}) {
+    auto const value = via_value(num_hops);
+
+    std::cout << std::left << std::setw(6) << num_hops << std::setw(7) << value.size()
+              << std::setw(13) << run(value, num_calls, x3_contains)
+              << run(value, num_calls, icontains) << "\n";
+  }
+
+  return 0;
+}
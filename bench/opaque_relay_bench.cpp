@@ -0,0 +1,198 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// compares the download throughput of the opaque byte-pump used for TLS CONNECT tunnels, both with
+// zero-copy forwarding (where available) and when forced through user-space buffers, against the
+// HTTP-aware duplex relay that such a tunnel used to go through
+//
+// both relays sit between two loopback TCP connections; the upstream pushes `size` bytes through
+// the proxy side and the downstream client drains them. The HTTP relay has to parse and
+// re-serialize a response with a body of the same size, which is why the payloads stay below the
+// parser's default body limit of 8 MiB.
+//
+
+#include <foxy/session.hpp>
+#include <foxy/detail/duplex_relay.hpp>
+#include <foxy/detail/opaque_relay.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+struct tunnel
+{
+  asio::io_context io;
+
+  foxy::basic_session<tcp::socket> server;
+  foxy::basic_session<tcp::socket> client;
+
+  tcp::socket downstream;
+  tcp::socket upstream;
+
+  tunnel()
+    : server(io)
+    , client(io)
+    , downstream(io)
+    , upstream(io)
+  {
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    downstream.connect(acceptor.local_endpoint());
+    acceptor.accept(server.stream.plain());
+
+    client.stream.plain().connect(acceptor.local_endpoint());
+    acceptor.accept(upstream);
+
+    server.opts.timeout = 30s;
+    client.opts.timeout = 30s;
+  }
+};
+
+auto
+opaque_pump(std::string const& payload, bool const zero_copy)
+  -> std::chrono::steady_clock::duration
+{
+  tunnel t;
+
+  asio::spawn(t.io, [&](asio::yield_context yield) {
+    if (zero_copy) {
+      foxy::detail::async_opaque_relay(t.server, t.client, yield);
+    } else {
+      foxy::detail::async_copy_relay(t.server, t.client, yield);
+    }
+  });
+
+  asio::spawn(t.io, [&](asio::yield_context yield) {
+    t.downstream.shutdown(tcp::socket::shutdown_send);
+
+    auto ec   = boost::system::error_code();
+    auto sink = std::array<char, 64 * 1024>();
+    while (!ec) { t.downstream.async_read_some(asio::buffer(sink), yield[ec]); }
+  });
+
+  asio::spawn(t.io, [&](asio::yield_context yield) {
+    auto ec   = boost::system::error_code();
+    auto sink = std::array<char, 1>();
+    asio::async_read(t.upstream, asio::buffer(sink), yield[ec]);
+
+    asio::async_write(t.upstream, asio::buffer(payload), yield);
+    t.upstream.shutdown(tcp::socket::shutdown_send);
+  });
+
+  auto const start = std::chrono::steady_clock::now();
+  t.io.run();
+  return std::chrono::steady_clock::now() - start;
+}
+
+auto
+http_relay(std::string const& payload) -> std::chrono::steady_clock::duration
+{
+  tunnel t;
+
+  asio::spawn(t.io, [&](asio::yield_context yield) {
+    foxy::detail::async_duplex_relay(t.server, t.client, yield);
+  });
+
+  asio::spawn(t.io, [&](asio::yield_context yield) {
+    auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+    http::async_write(t.downstream, request, yield);
+
+    auto buffer = boost::beast::flat_buffer();
+    auto sink   = std::array<char, 64 * 1024>();
+
+    http::response_parser<http::buffer_body> parser;
+    parser.body_limit(payload.size());
+
+    http::async_read_header(t.downstream, buffer, parser, yield);
+
+    while (!parser.is_done()) {
+      parser.get().body().data = sink.data();
+      parser.get().body().size = sink.size();
+
+      auto ec = boost::system::error_code();
+      http::async_read(t.downstream, buffer, parser, yield[ec]);
+      if (ec && ec != http::error::need_buffer) { throw boost::system::system_error(ec); }
+    }
+  });
+
+  asio::spawn(t.io, [&](asio::yield_context yield) {
+    auto buffer  = boost::beast::flat_buffer();
+    auto request = http::request<http::empty_body>();
+    http::async_read(t.upstream, buffer, request, yield);
+
+    auto response = http::response<http::string_body>(http::status::ok, 11, payload);
+    response.prepare_payload();
+
+    http::async_write(t.upstream, response, yield);
+  });
+
+  auto const start = std::chrono::steady_clock::now();
+  t.io.run();
+  return std::chrono::steady_clock::now() - start;
+}
+
+auto
+mib_per_sec(std::size_t const size, std::chrono::steady_clock::duration const elapsed) -> double
+{
+  auto const secs = std::chrono::duration<double>(elapsed).count();
+  return static_cast<double>(size) / (1024.0 * 1024.0) / secs;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const num_iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5ul;
+
+  std::cout << "payload (MiB)    opaque (MiB/s)    copy (MiB/s)    http relay (MiB/s)\n";
+
+  for (auto const mib : {1, 2, 4}) {
+    auto const payload = std::string(mib * 1024 * 1024, 'x');
+
+    auto opaque = std::chrono::steady_clock::duration::zero();
+    auto copy   = std::chrono::steady_clock::duration::zero();
+    auto relay  = std::chrono::steady_clock::duration::zero();
+
+    for (std::size_t idx = 0; idx < num_iterations; ++idx) {
+      opaque += opaque_pump(payload, true);
+      copy += opaque_pump(payload, false);
+      relay += http_relay(payload);
+    }
+
+    auto const total = payload.size() * num_iterations;
+
+    std::cout << mib << "                " << mib_per_sec(total, opaque) << "           "
+              << mib_per_sec(total, copy) << "         " << mib_per_sec(total, relay) << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// counts the heap allocations `foxy::proxy` makes per request it relays
+//
+// A client sends absolute-form GETs over one persistent connection through the proxy to a loopback
+// origin, once with a minimal set of headers and once with the kind of header block a browser
+// sends, hop-by-hop headers included. Only the allocations made on the proxy's thread are counted
+// and only once the connection is warm, the client and the origin run on threads of their own.
+//
+
+#include <foxy/proxy.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+namespace
+{
+thread_local bool is_counted = false;
+
+std::atomic<std::size_t> num_allocations{0};
+
+} // namespace
+
+void*
+operator new(std::size_t size)
+{
+  if (is_counted) { ++num_allocations; }
+  if (auto* const p = std::malloc(size > 0 ? size : 1)) { return p; }
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+namespace
+{
+auto
+loopback() -> tcp::endpoint
+{
+  return tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0);
+}
+
+// serve_origin answers exactly `num_requests` requests, the proxy keeps its upstream connection
+// pooled so the origin can't wait for it to be closed
+//
+auto
+serve_origin(asio::io_context& io, tcp::acceptor& acceptor, std::size_t const num_requests) -> void
+{
+  auto socket = tcp::socket(io);
+  acceptor.accept(socket);
+  socket.set_option(tcp::no_delay(true));
+
+  auto buffer = boost::beast::flat_buffer();
+  for (std::size_t idx = 0; idx < num_requests; ++idx) {
+    auto ec  = boost::system::error_code();
+    auto req = http::request<http::empty_body>();
+
+    http::read(socket, buffer, req, ec);
+    if (ec) { return; }
+
+    auto res = http::response<http::string_body>(http::status::ok, 11);
+    res.set(http::field::content_type, "text/plain");
+    res.set(http::field::cache_control, "no-cache");
+    res.set(http::field::keep_alive, "timeout=5");
+    res.body() = "hello, world!";
+    res.prepare_payload();
+
+    http::write(socket, res, ec);
+    if (ec) { return; }
+  }
+}
+
+auto
+browser_request(std::string const& target) -> http::request<http::empty_body>
+{
+  auto req = http::request<http::empty_body>(http::verb::get, target, 11);
+  req.set(http::field::host, "127.0.0.1");
+  req.set(http::field::user_agent,
+          "Mozilla/5.0 (X11; Linux x86_64; rv:66.0) Gecko/20100101 Firefox/66.0");
+  req.set(http::field::accept, "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+  req.set(http::field::accept_language, "en-US,en;q=0.5");
+  req.set(http::field::accept_encoding, "gzip, deflate");
+  req.set(http::field::referer, "http://127.0.0.1/index.html");
+  req.set(http::field::cookie, "session=0123456789abcdef; theme=dark; tracking=opt-out");
+  req.set("DNT", "1");
+  req.set("Upgrade-Insecure-Requests", "1");
+  req.set(http::field::cache_control, "max-age=0");
+  req.set(http::field::proxy_connection, "keep-alive");
+  req.set(http::field::connection, "keep-alive, x-trace");
+  req.set("X-Trace", "a1b2c3d4");
+  req.set("X-Requested-With", "XMLHttpRequest");
+  return req;
+}
+
+auto
+run(std::size_t const num_requests, bool const is_header_heavy) -> double
+{
+  // the first few requests fill the proxy's caches and connect it to the origin
+  //
+  auto const num_warmups = std::size_t{16};
+
+  asio::io_context io(1);
+
+  auto proxy = std::make_shared<foxy::proxy>(io, loopback());
+  proxy->async_accept();
+
+  asio::io_context origin_io;
+
+  auto origin_acceptor = tcp::acceptor(origin_io, loopback());
+  auto origin          = std::thread(
+    [&] { serve_origin(origin_io, origin_acceptor, num_warmups + num_requests); });
+
+  auto ioth = std::thread([&] {
+    is_counted = true;
+    io.run();
+    is_counted = false;
+  });
+
+  asio::io_context client_io;
+
+  auto socket = tcp::socket(client_io);
+  socket.connect(proxy->local_endpoint());
+  socket.set_option(tcp::no_delay(true));
+
+  auto const target =
+    "http://127.0.0.1:" + std::to_string(origin_acceptor.local_endpoint().port()) + "/";
+
+  auto req = http::request<http::empty_body>(http::verb::get, target, 11);
+  if (is_header_heavy) {
+    req = browser_request(target);
+  } else {
+    req.set(http::field::host, "127.0.0.1");
+  }
+
+  auto buffer = boost::beast::flat_buffer();
+
+  auto const send = [&] {
+    http::write(socket, req);
+
+    auto res = http::response<http::string_body>();
+    http::read(socket, buffer, res);
+  };
+
+  for (std::size_t idx = 0; idx < num_warmups; ++idx) { send(); }
+
+  auto const start = num_allocations.load();
+  for (std::size_t idx = 0; idx < num_requests; ++idx) { send(); }
+  auto const count = num_allocations.load() - start;
+
+  auto ec = boost::system::error_code();
+  socket.shutdown(tcp::socket::shutdown_both, ec);
+  socket.close(ec);
+
+  origin.join();
+
+  proxy->cancel(ec);
+  io.stop();
+  ioth.join();
+
+  return static_cast<double>(count) / num_requests;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const num_requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100ul;
+
+  std::cout << "headers              allocations/request\n";
+
+  auto const report = [](char const* name, double const count) {
+    std::cout << std::left << std::setw(21) << name << count << std::endl;
+  };
+
+  report("minimal", run(num_requests, false));
+  report("browser-like", run(num_requests, true));
+
+  return 0;
+}
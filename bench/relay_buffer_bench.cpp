@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// measures the download throughput of the HTTP relay for a range of `relay_opts`
+//
+// an upstream serves a response of `size` bytes over loopback, the relay forwards it and the
+// downstream client drains it. Fixed buffer sizes are compared against the adaptive mode that
+// starts at 2 KiB and grows toward 256 KiB.
+//
+
+#include <foxy/session.hpp>
+#include <foxy/detail/duplex_relay.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+relay(std::string const& payload, foxy::relay_opts const relay_opts)
+  -> std::chrono::steady_clock::duration
+{
+  asio::io_context io;
+
+  auto opts    = foxy::session_opts();
+  opts.timeout = 30s;
+  opts.relay   = relay_opts;
+
+  auto server = foxy::basic_session<tcp::socket>(io, opts);
+  auto client = foxy::basic_session<tcp::socket>(io, opts);
+
+  auto downstream = tcp::socket(io);
+  auto upstream   = tcp::socket(io);
+
+  auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+  downstream.connect(acceptor.local_endpoint());
+  acceptor.accept(server.stream.plain());
+
+  client.stream.plain().connect(acceptor.local_endpoint());
+  acceptor.accept(upstream);
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    foxy::detail::async_duplex_relay(server, client, yield);
+  });
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+    http::async_write(downstream, request, yield);
+
+    auto buffer = boost::beast::flat_buffer();
+    auto sink   = std::array<char, 64 * 1024>();
+
+    http::response_parser<http::buffer_body> parser;
+    parser.body_limit(payload.size());
+
+    http::async_read_header(downstream, buffer, parser, yield);
+
+    while (!parser.is_done()) {
+      parser.get().body().data = sink.data();
+      parser.get().body().size = sink.size();
+
+      auto ec = boost::system::error_code();
+      http::async_read(downstream, buffer, parser, yield[ec]);
+      if (ec && ec != http::error::need_buffer) { throw boost::system::system_error(ec); }
+    }
+  });
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    auto buffer  = boost::beast::flat_buffer();
+    auto request = http::request<http::empty_body>();
+    http::async_read(upstream, buffer, request, yield);
+
+    auto response = http::response<http::string_body>(http::status::ok, 11, payload);
+    response.prepare_payload();
+
+    http::async_write(upstream, response, yield);
+  });
+
+  auto const start = std::chrono::steady_clock::now();
+  io.run();
+  return std::chrono::steady_clock::now() - start;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const num_iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5ul;
+
+  auto const payload = std::string(4 * 1024 * 1024, 'x');
+
+  auto const configs = {
+    foxy::relay_opts{2 * 1024, 2 * 1024},     foxy::relay_opts{16 * 1024, 16 * 1024},
+    foxy::relay_opts{64 * 1024, 64 * 1024},   foxy::relay_opts{256 * 1024, 256 * 1024},
+    foxy::relay_opts{2 * 1024, 256 * 1024},
+  };
+
+  std::cout << "buffer (KiB)    max (KiB)    MiB/s\n";
+
+  for (auto const& opts : configs) {
+    auto elapsed = std::chrono::steady_clock::duration::zero();
+    for (std::size_t idx = 0; idx < num_iterations; ++idx) { elapsed += relay(payload, opts); }
+
+    auto const secs  = std::chrono::duration<double>(elapsed).count();
+    auto const total = static_cast<double>(payload.size() * num_iterations);
+    auto const rate  = total / (1024.0 * 1024.0) / secs;
+
+    std::cout << std::left << std::setw(16) << opts.buffer_size / 1024 << std::setw(13)
+              << opts.max_buffer_size / 1024 << rate << "\n";
+  }
+
+  return 0;
+}
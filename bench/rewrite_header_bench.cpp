@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// measures what rewriting a header costs the relay per message, once as the chain of separate
+// passes it used to run (Via check, keep-alive and chunked lookups, hop-by-hop export, Connection
+// and Transfer-Encoding rewrite, Via append) and once as `foxy::detail::rewrite_header`
+//
+// the messages are copied up front so only the rewrite itself is timed
+//
+
+#include <foxy/detail/rewrite_header.hpp>
+#include <foxy/detail/has_token.hpp>
+#include <foxy/detail/export_connect_fields.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace http = boost::beast::http;
+
+namespace
+{
+template <bool isRequest>
+auto
+rewrite_in_passes(http::message<isRequest, http::empty_body>& msg,
+                  http::fields&                               hop_by_hops,
+                  bool                                        close) -> bool
+{
+  close                 = close || !msg.keep_alive();
+  auto const is_chunked = msg.chunked();
+
+  if (foxy::detail::has_foxy_via(msg, "1.1 foxy")) { return false; }
+
+  foxy::detail::export_connect_fields(msg, hop_by_hops);
+
+  if (close) { msg.keep_alive(false); }
+  if (is_chunked) { msg.chunked(true); }
+
+  msg.insert(http::field::via, "1.1 foxy");
+  return true;
+}
+
+auto
+browser_request() -> http::request<http::empty_body>
+{
+  auto req = http::request<http::empty_body>(http::verb::get, "/index.html", 11);
+  req.set(http::field::host, "www.example.com");
+  req.set(http::field::user_agent,
+          "Mozilla/5.0 (X11; Linux x86_64; rv:66.0) Gecko/20100101 Firefox/66.0");
+  req.set(http::field::accept, "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+  req.set(http::field::accept_language, "en-US,en;q=0.5");
+  req.set(http::field::accept_encoding, "gzip, deflate, br");
+  req.set(http::field::referer, "https://www.example.com/");
+  req.set(http::field::cookie, "session=0123456789abcdef; theme=dark; tracking=opt-out");
+  req.set("DNT", "1");
+  req.set("Upgrade-Insecure-Requests", "1");
+  req.set(http::field::cache_control, "max-age=0");
+  req.set(http::field::proxy_connection, "keep-alive");
+  req.set(http::field::connection, "keep-alive");
+  return req;
+}
+
+// chained_response has already been through another proxy and names an extension header as
+// hop-by-hop
+//
+auto
+chained_response() -> http::response<http::empty_body>
+{
+  auto res = http::response<http::empty_body>(http::status::ok, 11);
+  res.set(http::field::date, "Tue, 02 Apr 2019 18:42:12 GMT");
+  res.set(http::field::server, "nginx/1.14.0");
+  res.set(http::field::content_type, "text/html; charset=utf-8");
+  res.set(http::field::transfer_encoding, "chunked");
+  res.set(http::field::connection, "keep-alive, X-Cache-Trace");
+  res.set(http::field::keep_alive, "timeout=5, max=100");
+  res.set(http::field::vary, "Accept-Encoding");
+  res.set(http::field::cache_control, "private, max-age=0");
+  res.set(http::field::etag, "W/\"5c9f8a3c-1d2a\"");
+  res.set(http::field::content_encoding, "gzip");
+  res.set(http::field::via, "1.1 varnish (Varnish/6.0)");
+  res.set("X-Cache-Trace", "MISS, HIT");
+  res.set("Strict-Transport-Security", "max-age=31536000");
+  return res;
+}
+
+// run reports the best of a few rounds, most of the time goes to the allocator so a single round
+// is at the mercy of whatever state the heap happens to be in
+//
+template <class Message, class Rewrite>
+auto
+run(Message const& proto, std::size_t const num_messages, Rewrite rewrite) -> double
+{
+  auto best = std::numeric_limits<double>::max();
+
+  for (int round = 0; round < 5; ++round) {
+    auto msgs = std::vector<Message>(num_messages, proto);
+    auto hops = std::vector<http::fields>(num_messages);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (std::size_t idx = 0; idx < num_messages; ++idx) { rewrite(msgs[idx], hops[idx]); }
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+
+    best = std::min(best, std::chrono::duration<double, std::nano>(elapsed).count() / num_messages);
+  }
+  return best;
+}
+
+template <class Message>
+auto
+compare(char const* name, Message const& proto, std::size_t const num_messages) -> void
+{
+  auto const passes = [](Message& msg, http::fields& hops) {
+    rewrite_in_passes(msg, hops, false);
+  };
+
+  auto const single = [](Message& msg, http::fields& hops) {
+    foxy::detail::rewrite_header(msg, hops, false, "1.1 foxy");
+  };
+
+  std::cout << std::left << std::setw(21) << name << std::setw(16) << "passes"
+            << run(proto, num_messages, passes) << "\n";
+
+  std::cout << std::left << std::setw(21) << name << std::setw(16) << "single walk"
+            << run(proto, num_messages, single) << "\n";
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const num_messages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000ul;
+
+  std::cout << "message              rewrite         ns/message\n";
+
+  compare("browser request", browser_request(), num_messages);
+  compare("chained response", chained_response(), num_messages);
+
+  return 0;
+}
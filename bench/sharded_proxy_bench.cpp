@@ -0,0 +1,120 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// measures how many connections per second a `foxy::sharded_proxy` can accept, answer and tear
+// down as the number of shards grows from 1 to the number of hardware threads
+//
+// every connection sends a request the proxy rejects outright so that no upstream is involved and
+// the numbers reflect the accept/parse/respond/shutdown path alone
+//
+
+#include <foxy/sharded_proxy.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+namespace
+{
+auto
+run_clients(tcp::endpoint const             endpoint,
+            std::size_t const               num_clients,
+            std::chrono::milliseconds const duration) -> std::size_t
+{
+  auto is_done         = std::atomic<bool>{false};
+  auto num_connections = std::atomic<std::size_t>{0};
+
+  auto clients = std::vector<std::thread>();
+  clients.reserve(num_clients);
+
+  for (std::size_t idx = 0; idx < num_clients; ++idx) {
+    clients.emplace_back([&] {
+      asio::io_context io;
+
+      auto request = http::request<http::empty_body>(http::verb::get, "not-a-uri", 11);
+      request.keep_alive(false);
+
+      while (!is_done) {
+        auto ec     = boost::system::error_code();
+        auto socket = tcp::socket(io);
+
+        socket.connect(endpoint, ec);
+        if (ec) { continue; }
+
+        http::write(socket, request, ec);
+        if (ec) { continue; }
+
+        auto buffer   = boost::beast::flat_buffer();
+        auto response = http::response<http::string_body>();
+        http::read(socket, buffer, response, ec);
+        if (ec) { continue; }
+
+        socket.shutdown(tcp::socket::shutdown_both, ec);
+        socket.close(ec);
+
+        ++num_connections;
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(duration);
+  is_done = true;
+
+  for (auto& client : clients) { client.join(); }
+
+  return num_connections;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const max_shards = std::max(std::thread::hardware_concurrency(), 1u);
+  auto const duration =
+    std::chrono::milliseconds(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000);
+
+  std::cout << "shards    conns/sec\n";
+
+  for (std::size_t num_shards = 1; num_shards <= max_shards; num_shards *= 2) {
+    auto proxy =
+      foxy::sharded_proxy(tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), num_shards);
+
+    proxy.run();
+
+    auto const num_connections =
+      run_clients(proxy.local_endpoint(), std::max<std::size_t>(2 * num_shards, 4), duration);
+
+    proxy.stop();
+    proxy.join();
+
+    auto const rate = static_cast<double>(num_connections) * 1000.0 / duration.count();
+    std::cout << num_shards << "         " << static_cast<std::size_t>(rate) << "\n";
+
+    if (num_shards < max_shards && 2 * num_shards > max_shards) { num_shards = max_shards / 2; }
+  }
+
+  return 0;
+}
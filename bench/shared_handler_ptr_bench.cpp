@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// measures a timed read/write loop whose state is held by a `shared_handler_ptr` with each of the
+// reference counting policies
+//
+// every iteration writes a byte over loopback and reads it back with a timer armed alongside the
+// read, the way a timed operation does it. The state is shared by the read, the timer and the
+// operation itself so each iteration copies and destroys the pointer a handful of times.
+//
+
+#include <foxy/shared_handler_ptr.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/error.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+template <class Count, class Handler>
+struct timed_read_op
+{
+  struct state
+  {
+    tcp::socket&       socket;
+    asio::steady_timer timer;
+    char               byte = 0;
+    int                ops  = 0;
+
+    state(Handler const&, asio::io_context& io, tcp::socket& socket_)
+      : socket(socket_)
+      , timer(io)
+    {
+    }
+  };
+
+  foxy::shared_handler_ptr<state, Handler, Count> p_;
+
+  struct on_timer_t
+  {
+  };
+
+  timed_read_op(asio::io_context& io, tcp::socket& socket, Handler handler)
+    : p_(std::move(handler), io, socket)
+  {
+  }
+
+  auto
+  init() -> void
+  {
+    using namespace std::placeholders;
+    using boost::beast::bind_handler;
+
+    auto& s = *p_;
+    s.timer.expires_after(10s);
+    s.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
+    s.socket.async_read_some(asio::buffer(&s.byte, 1), *this);
+  }
+
+  auto
+  operator()(on_timer_t, boost::system::error_code) -> void
+  {
+    if (++p_->ops == 2) { p_.invoke(); }
+  }
+
+  auto
+  operator()(boost::system::error_code, std::size_t) -> void
+  {
+    p_->timer.cancel();
+    if (++p_->ops == 2) { p_.invoke(); }
+  }
+};
+
+template <class Count>
+struct loop
+{
+  asio::io_context& io;
+  tcp::socket&      writer;
+  tcp::socket&      reader;
+  std::size_t       remaining;
+  char              byte = 'x';
+
+  auto
+  next() -> void
+  {
+    if (remaining-- == 0) { return; }
+
+    asio::async_write(writer, asio::buffer(&byte, 1),
+                      [](boost::system::error_code, std::size_t) {});
+
+    auto done = [this] { next(); };
+    timed_read_op<Count, decltype(done)>(io, reader, std::move(done)).init();
+  }
+};
+
+template <class Count>
+auto
+run(std::size_t const num_iterations) -> std::chrono::steady_clock::duration
+{
+  asio::io_context io(1);
+
+  auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+  auto writer   = tcp::socket(io);
+  auto reader   = tcp::socket(io);
+
+  writer.connect(acceptor.local_endpoint());
+  acceptor.accept(reader);
+  writer.set_option(tcp::no_delay(true));
+
+  auto l = loop<Count>{io, writer, reader, num_iterations};
+
+  auto const start = std::chrono::steady_clock::now();
+  l.next();
+  io.run();
+  return std::chrono::steady_clock::now() - start;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const num_iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000ul;
+
+  auto const report = [&](char const* name, std::chrono::steady_clock::duration const elapsed) {
+    auto const ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::cout << std::left << std::setw(16) << name << ns / num_iterations << "\n";
+  };
+
+  std::cout << "count           ns/iteration\n";
+
+  // warm up the loopback connection and the allocator before anything's measured
+  //
+  run<foxy::atomic_count>(num_iterations / 10);
+
+  report("atomic_count", run<foxy::atomic_count>(num_iterations));
+  report("plain_count", run<foxy::plain_count>(num_iterations));
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+// compares how many request/response exchanges per second pairs of sessions get through when
+// they all share a single-threaded io_context against sessions behind per-connection strands on an
+// io_context that's run by every hardware thread
+//
+// every pair is a client session and a server session connected over loopback, the client posts a
+// small request and waits for the server to echo its body back before sending the next one
+//
+
+#include <foxy/session.hpp>
+#include <foxy/strand_stream.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+template <class Stream>
+auto
+lowest_socket(foxy::basic_session<Stream>& session) -> tcp::socket::lowest_layer_type&
+{
+  return session.stream.plain().lowest_layer();
+}
+
+template <class Stream>
+auto
+run(std::size_t const num_threads, std::size_t const num_pairs, std::size_t const num_messages)
+  -> double
+{
+  using session_type = foxy::basic_session<Stream>;
+
+  asio::io_context io(static_cast<int>(num_threads));
+
+  auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+  auto servers = std::vector<std::unique_ptr<session_type>>();
+  auto clients = std::vector<std::unique_ptr<session_type>>();
+
+  for (std::size_t idx = 0; idx < num_pairs; ++idx) {
+    clients.push_back(std::make_unique<session_type>(io));
+    servers.push_back(std::make_unique<session_type>(io));
+
+    lowest_socket(*clients.back()).connect(acceptor.local_endpoint());
+    acceptor.accept(lowest_socket(*servers.back()));
+
+    lowest_socket(*clients.back()).set_option(tcp::no_delay(true));
+    lowest_socket(*servers.back()).set_option(tcp::no_delay(true));
+
+    clients.back()->opts.timeout = 30s;
+    servers.back()->opts.timeout = 30s;
+  }
+
+  auto num_exchanged = std::atomic<std::size_t>{0};
+
+  for (std::size_t idx = 0; idx < num_pairs; ++idx) {
+    auto& server = *servers[idx];
+    auto& client = *clients[idx];
+
+    asio::spawn(server.get_executor(), [&](asio::yield_context yield) {
+      for (std::size_t n = 0; n < num_messages; ++n) {
+        auto parser = http::request_parser<http::string_body>();
+        server.async_read(parser, yield);
+
+        auto res   = http::response<http::string_body>(http::status::ok, 11);
+        res.body() = std::move(parser.get().body());
+        res.prepare_payload();
+
+        auto serializer = http::response_serializer<http::string_body>(res);
+        server.async_write(serializer, yield);
+      }
+    });
+
+    asio::spawn(client.get_executor(), [&](asio::yield_context yield) {
+      auto req   = http::request<http::string_body>(http::verb::post, "/echo", 11);
+      req.body() = std::string(64, 'x');
+      req.prepare_payload();
+
+      for (std::size_t n = 0; n < num_messages; ++n) {
+        auto serializer = http::request_serializer<http::string_body>(req);
+        client.async_write(serializer, yield);
+
+        auto parser = http::response_parser<http::string_body>();
+        client.async_read(parser, yield);
+
+        ++num_exchanged;
+      }
+    });
+  }
+
+  auto const start = std::chrono::steady_clock::now();
+
+  auto threads = std::vector<std::thread>();
+  for (std::size_t idx = 1; idx < num_threads; ++idx) {
+    threads.emplace_back([&] { io.run(); });
+  }
+  io.run();
+  for (auto& thread : threads) { thread.join(); }
+
+  auto const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+  return static_cast<double>(num_exchanged) / elapsed.count();
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  auto const num_pairs    = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64ul;
+  auto const num_messages = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000ul;
+  auto const num_threads  = std::max(std::thread::hardware_concurrency(), 1u);
+
+  std::cout << "sessions                      threads   exchanges/sec\n";
+
+  auto const report = [](char const* name, std::size_t const threads, double const rate) {
+    std::cout << std::left << std::setw(30) << name << std::setw(10) << threads
+              << static_cast<std::size_t>(rate) << "\n";
+  };
+
+  report("single-threaded io_context", 1, run<tcp::socket>(1, num_pairs, num_messages));
+
+  report("strands on a shared pool", num_threads,
+         run<foxy::strand_stream>(num_threads, num_pairs, num_messages));
+
+  return 0;
+}
@@ -10,13 +10,24 @@
 #ifndef FOXY_HPP_
 #define FOXY_HPP_
 
+#include <foxy/awaitable.hpp>
 #include <foxy/client_session.hpp>
+#include <foxy/dns_cache.hpp>
+#include <foxy/dns_resolver.hpp>
+#include <foxy/forward_requests.hpp>
 #include <foxy/log.hpp>
+#include <foxy/message_arena.hpp>
 #include <foxy/multi_stream.hpp>
+#include <foxy/op_storage.hpp>
 #include <foxy/proxy.hpp>
 #include <foxy/server_session.hpp>
 #include <foxy/session.hpp>
+#include <foxy/session_deadline.hpp>
+#include <foxy/sharded_proxy.hpp>
 #include <foxy/shared_handler_ptr.hpp>
+#include <foxy/strand_stream.hpp>
+#include <foxy/timer_wheel.hpp>
+#include <foxy/upstream_pool.hpp>
 #include <foxy/utility.hpp>
 
 #endif // FOXY_HPP_
@@ -0,0 +1,51 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_AWAITABLE_HPP_
+#define FOXY_AWAITABLE_HPP_
+
+#include <boost/version.hpp>
+#include <boost/asio/detail/config.hpp>
+
+// FOXY_HAS_CO_AWAIT is defined when both the compiler and asio support C++20 coroutines, sessions
+// then offer overloads of their operations that take no handler and return an awaitable instead
+//
+// asio's awaitables only exist as of Boost 1.70, the experimental ones that came before them are
+// not supported.
+//
+#if BOOST_VERSION >= 107000 && defined(BOOST_ASIO_HAS_CO_AWAIT)
+#define FOXY_HAS_CO_AWAIT 1
+#endif
+
+#ifdef FOXY_HAS_CO_AWAIT
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+namespace foxy
+{
+// awaitable is what the coroutine overloads of the session operations return
+//
+// The overloads don't start a coroutine of their own. They initiate the regular operation with the
+// handler `use_awaitable` makes for the awaiting coroutine so the only frame involved is the one
+// asio creates for the operation, which it recycles through the calling thread, while the
+// operation's state is drawn from the session's storage like it is for any other handler.
+//
+// `use_awaitable` itself can't be passed to the handler overloads, they're written against
+// `async_completion` which asio's awaitables don't support.
+//
+template <class T>
+using awaitable = boost::asio::awaitable<T>;
+
+} // namespace foxy
+
+#endif // FOXY_HAS_CO_AWAIT
+
+#endif // FOXY_AWAITABLE_HPP_
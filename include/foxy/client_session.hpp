@@ -73,6 +73,16 @@ public:
   async_request(Request& request, ResponseParser& parser, RequestHandler&& handler) & ->
     typename boost::asio::async_result<std::decay_t<RequestHandler>,
                                        void(boost::system::error_code)>::return_type;
+
+#ifdef FOXY_HAS_CO_AWAIT
+  auto
+  async_connect(std::string host, std::string service) &
+    -> ::foxy::awaitable<boost::asio::ip::tcp::endpoint>;
+
+  template <class Request, class ResponseParser>
+  auto
+  async_request(Request& request, ResponseParser& parser) & -> ::foxy::awaitable<void>;
+#endif
 };
 
 } // namespace foxy
@@ -8,6 +8,9 @@
 // Official repository: https://github.com/LeonineKing1199/foxy
 //
 
+#ifndef FOXY_DETAIL_CLOSE_STREAM_HPP_
+#define FOXY_DETAIL_CLOSE_STREAM_HPP_
+
 #include <foxy/type_traits.hpp>
 
 namespace foxy
@@ -37,5 +40,25 @@ close(Stream& stream)
   stream.close(ec);
 }
 
+// cancel aborts all of the pending operations on the stream, falling back to closing it when the
+// stream type offers no way of cancelling
+//
+template <class Stream, std::enable_if_t<is_cancellable_stream_nothrow<Stream>::value, int> = 0>
+auto
+cancel(Stream& stream)
+{
+  auto ec = boost::system::error_code();
+  stream.cancel(ec);
+}
+
+template <class Stream, std::enable_if_t<!is_cancellable_stream_nothrow<Stream>::value, int> = 0>
+auto
+cancel(Stream& stream)
+{
+  close(stream);
+}
+
 } // namespace detail
 } // namespace foxy
+
+#endif // FOXY_DETAIL_CLOSE_STREAM_HPP_
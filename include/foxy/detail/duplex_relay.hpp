@@ -0,0 +1,774 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_DUPLEX_RELAY_HPP_
+#define FOXY_DETAIL_DUPLEX_RELAY_HPP_
+
+#include <foxy/session.hpp>
+#include <foxy/type_traits.hpp>
+#include <foxy/shared_handler_ptr.hpp>
+#include <foxy/detail/close_stream.hpp>
+#include <foxy/detail/watchdog.hpp>
+#include <foxy/detail/relay_buffer.hpp>
+#include <foxy/detail/rewrite_header.hpp>
+
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/parser.hpp>
+#include <boost/beast/http/serializer.hpp>
+#include <boost/beast/http/fields.hpp>
+#include <boost/beast/http/buffer_body.hpp>
+#include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/write.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <boost/optional/optional.hpp>
+
+
+namespace foxy
+{
+namespace detail
+{
+// duplex_relay_op relays one request/response exchange between `server` and `client` like
+// `relay_op` but runs the request path and the response path as two concurrent loops
+//
+// The response loop starts reading from the remote immediately so that an early response (401,
+// 413, a streaming download, ...) reaches the proxy's client while the request body is still being
+// uploaded. If such an early response isn't persistent, the remote is telling us it won't read the
+// rest of the body so the upload is cancelled and the tunnel is closed (RFC 7230, section 6.5).
+//
+// Both loops share their error and cancellation state. The first loop to fail records its error
+// and cancels every pending operation on both sessions so that the other loop winds down.
+//
+// Within each direction, the body is pumped through a ring of buffers so that the next chunk is
+// read while the previous one is still being written out.
+//
+// Because both loops have operations in-flight on the same sessions at the same time, the
+// per-operation timeouts of `basic_session` can't be used. Instead, the server session's timer
+// acts as a watchdog that aborts the relay once the exchange violates one of the server session's
+// `opts.deadlines`. The bytes moved in either direction count as progress.
+//
+// The messages' fields are allocated with `FieldsAllocator`, which the tunnel sets to its
+// per-exchange arena by handing us a request parser that already uses it.
+//
+template <class Stream,
+          class RelayHandler,
+          class FieldsAllocator = boost::asio::associated_allocator_t<RelayHandler>>
+struct duplex_relay_op
+{
+public:
+  using executor_type = boost::asio::associated_executor_t<
+    RelayHandler,
+    decltype((std::declval<::foxy::basic_session<Stream>&>().get_executor()))>;
+
+  using allocator_type        = boost::asio::associated_allocator_t<RelayHandler>;
+  using fields_allocator_type = FieldsAllocator;
+
+  template <bool isRequest, class Body, class Allocator>
+  using parser = boost::beast::http::parser<isRequest, Body, Allocator>;
+
+  template <bool isRequest, class Body, class Fields>
+  using serializer = boost::beast::http::serializer<isRequest, Body, Fields>;
+
+  using buffer_body = boost::beast::http::buffer_body;
+  using empty_body  = boost::beast::http::empty_body;
+  using fields      = boost::beast::http::basic_fields<fields_allocator_type>;
+
+  using request  = boost::beast::http::request<buffer_body, fields>;
+  using response = boost::beast::http::response<buffer_body, fields>;
+
+private:
+  struct state
+  {
+    relay_buffer_ring<allocator_type> req_ring;
+    relay_buffer_ring<allocator_type> res_ring;
+
+    ::foxy::basic_session<Stream>& server;
+    ::foxy::basic_session<Stream>& client;
+
+    parser<true, buffer_body, fields_allocator_type> req_parser;
+    serializer<true, buffer_body, fields>            req_sr;
+    fields                                           req_fields;
+    request&                                         req;
+
+    // the remote may send any number of interim (1xx) responses ahead of the final one and each
+    // of them needs a parser and a serializer of its own
+    //
+    boost::optional<parser<false, buffer_body, fields_allocator_type>> res_parser;
+    boost::optional<serializer<false, buffer_body, fields>>            res_sr;
+    fields                                                              res_fields;
+
+    boost::asio::coroutine req_coro;
+    boost::asio::coroutine res_coro;
+
+    // the read errors are stashed so that the chunks already read can still be written out
+    //
+    boost::system::error_code req_ec;
+    boost::system::error_code res_ec;
+
+    // the first error either loop encounters, this is what's ultimately reported to the caller
+    //
+    boost::system::error_code ec;
+
+    int ops;
+
+    bool is_req_done;
+    bool is_res_done;
+    bool is_res_persistent;
+    bool is_aborted;
+    bool close_tunnel;
+
+    boost::asio::executor_work_guard<decltype(server.get_executor())> work;
+
+    state(RelayHandler const&            handler,
+          ::foxy::basic_session<Stream>& server_,
+          ::foxy::basic_session<Stream>& client_)
+      : req_ring(client_.opts.relay, boost::asio::get_associated_allocator(handler))
+      , res_ring(client_.opts.relay, boost::asio::get_associated_allocator(handler))
+      , server(server_)
+      , client(client_)
+      , req_parser(std::piecewise_construct,
+                   std::make_tuple(),
+                   std::make_tuple(boost::asio::get_associated_allocator(handler)))
+      , req_sr(req_parser.get())
+      , req_fields(boost::asio::get_associated_allocator(handler))
+      , req(req_parser.get())
+      , res_fields(boost::asio::get_associated_allocator(handler))
+      , ops{0}
+      , is_req_done{false}
+      , is_res_done{false}
+      , is_res_persistent{true}
+      , is_aborted{false}
+      , close_tunnel{false}
+      , work(server.get_executor())
+    {
+    }
+
+    state(RelayHandler const&                               handler,
+          ::foxy::basic_session<Stream>&                    server_,
+          ::foxy::basic_session<Stream>&                    client_,
+          parser<true, empty_body, fields_allocator_type>&& req_parser_)
+      : req_ring(client_.opts.relay, boost::asio::get_associated_allocator(handler))
+      , res_ring(client_.opts.relay, boost::asio::get_associated_allocator(handler))
+      , server(server_)
+      , client(client_)
+      , req_parser(std::move(req_parser_))
+      , req_sr(req_parser.get())
+      , req_fields(req_parser.get().get_allocator())
+      , req(req_parser.get())
+      , res_fields(req_parser.get().get_allocator())
+      , ops{0}
+      , is_req_done{false}
+      , is_res_done{false}
+      , is_res_persistent{true}
+      , is_aborted{false}
+      , close_tunnel{false}
+      , work(server.get_executor())
+    {
+    }
+  };
+
+  ::foxy::shared_handler_ptr<state, RelayHandler, ::foxy::plain_count> p_;
+
+  auto
+  abort(boost::system::error_code ec) -> void;
+
+  auto
+  complete() -> void;
+
+  template <class ReadTag, class WriteTag, bool isRequest, class Ring>
+  auto
+  pump_body(ReadTag,
+            WriteTag,
+            ::foxy::basic_session<Stream>&                         source,
+            ::foxy::basic_session<Stream>&                         sink,
+            parser<isRequest, buffer_body, fields_allocator_type>& p,
+            serializer<isRequest, buffer_body, fields>&            sr,
+            Ring&                                                  ring,
+            boost::system::error_code const&                       read_ec) -> bool;
+
+  auto
+  on_request_body() -> void;
+
+  auto
+  on_response_body() -> void;
+
+public:
+  duplex_relay_op()                       = delete;
+  duplex_relay_op(duplex_relay_op const&) = default;
+  duplex_relay_op(duplex_relay_op&&)      = default;
+
+  template <class DeducedHandler>
+  duplex_relay_op(::foxy::basic_session<Stream>& server,
+                  ::foxy::basic_session<Stream>& client,
+                  DeducedHandler&&               handler)
+    : p_(std::forward<DeducedHandler>(handler), server, client)
+  {
+  }
+
+  template <class DeducedHandler>
+  duplex_relay_op(::foxy::basic_session<Stream>&                    server,
+                  ::foxy::basic_session<Stream>&                    client,
+                  parser<true, empty_body, fields_allocator_type>&& req_parser,
+                  DeducedHandler&&                                  handler)
+    : p_(std::forward<DeducedHandler>(handler), server, client, std::move(req_parser))
+  {
+  }
+
+  auto
+  get_executor() const noexcept -> executor_type
+  {
+    return boost::asio::get_associated_executor(p_.handler(), p_->server.get_executor());
+  }
+
+  auto
+  get_allocator() const noexcept -> allocator_type
+  {
+    return boost::asio::get_associated_allocator(p_.handler());
+  }
+
+  struct on_request_t
+  {
+  };
+  struct on_request_read_t
+  {
+  };
+  struct on_request_write_t
+  {
+  };
+  struct on_response_t
+  {
+  };
+  struct on_response_read_t
+  {
+  };
+  struct on_response_write_t
+  {
+  };
+  struct on_timer_t
+  {
+  };
+
+  auto
+  init() -> void;
+
+  auto
+  operator()(on_request_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void;
+
+  auto
+  operator()(on_request_read_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void;
+
+  auto
+  operator()(on_request_write_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void;
+
+  auto
+  operator()(on_response_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void;
+
+  auto
+  operator()(on_response_read_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void;
+
+  auto
+  operator()(on_response_write_t,
+             boost::system::error_code ec,
+             std::size_t const         bytes_transferred) -> void;
+
+  auto
+  operator()(on_timer_t, boost::system::error_code ec) -> void;
+};
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::abort(boost::system::error_code ec) -> void
+{
+  auto& s = *p_;
+  if (s.is_aborted) { return; }
+
+  s.is_aborted   = true;
+  s.close_tunnel = true;
+  if (!s.ec) { s.ec = ec; }
+
+  auto& server_stream =
+    s.server.stream.is_ssl() ? s.server.stream.ssl().next_layer() : s.server.stream.plain();
+
+  auto& client_stream =
+    s.client.stream.is_ssl() ? s.client.stream.ssl().next_layer() : s.client.stream.plain();
+
+  ::foxy::detail::cancel(server_stream);
+  ::foxy::detail::cancel(client_stream);
+
+  s.server.timer.cancel();
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::complete() -> void
+{
+  // we wait for the request loop, the response loop and the watchdog timer
+  //
+  auto& s = *p_;
+  if (++s.ops < 3) { return; }
+
+  auto       work         = std::move(s.work);
+  auto const ec           = s.ec;
+  auto const close_tunnel = s.close_tunnel;
+
+  p_.invoke(ec, close_tunnel);
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::init() -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  auto& s = *p_;
+
+  s.server.timer.expires_at(watchdog_expiry(s.server));
+  s.server.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
+
+  (*this)(on_response_t{}, {}, 0);
+  (*this)(on_request_t{}, {}, 0);
+
+  p_.reset();
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::operator()(
+  on_timer_t,
+  boost::system::error_code ec) -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  auto& s = *p_;
+
+  auto const is_done = s.is_aborted || (s.is_req_done && s.is_res_done);
+  if (!is_done) {
+    // either direction moving any bytes at all keeps the relay alive, we only time out once the
+    // whole exchange has stalled
+    //
+    auto const expiry = watchdog_expiry(s.server);
+    if (session_deadline::clock_type::now() < expiry) {
+      s.server.timer.expires_at(expiry);
+      return s.server.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
+    }
+
+    abort(boost::asio::error::timed_out);
+  }
+
+  complete();
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::operator()(
+  on_request_t,
+  boost::system::error_code ec,
+  std::size_t const         bytes_transferred) -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  namespace http = boost::beast::http;
+
+  auto& s = *p_;
+
+  s.server.deadline.progress(bytes_transferred);
+  BOOST_ASIO_CORO_REENTER(s.req_coro)
+  {
+    if (!s.req_parser.is_header_done()) {
+      BOOST_ASIO_CORO_YIELD
+      http::async_read_header(s.server.stream, s.server.buffer, s.req_parser,
+                              bind_handler(*this, on_request_t{}, _1, _2));
+
+      if (ec) { goto upcall; }
+    }
+
+    BOOST_ASIO_CORO_YIELD
+    {
+      auto const via     = ::foxy::detail::via_entry(s.client.opts.relay.via);
+      auto const rewrite = ::foxy::detail::rewrite_header(s.req, s.req_fields, s.close_tunnel, via);
+      if (rewrite.is_loop) { goto upcall; }
+
+      s.close_tunnel = s.close_tunnel || !rewrite.keep_alive;
+
+      http::async_write_header(s.client.stream, s.req_sr,
+                               bind_handler(*this, on_request_t{}, _1, _2));
+    }
+    if (ec) { goto upcall; }
+
+    return on_request_body();
+
+  upcall:
+    // an error or a detected loop on the request side means the remote will never see a complete
+    // request so there's no sense in waiting on its response
+    //
+    s.is_req_done = true;
+    abort(ec);
+    complete();
+  }
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::operator()(
+  on_response_t,
+  boost::system::error_code ec,
+  std::size_t const         bytes_transferred) -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  namespace http = boost::beast::http;
+
+  auto& s = *p_;
+
+  s.server.deadline.progress(bytes_transferred);
+  BOOST_ASIO_CORO_REENTER(s.res_coro)
+  {
+    // interim responses are relayed as they come in and are followed by the final response on
+    // the same connection, they never end the exchange (RFC 7231, section 6.2)
+    //
+    while (true) {
+      BOOST_ASIO_CORO_YIELD
+      {
+        s.res_sr.reset();
+        s.res_fields.clear();
+        s.res_parser.emplace(std::piecewise_construct, std::make_tuple(),
+                             std::make_tuple(s.res_fields.get_allocator()));
+        s.res_sr.emplace(s.res_parser->get());
+
+        http::async_read_header(s.client.stream, s.client.buffer, *s.res_parser,
+                                bind_handler(*this, on_response_t{}, _1, _2));
+      }
+      if (ec) { goto upcall; }
+
+      if (s.res_parser->get().result_int() >= 200) { break; }
+
+      // Upgrade is hop-by-hop and never reaches the remote so it has no business switching
+      // protocols on us
+      //
+      if (s.res_parser->get().result() == http::status::switching_protocols) {
+        ec = http::error::bad_status;
+        goto upcall;
+      }
+
+      // an HTTP/1.0 client doesn't know what to make of an interim response
+      //
+      if (s.req.version() < 11) { continue; }
+
+      BOOST_ASIO_CORO_YIELD
+      {
+        auto const via = ::foxy::detail::via_entry(s.client.opts.relay.via);
+        auto const rewrite =
+          ::foxy::detail::rewrite_header(s.res_parser->get(), s.res_fields, false, via);
+        if (rewrite.is_loop) { goto upcall; }
+
+        http::async_write_header(s.server.stream, *s.res_sr,
+                                 bind_handler(*this, on_response_t{}, _1, _2));
+      }
+      if (ec) { goto upcall; }
+    }
+
+    BOOST_ASIO_CORO_YIELD
+    {
+      auto const via = ::foxy::detail::via_entry(s.client.opts.relay.via);
+      auto const rewrite =
+        ::foxy::detail::rewrite_header(s.res_parser->get(), s.res_fields, s.close_tunnel, via);
+      if (rewrite.is_loop) { goto upcall; }
+
+      s.is_res_persistent = rewrite.keep_alive;
+      s.close_tunnel      = s.close_tunnel || !s.is_res_persistent;
+
+      http::async_write_header(s.server.stream, *s.res_sr,
+                               bind_handler(*this, on_response_t{}, _1, _2));
+    }
+    if (ec) { goto upcall; }
+
+    return on_response_body();
+
+  upcall:
+    s.is_res_done = true;
+    abort(ec);
+    complete();
+  }
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+template <class ReadTag, class WriteTag, bool isRequest, class Ring>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::pump_body(
+  ReadTag,
+  WriteTag,
+  ::foxy::basic_session<Stream>&                         source,
+  ::foxy::basic_session<Stream>&                         sink,
+  parser<isRequest, buffer_body, fields_allocator_type>& p,
+  serializer<isRequest, buffer_body, fields>&            sr,
+  Ring&                                                  ring,
+  boost::system::error_code const&                       read_ec) -> bool
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  namespace http = boost::beast::http;
+
+  auto& s    = *p_;
+  auto& body = p.get().body();
+
+  // The parser and the serializer share the same `buffer_body` so its `data` and `size` can only
+  // ever describe one operation. The serializer copies them out of the body when a write is
+  // initiated and afterwards only looks at `more` so it's safe to repoint the body at the next
+  // read slot. The reverse is not true, the parser writes through `data` for as long as the read is
+  // pending so a write can only be started while no read is in-flight.
+  //
+  if (!ring.is_reading && !s.is_aborted) {
+    if (!ring.is_writing) {
+      if (ring.num_filled() > 0) {
+        auto& slot = ring.write_slot();
+
+        body.data = slot.buffer.data();
+        body.size = slot.size;
+        body.more = slot.more;
+
+        ring.is_writing = true;
+        http::async_write(sink.stream, sr, bind_handler(*this, WriteTag{}, _1, _2));
+
+      } else if (p.is_done() && !sr.is_done() && !read_ec) {
+        body.data = nullptr;
+        body.size = 0;
+        body.more = false;
+
+        ring.is_writing = true;
+        http::async_write(sink.stream, sr, bind_handler(*this, WriteTag{}, _1, _2));
+      }
+    }
+
+    if (!p.is_done() && !read_ec && ring.has_free_slot()) {
+      auto& slot = ring.read_slot();
+      slot.buffer.prepare();
+
+      body.data = slot.buffer.data();
+      body.size = slot.buffer.size();
+
+      ring.is_reading = true;
+      http::async_read(source.stream, source.buffer, p, bind_handler(*this, ReadTag{}, _1, _2));
+    }
+  }
+
+  return !ring.is_reading && !ring.is_writing;
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::on_request_body() -> void
+{
+  auto& s = *p_;
+
+  auto const is_drained = pump_body(on_request_read_t{}, on_request_write_t{}, s.server, s.client,
+                                    s.req_parser, s.req_sr, s.req_ring, s.req_ec);
+
+  if (!is_drained) { return; }
+
+  s.is_req_done = true;
+
+  // an error on the request side means the remote will never see a complete request so there's
+  // no sense in waiting on its response
+  //
+  if (s.req_ec || s.is_aborted) {
+    abort(s.req_ec);
+    return complete();
+  }
+
+  if (s.is_res_done) { s.server.timer.cancel(); }
+  complete();
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::on_response_body() -> void
+{
+  auto& s = *p_;
+
+  auto const is_drained = pump_body(on_response_read_t{}, on_response_write_t{}, s.client,
+                                    s.server, *s.res_parser, *s.res_sr, s.res_ring, s.res_ec);
+
+  if (!is_drained) { return; }
+
+  s.is_res_done = true;
+
+  if (s.res_ec || s.is_aborted) {
+    abort(s.res_ec);
+    return complete();
+  }
+
+  // the remote answered before it received the entire request and it's also closing the
+  // connection so it won't be reading the rest of the upload
+  //
+  if (!s.is_req_done && !s.is_res_persistent) { abort({}); }
+
+  if (s.is_req_done) { s.server.timer.cancel(); }
+  complete();
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::operator()(
+  on_request_read_t,
+  boost::system::error_code ec,
+  std::size_t const         bytes_transferred) -> void
+{
+  namespace http = boost::beast::http;
+
+  auto& s = *p_;
+
+  s.server.deadline.progress(bytes_transferred);
+  s.req_ring.is_reading = false;
+
+  if (ec == http::error::need_buffer) { ec = {}; }
+
+  auto const size = s.req_ring.read_slot().buffer.size() - s.req.body().size;
+  if (size > 0) { s.req_ring.commit_read(size, !s.req_parser.is_done()); }
+
+  if (ec) { s.req_ec = ec; }
+  on_request_body();
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::operator()(
+  on_request_write_t,
+  boost::system::error_code ec,
+  std::size_t const         bytes_transferred) -> void
+{
+  namespace http = boost::beast::http;
+
+  auto& s = *p_;
+
+  s.server.deadline.progress(bytes_transferred);
+  s.req_ring.is_writing = false;
+
+  if (ec == http::error::need_buffer) { ec = {}; }
+
+  if (ec) {
+    if (!s.req_ec) { s.req_ec = ec; }
+    abort(ec);
+  } else if (s.req_ring.num_filled() > 0) {
+    s.req_ring.commit_write();
+  }
+
+  on_request_body();
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::operator()(
+  on_response_read_t,
+  boost::system::error_code ec,
+  std::size_t const         bytes_transferred) -> void
+{
+  namespace http = boost::beast::http;
+
+  auto& s = *p_;
+
+  s.server.deadline.progress(bytes_transferred);
+  s.res_ring.is_reading = false;
+
+  if (ec == http::error::need_buffer) { ec = {}; }
+
+  auto const size = s.res_ring.read_slot().buffer.size() - s.res_parser->get().body().size;
+  if (size > 0) { s.res_ring.commit_read(size, !s.res_parser->is_done()); }
+
+  if (ec) { s.res_ec = ec; }
+  on_response_body();
+}
+
+template <class Stream, class RelayHandler, class FieldsAllocator>
+auto
+duplex_relay_op<Stream, RelayHandler, FieldsAllocator>::operator()(
+  on_response_write_t,
+  boost::system::error_code ec,
+  std::size_t const         bytes_transferred) -> void
+{
+  namespace http = boost::beast::http;
+
+  auto& s = *p_;
+
+  s.server.deadline.progress(bytes_transferred);
+  s.res_ring.is_writing = false;
+
+  if (ec == http::error::need_buffer) { ec = {}; }
+
+  if (ec) {
+    if (!s.res_ec) { s.res_ec = ec; }
+    abort(ec);
+  } else if (s.res_ring.num_filled() > 0) {
+    s.res_ring.commit_write();
+  }
+
+  on_response_body();
+}
+
+template <class Stream, class RelayHandler>
+auto
+async_duplex_relay(::foxy::basic_session<Stream>& server,
+                   ::foxy::basic_session<Stream>& client,
+                   RelayHandler&&                 handler) ->
+  typename boost::asio::async_result<std::decay_t<RelayHandler>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  boost::asio::async_completion<RelayHandler, void(boost::system::error_code, bool)> init(handler);
+
+  duplex_relay_op<Stream,
+                  typename boost::asio::async_completion<
+                    RelayHandler, void(boost::system::error_code, bool)>::completion_handler_type>(
+    server, client, std::move(init.completion_handler))
+    .init();
+
+  return init.result.get();
+}
+
+template <class Stream, class Allocator, class RelayHandler>
+auto
+async_duplex_relay(
+  ::foxy::basic_session<Stream>&                                                server,
+  ::foxy::basic_session<Stream>&                                                client,
+  boost::beast::http::parser<true, boost::beast::http::empty_body, Allocator>&& parser,
+  RelayHandler&&                                                                handler) ->
+  typename boost::asio::async_result<std::decay_t<RelayHandler>,
+                                     void(boost::system::error_code, bool)>::return_type
+{
+  boost::asio::async_completion<RelayHandler, void(boost::system::error_code, bool)> init(handler);
+
+  duplex_relay_op<Stream,
+                  typename boost::asio::async_completion<
+                    RelayHandler, void(boost::system::error_code, bool)>::completion_handler_type,
+                  Allocator>(server, client, std::move(parser), std::move(init.completion_handler))
+    .init();
+
+  return init.result.get();
+}
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_DUPLEX_RELAY_HPP_
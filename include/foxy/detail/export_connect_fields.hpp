@@ -12,23 +12,121 @@
 
 #include <boost/beast/http/field.hpp>
 #include <boost/beast/http/fields.hpp>
-#include <boost/beast/http/type_traits.hpp>
-
 #include <boost/beast/http/rfc7230.hpp>
 
-#include <boost/utility/string_view.hpp>
-#include <boost/range/algorithm.hpp>
+#include <boost/beast/core/string.hpp>
 
-#include <type_traits>
 #include <array>
-#include <vector>
-#include <memory>
-#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
 
 namespace foxy
 {
 namespace detail
 {
+// field_set is a bitset over `http::field`, it answers whether a known field belongs to the set
+// with a single shift and mask
+//
+struct field_set
+{
+  static constexpr std::size_t num_words = 8;
+
+  std::uint64_t words[num_words];
+
+  constexpr field_set(std::initializer_list<boost::beast::http::field> const fields)
+    : words{}
+  {
+    for (auto const field : fields) {
+      auto const idx = static_cast<std::size_t>(field);
+      words[idx / 64] |= std::uint64_t{1} << (idx % 64);
+    }
+  }
+
+  constexpr auto
+  contains(boost::beast::http::field const field) const noexcept -> bool
+  {
+    auto const idx = static_cast<std::size_t>(field);
+    return idx < num_words * 64 && ((words[idx / 64] >> (idx % 64)) & 1) != 0;
+  }
+};
+
+// hop_by_hop_fields are the fields RFC 7230 and its extensions name as hop-by-hop, no matter what
+// the Connection fields say
+//
+constexpr auto
+hop_by_hop_fields() noexcept -> field_set
+{
+  namespace http = boost::beast::http;
+
+  return field_set{http::field::connection,
+                   http::field::keep_alive,
+                   http::field::proxy_authenticate,
+                   http::field::proxy_authentication_info,
+                   http::field::proxy_authorization,
+                   http::field::proxy_connection,
+                   http::field::proxy_features,
+                   http::field::proxy_instruction,
+                   http::field::te,
+                   http::field::trailer,
+                   http::field::transfer_encoding};
+}
+
+// connect_opts are the options of every Connection field in a Fields container
+//
+// The options are views into the fields themselves so the Connection fields have to outlive the
+// connect_opts, other fields can come and go. Only the first 16 options are kept on hand, a
+// message with more of them than that has its Connection fields parsed again for every lookup
+// that misses.
+//
+template <class Allocator>
+struct connect_opts
+{
+private:
+  static constexpr std::size_t capacity = 16;
+
+  boost::beast::http::basic_fields<Allocator> const& fields_;
+
+  std::array<boost::beast::string_view, capacity> opts_;
+
+  std::size_t size_;
+  bool        is_truncated_;
+  bool        has_close_;
+  bool        has_keep_alive_;
+
+public:
+  connect_opts()                    = delete;
+  connect_opts(connect_opts const&) = delete;
+  connect_opts& operator=(connect_opts const&) = delete;
+
+  explicit connect_opts(boost::beast::http::basic_fields<Allocator> const& fields);
+
+  auto
+  empty() const noexcept -> bool
+  {
+    return size_ == 0;
+  }
+
+  // has_close and has_keep_alive tell whether any of the options is "close" or "keep-alive"
+  //
+  auto
+  has_close() const noexcept -> bool
+  {
+    return has_close_;
+  }
+
+  auto
+  has_keep_alive() const noexcept -> bool
+  {
+    return has_keep_alive_;
+  }
+
+  // contains compares case-insensitively, same as field names
+  //
+  auto
+  contains(boost::beast::string_view const name) const -> bool;
+};
+
 // export_connect_fields writes all the hop-by-hop headers in `src` to the Fields container denoted
 // by `dst`
 //
@@ -43,6 +141,9 @@ namespace detail
 // Connection ABNF:
 // Connection = *( "," OWS ) connection-option *( OWS "," [ OWS connection-option ] )
 //
+// Nothing is allocated other than the copies `dst` makes. The Connection options are views into
+// `src`'s own Connection fields, which is why those are the last ones to be moved over.
+//
 template <class Allocator>
 void
 export_connect_fields(boost::beast::http::basic_fields<Allocator>& src,
@@ -52,76 +153,87 @@ export_connect_fields(boost::beast::http::basic_fields<Allocator>& src,
 } // namespace foxy
 
 template <class Allocator>
-void
-foxy::detail::export_connect_fields(boost::beast::http::basic_fields<Allocator>& src,
-                                    boost::beast::http::basic_fields<Allocator>& dst)
+constexpr std::size_t foxy::detail::connect_opts<Allocator>::capacity;
+
+template <class Allocator>
+foxy::detail::connect_opts<Allocator>::connect_opts(
+  boost::beast::http::basic_fields<Allocator> const& fields)
+  : fields_(fields)
+  , size_(0)
+  , is_truncated_(false)
+  , has_close_(false)
+  , has_keep_alive_(false)
 {
   namespace http  = boost::beast::http;
-  namespace range = boost::range;
+  namespace beast = boost::beast;
+
+  auto const range = fields_.equal_range(http::field::connection);
+  for (auto it = range.first; it != range.second; ++it) {
+    for (auto const opt : http::token_list(it->value())) {
+      has_close_      = has_close_ || beast::iequals(opt, "close");
+      has_keep_alive_ = has_keep_alive_ || beast::iequals(opt, "keep-alive");
+
+      if (size_ == capacity) {
+        is_truncated_ = true;
+        continue;
+      }
+      opts_[size_++] = opt;
+    }
+  }
+}
 
-  using string_type =
-    std::basic_string<char, std::char_traits<char>,
-                      typename std::allocator_traits<Allocator>::template rebind_alloc<char>>;
+template <class Allocator>
+auto
+foxy::detail::connect_opts<Allocator>::contains(boost::beast::string_view const name) const -> bool
+{
+  namespace http  = boost::beast::http;
+  namespace beast = boost::beast;
 
-  // first collect all the Connection options into one coherent list
-  //
-  auto connect_opts =
-    std::vector<string_type,
-                typename std::allocator_traits<Allocator>::template rebind_alloc<string_type>>(
-      src.get_allocator());
+  for (std::size_t idx = 0; idx < size_; ++idx) {
+    if (beast::iequals(name, opts_[idx])) { return true; }
+  }
 
-  connect_opts.reserve(128);
+  if (!is_truncated_) { return false; }
 
-  auto const connect_fields = src.equal_range(http::field::connection);
-  auto       out            = std::back_inserter(connect_opts);
+  auto const range = fields_.equal_range(http::field::connection);
+  for (auto it = range.first; it != range.second; ++it) {
+    for (auto const opt : http::token_list(it->value())) {
+      if (beast::iequals(name, opt)) { return true; }
+    }
+  }
+  return false;
+}
 
-  range::for_each(connect_fields, [&src, out](auto const& connect_field) {
-    range::transform(
-      http::token_list(connect_field.value()), out, [&src](auto const token_view) -> string_type {
-        return string_type(token_view.begin(), token_view.end(), src.get_allocator());
-      });
-  });
+template <class Allocator>
+void
+foxy::detail::export_connect_fields(boost::beast::http::basic_fields<Allocator>& src,
+                                    boost::beast::http::basic_fields<Allocator>& dst)
+{
+  namespace http = boost::beast::http;
 
-  range::sort(connect_opts);
-  range::unique(connect_opts);
+  constexpr auto hop_by_hops = hop_by_hop_fields();
 
-  // iterate the `src` fields, moving any connect headers and the corresponding tokens to the `dst`
-  // fields
-  //
-  auto const hop_by_hops = std::array<http::field, 11>{http::field::connection,
-                                                       http::field::keep_alive,
-                                                       http::field::proxy_authenticate,
-                                                       http::field::proxy_authentication_info,
-                                                       http::field::proxy_authorization,
-                                                       http::field::proxy_connection,
-                                                       http::field::proxy_features,
-                                                       http::field::proxy_instruction,
-                                                       http::field::te,
-                                                       http::field::trailer,
-                                                       http::field::transfer_encoding};
-
-  auto const is_connect_opt =
-    [&connect_opts,
-     &hop_by_hops](typename http::basic_fields<Allocator>::value_type const& field) -> bool {
-    if (range::find(hop_by_hops, field.name()) != hop_by_hops.end()) { return true; }
-
-    for (auto const opt : connect_opts) {
-      if (field.name_string() == opt) { return true; }
-    }
-    return false;
-  };
+  connect_opts<Allocator> const opts(src);
 
   for (auto it = src.begin(); it != src.end();) {
     auto const& field = *it;
+    auto const  name  = field.name();
 
-    if (!is_connect_opt(field)) {
+    if (name == http::field::connection ||
+        (!hop_by_hops.contains(name) && (opts.empty() || !opts.contains(field.name_string())))) {
       ++it;
       continue;
     }
 
-    dst.insert(field.name_string(), field.value());
+    dst.insert(name, field.name_string(), field.value());
     it = src.erase(it);
   }
+
+  auto const range = src.equal_range(http::field::connection);
+  for (auto it = range.first; it != range.second; ++it) {
+    dst.insert(http::field::connection, it->name_string(), it->value());
+  }
+  src.erase(http::field::connection);
 }
 
 #endif // FOXY_DETAIL_EXPORT_CONNECT_FIELDS_HPP_
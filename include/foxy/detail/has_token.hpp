@@ -15,23 +15,46 @@
 
 #include <boost/utility/string_view.hpp>
 
-#include <boost/spirit/home/x3.hpp>
-
-#include <algorithm>
-#include <numeric>
-
-#include <iostream>
-
 namespace foxy
 {
 namespace detail
 {
+// icontains tells whether `needle` appears anywhere in `haystack`, ignoring the case of ASCII
+// letters
+//
+// Header values are searched 32 or 16 bytes at a time with AVX2 or SSE2, whichever the CPU has, and
+// one byte at a time otherwise. AVX2 is picked at runtime when the library itself isn't built for
+// it.
+//
+auto
+icontains(boost::string_view const haystack, boost::string_view const needle) noexcept -> bool;
+
+// via_entry is the Via entry the relays use for the configured `via`
+//
+// An empty entry would be found in every Via field, turning every message that has one into a loop,
+// and would add nothing to the messages that don't so the default takes its place.
+//
+inline auto
+via_entry(boost::string_view const via) noexcept -> boost::string_view
+{
+  return via.empty() ? boost::string_view("1.1 foxy") : via;
+}
+
+// is_foxy_via tells whether a single Via field's value names us as one of the intermediaries,
+// `via` being the entry we add to the messages we relay
+//
+inline auto
+is_foxy_via(boost::string_view const value, boost::string_view const via) noexcept -> bool
+{
+  return ::foxy::detail::icontains(value, via);
+}
+
 template <class Allocator>
 auto
-has_foxy_via(boost::beast::http::basic_fields<Allocator> const& fields) -> bool
+has_foxy_via(boost::beast::http::basic_fields<Allocator> const& fields,
+             boost::string_view const                           via) -> bool
 {
   namespace http = boost::beast::http;
-  namespace x3   = boost::spirit::x3;
 
   auto const field_range = fields.equal_range(http::field::via);
 
@@ -40,12 +63,7 @@ has_foxy_via(boost::beast::http::basic_fields<Allocator> const& fields) -> bool
 
   auto found = false;
   for (; begin != end; ++begin) {
-    auto       field_val_iter = begin->value().begin();
-    auto const field_val_end  = begin->value().end();
-
-    found = x3::parse(field_val_iter, field_val_end,
-                      x3::no_case[*(x3::char_ - "1.1 foxy") >> x3::lit("1.1 foxy") >> *x3::char_]);
-
+    found = ::foxy::detail::is_foxy_via(begin->value(), via);
     if (found) { break; }
   }
   return found;
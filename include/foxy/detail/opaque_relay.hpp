@@ -0,0 +1,454 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_OPAQUE_RELAY_HPP_
+#define FOXY_DETAIL_OPAQUE_RELAY_HPP_
+
+#include <foxy/session.hpp>
+#include <foxy/shared_handler_ptr.hpp>
+#include <foxy/detail/close_stream.hpp>
+#include <foxy/detail/watchdog.hpp>
+#include <foxy/detail/relay_buffer.hpp>
+#include <foxy/detail/splice_relay.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <type_traits>
+
+namespace foxy
+{
+namespace detail
+{
+// opaque_relay_op copies raw bytes between the streams of `server` and `client` until both peers
+// have closed their sending side
+//
+// This is what a CONNECT tunnel carrying TLS needs: there's nothing we could parse so there's no
+// parser, no serializer and no `Via` header, just two read/write loops whose buffers grow according
+// to the client session's `relay_opts` as soon as the tunnel starts moving bulk data. Anything
+// still sitting in a session's buffer (the bytes `async_detect_ssl` peeked at, for example) is
+// forwarded before the first read.
+//
+// When one side signals EOF, the loop for that direction shuts down the send side of the opposite
+// stream so that the half-close is propagated and the other direction keeps on flowing until its
+// peer is done as well.
+//
+// Like `duplex_relay_op`, the server session's timer is used as a watchdog that aborts the tunnel
+// once it violates one of the server session's `opts.deadlines`.
+//
+// This is the portable path. On Linux, tunnels between two plain TCP sockets are handed to
+// `splice_relay_op` instead.
+//
+template <class Stream, class RelayHandler>
+struct opaque_relay_op
+{
+public:
+  using executor_type = boost::asio::associated_executor_t<
+    RelayHandler,
+    decltype((std::declval<::foxy::basic_session<Stream>&>().get_executor()))>;
+
+  using allocator_type = boost::asio::associated_allocator_t<RelayHandler>;
+
+private:
+  struct state
+  {
+    relay_buffer<allocator_type> up_buffer;
+    relay_buffer<allocator_type> down_buffer;
+
+    ::foxy::basic_session<Stream>& server;
+    ::foxy::basic_session<Stream>& client;
+
+    boost::asio::coroutine up_coro;
+    boost::asio::coroutine down_coro;
+
+    // the first error either loop encounters, this is what's ultimately reported to the caller
+    //
+    boost::system::error_code ec;
+
+    int ops;
+
+    bool is_up_done;
+    bool is_down_done;
+    bool is_aborted;
+
+    boost::asio::executor_work_guard<decltype(server.get_executor())> work;
+
+    state(RelayHandler const&            handler,
+          ::foxy::basic_session<Stream>& server_,
+          ::foxy::basic_session<Stream>& client_)
+      : up_buffer(client_.opts.relay, boost::asio::get_associated_allocator(handler))
+      , down_buffer(client_.opts.relay, boost::asio::get_associated_allocator(handler))
+      , server(server_)
+      , client(client_)
+      , ops{0}
+      , is_up_done{false}
+      , is_down_done{false}
+      , is_aborted{false}
+      , work(server.get_executor())
+    {
+    }
+  };
+
+  ::foxy::shared_handler_ptr<state, RelayHandler, ::foxy::plain_count> p_;
+
+  auto
+  abort(boost::system::error_code ec) -> void;
+
+  auto
+  complete() -> void;
+
+  static auto
+  lowest_layer(::foxy::basic_multi_stream<Stream>& stream) -> Stream&
+  {
+    return stream.is_ssl() ? stream.ssl().next_layer() : stream.plain();
+  }
+
+public:
+  opaque_relay_op()                       = delete;
+  opaque_relay_op(opaque_relay_op const&) = default;
+  opaque_relay_op(opaque_relay_op&&)      = default;
+
+  template <class DeducedHandler>
+  opaque_relay_op(::foxy::basic_session<Stream>& server,
+                  ::foxy::basic_session<Stream>& client,
+                  DeducedHandler&&               handler)
+    : p_(std::forward<DeducedHandler>(handler), server, client)
+  {
+  }
+
+  auto
+  get_executor() const noexcept -> executor_type
+  {
+    return boost::asio::get_associated_executor(p_.handler(), p_->server.get_executor());
+  }
+
+  auto
+  get_allocator() const noexcept -> allocator_type
+  {
+    return boost::asio::get_associated_allocator(p_.handler());
+  }
+
+  // `on_upstream_t` tags the server -> client direction, `on_downstream_t` the client -> server one
+  //
+  struct on_upstream_t
+  {
+  };
+  struct on_downstream_t
+  {
+  };
+  struct on_timer_t
+  {
+  };
+
+  auto
+  init() -> void;
+
+  auto
+  operator()(on_upstream_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void;
+
+  auto
+  operator()(on_downstream_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void;
+
+  auto
+  operator()(on_timer_t, boost::system::error_code ec) -> void;
+};
+
+template <class Stream, class RelayHandler>
+auto
+opaque_relay_op<Stream, RelayHandler>::abort(boost::system::error_code ec) -> void
+{
+  auto& s = *p_;
+  if (s.is_aborted) { return; }
+
+  s.is_aborted = true;
+  if (!s.ec) { s.ec = ec; }
+
+  ::foxy::detail::cancel(lowest_layer(s.server.stream));
+  ::foxy::detail::cancel(lowest_layer(s.client.stream));
+
+  s.server.timer.cancel();
+}
+
+template <class Stream, class RelayHandler>
+auto
+opaque_relay_op<Stream, RelayHandler>::complete() -> void
+{
+  // we wait for both copy loops and the watchdog timer
+  //
+  auto& s = *p_;
+  if (++s.ops < 3) { return; }
+
+  auto       work = std::move(s.work);
+  auto const ec   = s.ec;
+
+  p_.invoke(ec);
+}
+
+template <class Stream, class RelayHandler>
+auto
+opaque_relay_op<Stream, RelayHandler>::init() -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  auto& s = *p_;
+
+  s.server.timer.expires_at(watchdog_expiry(s.server));
+  s.server.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
+
+  (*this)(on_downstream_t{}, {}, 0);
+  (*this)(on_upstream_t{}, {}, 0);
+
+  p_.reset();
+}
+
+template <class Stream, class RelayHandler>
+auto
+opaque_relay_op<Stream, RelayHandler>::operator()(on_timer_t, boost::system::error_code ec) -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  auto& s = *p_;
+
+  auto const is_done = s.is_aborted || (s.is_up_done && s.is_down_done);
+  if (!is_done) {
+    auto const expiry = watchdog_expiry(s.server);
+    if (session_deadline::clock_type::now() < expiry) {
+      s.server.timer.expires_at(expiry);
+      return s.server.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
+    }
+
+    abort(boost::asio::error::timed_out);
+  }
+
+  complete();
+}
+
+template <class Stream, class RelayHandler>
+auto
+opaque_relay_op<Stream, RelayHandler>::operator()(on_upstream_t,
+                                                  boost::system::error_code ec,
+                                                  std::size_t const         bytes_transferred)
+  -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  namespace net = boost::asio;
+
+  auto& s = *p_;
+
+  s.server.deadline.progress(bytes_transferred);
+  BOOST_ASIO_CORO_REENTER(s.up_coro)
+  {
+    if (s.server.buffer.size() > 0) {
+      BOOST_ASIO_CORO_YIELD
+      net::async_write(s.client.stream, s.server.buffer.data(),
+                       bind_handler(*this, on_upstream_t{}, _1, _2));
+
+      if (ec) { goto upcall; }
+      s.server.buffer.consume(bytes_transferred);
+    }
+
+    while (true) {
+      s.up_buffer.prepare();
+
+      BOOST_ASIO_CORO_YIELD
+      s.server.stream.async_read_some(net::buffer(s.up_buffer.data(), s.up_buffer.size()),
+                                      bind_handler(*this, on_upstream_t{}, _1, _2));
+
+      if (ec == net::error::eof) {
+        lowest_layer(s.client.stream).shutdown(net::socket_base::shutdown_send, ec);
+        break;
+      }
+      if (ec) { goto upcall; }
+
+      s.up_buffer.commit(bytes_transferred);
+
+      BOOST_ASIO_CORO_YIELD
+      net::async_write(s.client.stream, net::buffer(s.up_buffer.data(), bytes_transferred),
+                       bind_handler(*this, on_upstream_t{}, _1, _2));
+
+      if (ec) { goto upcall; }
+    }
+
+    s.is_up_done = true;
+    if (s.is_down_done) { s.server.timer.cancel(); }
+    return complete();
+
+  upcall:
+    s.is_up_done = true;
+    abort(ec);
+    complete();
+  }
+}
+
+template <class Stream, class RelayHandler>
+auto
+opaque_relay_op<Stream, RelayHandler>::operator()(on_downstream_t,
+                                                  boost::system::error_code ec,
+                                                  std::size_t const         bytes_transferred)
+  -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  namespace net = boost::asio;
+
+  auto& s = *p_;
+
+  s.server.deadline.progress(bytes_transferred);
+  BOOST_ASIO_CORO_REENTER(s.down_coro)
+  {
+    if (s.client.buffer.size() > 0) {
+      BOOST_ASIO_CORO_YIELD
+      net::async_write(s.server.stream, s.client.buffer.data(),
+                       bind_handler(*this, on_downstream_t{}, _1, _2));
+
+      if (ec) { goto upcall; }
+      s.client.buffer.consume(bytes_transferred);
+    }
+
+    while (true) {
+      s.down_buffer.prepare();
+
+      BOOST_ASIO_CORO_YIELD
+      s.client.stream.async_read_some(net::buffer(s.down_buffer.data(), s.down_buffer.size()),
+                                      bind_handler(*this, on_downstream_t{}, _1, _2));
+
+      if (ec == net::error::eof) {
+        lowest_layer(s.server.stream).shutdown(net::socket_base::shutdown_send, ec);
+        break;
+      }
+      if (ec) { goto upcall; }
+
+      s.down_buffer.commit(bytes_transferred);
+
+      BOOST_ASIO_CORO_YIELD
+      net::async_write(s.server.stream, net::buffer(s.down_buffer.data(), bytes_transferred),
+                       bind_handler(*this, on_downstream_t{}, _1, _2));
+
+      if (ec) { goto upcall; }
+    }
+
+    s.is_down_done = true;
+    if (s.is_up_done) { s.server.timer.cancel(); }
+    return complete();
+
+  upcall:
+    s.is_down_done = true;
+    abort(ec);
+    complete();
+  }
+}
+
+template <class Stream, class RelayHandler>
+auto
+start_opaque_relay(std::false_type,
+                   ::foxy::basic_session<Stream>& server,
+                   ::foxy::basic_session<Stream>& client,
+                   RelayHandler&&                 handler) -> void
+{
+  opaque_relay_op<Stream, std::decay_t<RelayHandler>>(server, client,
+                                                      std::forward<RelayHandler>(handler))
+    .init();
+}
+
+#if defined(FOXY_HAS_SPLICE)
+template <class Stream, class RelayHandler>
+auto
+start_opaque_relay(std::true_type,
+                   ::foxy::basic_session<Stream>& server,
+                   ::foxy::basic_session<Stream>& client,
+                   RelayHandler&&                 handler) -> void
+{
+  // TLS records have to pass through the SSL engine so only a tunnel between two plain sockets can
+  // be spliced, and if the kernel won't give us pipes we can still fall back to copying
+  //
+  if (!server.stream.is_ssl() && !client.stream.is_ssl()) {
+    auto ec        = boost::system::error_code();
+    auto up_pipe   = splice_pipe();
+    auto down_pipe = splice_pipe();
+
+    up_pipe.open(ec);
+    if (!ec) { down_pipe.open(ec); }
+
+    if (!ec) {
+      return splice_relay_op<std::decay_t<RelayHandler>>(server, client, std::move(up_pipe),
+                                                         std::move(down_pipe),
+                                                         std::forward<RelayHandler>(handler))
+        .init();
+    }
+  }
+
+  start_opaque_relay(std::false_type{}, server, client, std::forward<RelayHandler>(handler));
+}
+#endif
+
+// async_copy_relay blindly copies bytes in both directions between the streams of `server` and
+// `client` until both of them reach EOF, always going through user-space buffers
+//
+// The handler's signature is: `void(boost::system::error_code)`
+//
+template <class Stream, class RelayHandler>
+auto
+async_copy_relay(::foxy::basic_session<Stream>& server,
+                 ::foxy::basic_session<Stream>& client,
+                 RelayHandler&&                 handler) ->
+  typename boost::asio::async_result<std::decay_t<RelayHandler>,
+                                     void(boost::system::error_code)>::return_type
+{
+  boost::asio::async_completion<RelayHandler, void(boost::system::error_code)> init(handler);
+
+  start_opaque_relay(std::false_type{}, server, client, std::move(init.completion_handler));
+
+  return init.result.get();
+}
+
+// async_opaque_relay is `async_copy_relay` but uses zero-copy forwarding whenever the platform and
+// the session streams allow for it
+//
+// The handler's signature is: `void(boost::system::error_code)`
+//
+template <class Stream, class RelayHandler>
+auto
+async_opaque_relay(::foxy::basic_session<Stream>& server,
+                   ::foxy::basic_session<Stream>& client,
+                   RelayHandler&&                 handler) ->
+  typename boost::asio::async_result<std::decay_t<RelayHandler>,
+                                     void(boost::system::error_code)>::return_type
+{
+#if defined(FOXY_HAS_SPLICE)
+  using is_spliceable = std::integral_constant<bool, is_spliceable_stream<Stream>::value>;
+#else
+  using is_spliceable = std::false_type;
+#endif
+
+  boost::asio::async_completion<RelayHandler, void(boost::system::error_code)> init(handler);
+
+  start_opaque_relay(is_spliceable{}, server, client, std::move(init.completion_handler));
+
+  return init.result.get();
+}
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_OPAQUE_RELAY_HPP_
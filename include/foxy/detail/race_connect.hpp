@@ -0,0 +1,311 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_RACE_CONNECT_HPP_
+#define FOXY_DETAIL_RACE_CONNECT_HPP_
+
+#include <foxy/shared_handler_ptr.hpp>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace foxy
+{
+namespace detail
+{
+// interleave_families orders endpoints the way RFC 8305 asks for, alternating between the address
+// families while starting with whichever family the resolver listed first
+//
+template <class EndpointSequence>
+auto
+interleave_families(EndpointSequence const& endpoints)
+  -> std::vector<boost::asio::ip::tcp::endpoint>
+{
+  auto preferred = std::vector<boost::asio::ip::tcp::endpoint>();
+  auto other     = std::vector<boost::asio::ip::tcp::endpoint>();
+
+  for (auto const& entry : endpoints) {
+    boost::asio::ip::tcp::endpoint const& endpoint = entry;
+    if (preferred.empty() || endpoint.protocol() == preferred.front().protocol()) {
+      preferred.push_back(endpoint);
+    } else {
+      other.push_back(endpoint);
+    }
+  }
+
+  auto ordered = std::vector<boost::asio::ip::tcp::endpoint>();
+  ordered.reserve(preferred.size() + other.size());
+
+  for (std::size_t idx = 0; idx < std::max(preferred.size(), other.size()); ++idx) {
+    if (idx < preferred.size()) { ordered.push_back(preferred[idx]); }
+    if (idx < other.size()) { ordered.push_back(other[idx]); }
+  }
+
+  return ordered;
+}
+
+// race_connect_op connects `socket` to the first endpoint that accepts a connection
+//
+// A new attempt is started every `delay` or as soon as the previous one fails, whichever comes
+// first, while the earlier attempts keep running. The first one to connect wins, the others are
+// closed. Every attempt is abandoned with `operation_aborted` once `deadline` is reached.
+//
+template <class ConnectHandler>
+struct race_connect_op
+{
+private:
+  static constexpr std::size_t no_winner = std::numeric_limits<std::size_t>::max();
+
+  using clock_type = typename boost::asio::steady_timer::clock_type;
+
+  struct state
+  {
+    boost::asio::ip::tcp::socket&               socket;
+    std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+    std::vector<boost::asio::ip::tcp::socket>   attempts;
+    boost::asio::steady_timer                   timer;
+    boost::asio::steady_timer::duration         delay;
+    boost::asio::steady_timer::time_point       deadline;
+
+    boost::system::error_code ec;
+    std::size_t               winner         = no_winner;
+    std::size_t               num_pending    = 0;
+    std::size_t               num_connecting = 0;
+
+    boost::asio::executor_work_guard<boost::asio::ip::tcp::socket::executor_type> work;
+
+    state(ConnectHandler const&,
+          boost::asio::ip::tcp::socket&               socket_,
+          std::vector<boost::asio::ip::tcp::endpoint> endpoints_,
+          boost::asio::steady_timer::duration         delay_,
+          boost::asio::steady_timer::time_point       deadline_)
+      : socket(socket_)
+      , endpoints(std::move(endpoints_))
+      , timer(socket.get_executor().context())
+      , delay(delay_)
+      , deadline(deadline_)
+      , work(socket.get_executor())
+    {
+      // the sockets are never moved while an attempt is in-flight
+      //
+      attempts.reserve(endpoints.size());
+    }
+  };
+
+  ::foxy::shared_handler_ptr<state, ConnectHandler, ::foxy::plain_count> p_;
+
+public:
+  race_connect_op()                       = delete;
+  race_connect_op(race_connect_op const&) = default;
+  race_connect_op(race_connect_op&&)      = default;
+
+  template <class DeducedHandler>
+  race_connect_op(boost::asio::ip::tcp::socket&               socket,
+                  std::vector<boost::asio::ip::tcp::endpoint> endpoints,
+                  boost::asio::steady_timer::duration         delay,
+                  boost::asio::steady_timer::time_point       deadline,
+                  DeducedHandler&&                            handler)
+    : p_(std::forward<DeducedHandler>(handler), socket, std::move(endpoints), delay, deadline)
+  {
+  }
+
+  using executor_type =
+    boost::asio::associated_executor_t<ConnectHandler,
+                                       boost::asio::ip::tcp::socket::executor_type>;
+
+  using allocator_type = boost::asio::associated_allocator_t<ConnectHandler>;
+
+  auto
+  get_executor() const noexcept -> executor_type
+  {
+    return boost::asio::get_associated_executor(p_.handler(), p_->socket.get_executor());
+  }
+
+  auto
+  get_allocator() const noexcept -> allocator_type
+  {
+    return boost::asio::get_associated_allocator(p_.handler());
+  }
+
+  struct on_connect_t
+  {
+  };
+  struct on_timer_t
+  {
+  };
+  struct on_finish_t
+  {
+  };
+
+  auto
+  init() -> void
+  {
+    if (p_->endpoints.empty()) {
+      p_->ec = boost::asio::error::not_found;
+      return boost::asio::post(boost::beast::bind_handler(std::move(*this), on_finish_t{}));
+    }
+
+    start_attempt();
+  }
+
+  // start_attempt connects to the next endpoint in line and arms the timer for the one after it or,
+  // when there's nothing left to try, for the deadline
+  //
+  auto
+  start_attempt() -> void
+  {
+    using namespace std::placeholders;
+    using boost::beast::bind_handler;
+
+    auto& s = *p_;
+
+    if (s.attempts.size() < s.endpoints.size()) {
+      auto const idx = s.attempts.size();
+      s.attempts.emplace_back(s.socket.get_executor().context());
+      s.attempts.back().async_connect(s.endpoints[idx],
+                                      bind_handler(*this, on_connect_t{}, idx, _1));
+      ++s.num_pending;
+      ++s.num_connecting;
+    }
+
+    auto const is_exhausted = s.attempts.size() == s.endpoints.size();
+    s.timer.expires_at(is_exhausted ? s.deadline
+                                    : std::min(clock_type::now() + s.delay, s.deadline));
+    s.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
+    ++s.num_pending;
+  }
+
+  auto
+  operator()(on_timer_t, boost::system::error_code ec) -> void
+  {
+    auto& s = *p_;
+    --s.num_pending;
+
+    if (ec || s.winner != no_winner) { return maybe_finish(); }
+
+    if (clock_type::now() < s.deadline) {
+      start_attempt();
+      return maybe_finish();
+    }
+
+    s.ec = boost::asio::error::operation_aborted;
+    close_attempts();
+    maybe_finish();
+  }
+
+  auto
+  operator()(on_connect_t, std::size_t const idx, boost::system::error_code ec) -> void
+  {
+    auto& s = *p_;
+    --s.num_pending;
+    --s.num_connecting;
+
+    if (s.winner == no_winner && s.ec != boost::asio::error::operation_aborted) {
+      if (!ec) {
+        s.winner = idx;
+        s.timer.cancel();
+        close_attempts();
+      } else {
+        s.ec = ec;
+
+        // a failed attempt doesn't need to wait out the delay, the next one can start right away
+        // and once every attempt has failed there's no point in waiting for the deadline either
+        //
+        if (s.attempts.size() < s.endpoints.size()) {
+          start_attempt();
+        } else if (s.num_connecting == 0) {
+          s.timer.cancel();
+        }
+      }
+    }
+
+    maybe_finish();
+  }
+
+  auto
+  close_attempts() -> void
+  {
+    auto& s = *p_;
+    for (std::size_t idx = 0; idx < s.attempts.size(); ++idx) {
+      if (idx == s.winner) { continue; }
+
+      auto ec = boost::system::error_code();
+      s.attempts[idx].close(ec);
+    }
+  }
+
+  auto
+  maybe_finish() -> void
+  {
+    if (p_->num_pending > 0) { return; }
+    (*this)(on_finish_t{});
+  }
+
+  auto
+  operator()(on_finish_t) -> void
+  {
+    auto& s = *p_;
+
+    auto endpoint = boost::asio::ip::tcp::endpoint();
+    auto ec       = s.ec;
+
+    if (s.winner != no_winner) {
+      s.socket = std::move(s.attempts[s.winner]);
+      endpoint = s.endpoints[s.winner];
+      ec       = {};
+    }
+
+    auto work = std::move(s.work);
+    p_.invoke(ec, endpoint);
+  }
+};
+
+template <class EndpointSequence, class ConnectHandler>
+auto
+async_race_connect(boost::asio::ip::tcp::socket&         socket,
+                   EndpointSequence const&               endpoints,
+                   boost::asio::steady_timer::duration   delay,
+                   boost::asio::steady_timer::time_point deadline,
+                   ConnectHandler&&                      handler) ->
+  typename boost::asio::async_result<
+    std::decay_t<ConnectHandler>,
+    void(boost::system::error_code, boost::asio::ip::tcp::endpoint)>::return_type
+{
+  boost::asio::async_completion<ConnectHandler,
+                                void(boost::system::error_code, boost::asio::ip::tcp::endpoint)>
+    init(handler);
+
+  race_connect_op<typename boost::asio::async_completion<
+    ConnectHandler,
+    void(boost::system::error_code, boost::asio::ip::tcp::endpoint)>::completion_handler_type>(
+    socket, interleave_families(endpoints), delay, deadline, std::move(init.completion_handler))
+    .init();
+
+  return init.result.get();
+}
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_RACE_CONNECT_HPP_
@@ -12,8 +12,8 @@
 
 #include <foxy/session.hpp>
 #include <foxy/type_traits.hpp>
-#include <foxy/detail/export_connect_fields.hpp>
-#include <foxy/detail/has_token.hpp>
+#include <foxy/detail/rewrite_header.hpp>
+#include <foxy/detail/relay_buffer.hpp>
 
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/parser.hpp>
@@ -25,7 +25,6 @@
 
 #include <boost/system/error_code.hpp>
 
-#include <array>
 #include <iostream>
 
 namespace foxy
@@ -58,7 +57,7 @@ public:
 private:
   struct state
   {
-    std::array<char, 2048> buffer;
+    relay_buffer<allocator_type> buffer;
 
     ::foxy::basic_session<Stream>& server;
     ::foxy::basic_session<Stream>& client;
@@ -82,7 +81,8 @@ private:
     state(RelayHandler const&            handler,
           ::foxy::basic_session<Stream>& server_,
           ::foxy::basic_session<Stream>& client_)
-      : server(server_)
+      : buffer(client_.opts.relay, boost::asio::get_associated_allocator(handler))
+      , server(server_)
       , client(client_)
       , req_parser(std::piecewise_construct,
                    std::make_tuple(),
@@ -105,7 +105,8 @@ private:
           ::foxy::basic_session<Stream>&             server_,
           ::foxy::basic_session<Stream>&             client_,
           parser<true, empty_body, allocator_type>&& req_parser_)
-      : server(server_)
+      : buffer(client_.opts.relay, boost::asio::get_associated_allocator(handler))
+      , server(server_)
       , client(client_)
       , req_parser(std::move(req_parser_))
       , req_sr(req_parser.get())
@@ -193,17 +194,11 @@ relay_op<Stream, RelayHandler>::operator()(boost::system::error_code ec,
     //
     BOOST_ASIO_CORO_YIELD
     {
-      s.close_tunnel        = s.close_tunnel || !s.req.keep_alive();
-      auto const is_chunked = s.req.chunked();
+      auto const via     = ::foxy::detail::via_entry(s.client.opts.relay.via);
+      auto const rewrite = ::foxy::detail::rewrite_header(s.req, s.req_fields, s.close_tunnel, via);
 
-      if (::foxy::detail::has_foxy_via(s.req)) { goto upcall; }
-
-      ::foxy::detail::export_connect_fields(s.req, s.req_fields);
-
-      if (s.close_tunnel) { s.req.keep_alive(false); }
-      if (is_chunked) { s.req.chunked(true); }
-
-      s.req.insert(http::field::via, "1.1 foxy");
+      s.close_tunnel = s.close_tunnel || !rewrite.keep_alive;
+      if (rewrite.is_loop) { goto upcall; }
 
       s.client.async_write_header(s.req_sr, std::move(*this));
     }
@@ -213,6 +208,8 @@ relay_op<Stream, RelayHandler>::operator()(boost::system::error_code ec,
       s.ec = {};
 
       if (!s.req_parser.is_done()) {
+        s.buffer.prepare();
+
         s.req.body().data = s.buffer.data();
         s.req.body().size = s.buffer.size();
 
@@ -224,6 +221,7 @@ relay_op<Stream, RelayHandler>::operator()(boost::system::error_code ec,
 
         s.req.body().size = s.buffer.size() - s.req.body().size;
         s.req.body().data = s.buffer.data();
+        s.buffer.commit(s.req.body().size);
         s.req.body().more = !s.req_parser.is_done();
 
       } else {
@@ -249,18 +247,11 @@ relay_op<Stream, RelayHandler>::operator()(boost::system::error_code ec,
 
     BOOST_ASIO_CORO_YIELD
     {
-      s.close_tunnel = s.close_tunnel || !s.res.keep_alive();
-
-      if (::foxy::detail::has_foxy_via(s.res)) { goto upcall; }
+      auto const via     = ::foxy::detail::via_entry(s.client.opts.relay.via);
+      auto const rewrite = ::foxy::detail::rewrite_header(s.res, s.res_fields, s.close_tunnel, via);
 
-      auto const is_chunked = s.res.chunked();
-
-      ::foxy::detail::export_connect_fields(s.res, s.res_fields);
-
-      if (s.close_tunnel) { s.res.keep_alive(false); }
-      if (is_chunked) { s.res.chunked(true); }
-
-      s.res.insert(http::field::via, "1.1 foxy");
+      s.close_tunnel = s.close_tunnel || !rewrite.keep_alive;
+      if (rewrite.is_loop) { goto upcall; }
 
       s.server.async_write_header(s.res_sr, std::move(*this));
     }
@@ -270,6 +261,8 @@ relay_op<Stream, RelayHandler>::operator()(boost::system::error_code ec,
       s.ec = {};
 
       if (!s.res_parser.is_done()) {
+        s.buffer.prepare();
+
         s.res.body().data = s.buffer.data();
         s.res.body().size = s.buffer.size();
 
@@ -281,6 +274,7 @@ relay_op<Stream, RelayHandler>::operator()(boost::system::error_code ec,
 
         s.res.body().size = s.buffer.size() - s.res.body().size;
         s.res.body().data = s.buffer.data();
+        s.buffer.commit(s.res.body().size);
         s.res.body().more = !s.res_parser.is_done();
 
       } else {
@@ -0,0 +1,211 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_RELAY_BUFFER_HPP_
+#define FOXY_DETAIL_RELAY_BUFFER_HPP_
+
+#include <foxy/session.hpp>
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <utility>
+#include <cstddef>
+
+namespace foxy
+{
+namespace detail
+{
+// relay_buffer is the chunk buffer a relay reads body bytes into before writing them back out
+//
+// Memory comes from the completion handler's allocator and is only acquired on the first call to
+// `prepare()`. Whenever a read fills the buffer completely, the next `prepare()` doubles it up to
+// `relay_opts::max_buffer_size`. Growth only ever happens in `prepare()` which the relays call once
+// the previous chunk has been written out so no pending bytes are lost.
+//
+template <class Allocator>
+struct relay_buffer
+{
+public:
+  using allocator_type =
+    typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned char>;
+
+private:
+  using traits = std::allocator_traits<allocator_type>;
+
+  allocator_type alloc_;
+  unsigned char* data_     = nullptr;
+  std::size_t    capacity_ = 0;
+  std::size_t    size_;
+  std::size_t    max_size_;
+
+public:
+  relay_buffer()                    = delete;
+  relay_buffer(relay_buffer const&) = delete;
+
+  relay_buffer(relay_buffer&& rhs) noexcept
+    : alloc_(rhs.alloc_)
+    , data_(std::exchange(rhs.data_, nullptr))
+    , capacity_(std::exchange(rhs.capacity_, 0))
+    , size_(rhs.size_)
+    , max_size_(rhs.max_size_)
+  {
+  }
+
+  relay_buffer(::foxy::relay_opts const& opts, Allocator const& alloc)
+    : alloc_(alloc)
+    , size_(std::max<std::size_t>(opts.buffer_size, 1))
+    , max_size_(std::max(opts.max_buffer_size, size_))
+  {
+  }
+
+  ~relay_buffer()
+  {
+    if (data_) { traits::deallocate(alloc_, data_, capacity_); }
+  }
+
+  // make sure `size()` bytes are available at `data()`
+  //
+  auto
+  prepare() -> void
+  {
+    if (data_ && capacity_ == size_) { return; }
+    if (data_) {
+      traits::deallocate(alloc_, data_, capacity_);
+
+      data_     = nullptr;
+      capacity_ = 0;
+    }
+
+    data_     = traits::allocate(alloc_, size_);
+    capacity_ = size_;
+  }
+
+  // report how many bytes the last read placed into the buffer
+  //
+  auto
+  commit(std::size_t const n) noexcept -> void
+  {
+    if (n == size_ && size_ < max_size_) { size_ = std::min(2 * size_, max_size_); }
+  }
+
+  auto
+  data() noexcept -> void*
+  {
+    return data_;
+  }
+
+  auto
+  size() const noexcept -> std::size_t
+  {
+    return size_;
+  }
+};
+
+// relay_buffer_ring lets a relay read chunk N + 1 of a body while chunk N is still being written
+//
+// Reads fill the slot at `read_slot()` and writes drain the one at `write_slot()`, both advancing
+// around the ring in FIFO order. The ring only does the bookkeeping, the relay decides when to
+// start which operation.
+//
+template <class Allocator, std::size_t N = 2>
+struct relay_buffer_ring
+{
+  static_assert(N >= 2, "A ring needs at least two slots to overlap reads with writes");
+
+  struct slot
+  {
+    relay_buffer<Allocator> buffer;
+
+    std::size_t size = 0;
+    bool        more = false;
+
+    slot(::foxy::relay_opts const& opts, Allocator const& alloc)
+      : buffer(opts, alloc)
+    {
+    }
+  };
+
+private:
+  std::array<slot, N> slots_;
+
+  std::size_t read_idx_   = 0;
+  std::size_t write_idx_  = 0;
+  std::size_t num_filled_ = 0;
+
+  template <std::size_t... Is>
+  relay_buffer_ring(::foxy::relay_opts const& opts,
+                    Allocator const&          alloc,
+                    std::index_sequence<Is...>)
+    : slots_{{((void)Is, slot(opts, alloc))...}}
+  {
+  }
+
+public:
+  bool is_reading = false;
+  bool is_writing = false;
+
+  relay_buffer_ring(::foxy::relay_opts const& opts, Allocator const& alloc)
+    : relay_buffer_ring(opts, alloc, std::make_index_sequence<N>{})
+  {
+  }
+
+  auto
+  num_filled() const noexcept -> std::size_t
+  {
+    return num_filled_;
+  }
+
+  auto
+  has_free_slot() const noexcept -> bool
+  {
+    return num_filled_ < N;
+  }
+
+  auto
+  read_slot() noexcept -> slot&
+  {
+    return slots_[read_idx_];
+  }
+
+  auto
+  write_slot() noexcept -> slot&
+  {
+    return slots_[write_idx_];
+  }
+
+  // hand the read slot over to the writing side once a read has placed `size` bytes into it
+  //
+  auto
+  commit_read(std::size_t const size, bool const more) noexcept -> void
+  {
+    auto& s = slots_[read_idx_];
+
+    s.size = size;
+    s.more = more;
+    s.buffer.commit(size);
+
+    read_idx_ = (read_idx_ + 1) % N;
+    ++num_filled_;
+  }
+
+  // free up the write slot once its contents have been fully written out
+  //
+  auto
+  commit_write() noexcept -> void
+  {
+    write_idx_ = (write_idx_ + 1) % N;
+    --num_filled_;
+  }
+};
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_RELAY_BUFFER_HPP_
@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_REWRITE_HEADER_HPP_
+#define FOXY_DETAIL_REWRITE_HEADER_HPP_
+
+#include <foxy/detail/has_token.hpp>
+#include <foxy/detail/export_connect_fields.hpp>
+
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/fields.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/rfc7230.hpp>
+
+#include <boost/beast/core/string.hpp>
+
+namespace foxy
+{
+namespace detail
+{
+struct header_rewrite
+{
+  // is_loop is set when the message already passed through us, it's been left half-rewritten and
+  // has to be dropped
+  //
+  bool is_loop;
+
+  // keep_alive is what the message had to say about persisting the connection before it was
+  // rewritten
+  //
+  bool keep_alive;
+};
+
+// rewrite_header prepares a message header the relay is about to forward
+//
+// It's what the relay used to do in several passes over the fields (checking Via for a loop,
+// exporting the hop-by-hops, resetting Connection and Transfer-Encoding, appending Via), done in a
+// single walk of the field list:
+//
+// * every hop-by-hop field is moved to `hop_by_hops`, Connection options included
+// * the message is marked as the last on the connection if `close` is set or if it asked for that
+//   itself
+// * a chunked message stays chunked, a Content-Length alongside it is dropped
+// * `via` is appended to Via, a message that already has it is a loop
+//
+// The Connection and Transfer-Encoding fields are found by looking them up before the walk, which
+// doesn't touch any of the other fields.
+//
+template <bool isRequest, class Allocator>
+auto
+rewrite_header(
+  boost::beast::http::header<isRequest, boost::beast::http::basic_fields<Allocator>>& header,
+  boost::beast::http::basic_fields<Allocator>&                                        hop_by_hops,
+  bool const                                                                          close,
+  boost::beast::string_view const                                                     via)
+  -> header_rewrite;
+
+} // namespace detail
+} // namespace foxy
+
+template <bool isRequest, class Allocator>
+auto
+foxy::detail::rewrite_header(
+  boost::beast::http::header<isRequest, boost::beast::http::basic_fields<Allocator>>& header,
+  boost::beast::http::basic_fields<Allocator>&                                        hop_by_hops,
+  bool const                                                                          close,
+  boost::beast::string_view const                                                     via)
+  -> header_rewrite
+{
+  namespace http  = boost::beast::http;
+  namespace beast = boost::beast;
+
+  constexpr auto hop_by_hop_set = hop_by_hop_fields();
+
+  connect_opts<Allocator> const opts(header);
+
+  auto const keep_alive = header.version() < 11 ? opts.has_keep_alive() : !opts.has_close();
+
+  // a message is chunked when chunked is the last of its transfer codings
+  //
+  auto is_chunked = false;
+  {
+    auto const range = header.equal_range(http::field::transfer_encoding);
+    for (auto it = range.first; it != range.second; ++it) {
+      for (auto const coding : http::token_list(it->value())) {
+        is_chunked = beast::iequals(coding, "chunked");
+      }
+    }
+  }
+
+  for (auto it = header.begin(); it != header.end();) {
+    auto const& field = *it;
+    auto const  name  = field.name();
+
+    if (name == http::field::via && ::foxy::detail::is_foxy_via(field.value(), via)) {
+      return {true, keep_alive};
+    }
+
+    if (name == http::field::content_length && is_chunked) {
+      it = header.erase(it);
+      continue;
+    }
+
+    if (name == http::field::connection ||
+        (!hop_by_hop_set.contains(name) &&
+         (opts.empty() || !opts.contains(field.name_string())))) {
+      ++it;
+      continue;
+    }
+
+    hop_by_hops.insert(name, field.name_string(), field.value());
+    it = header.erase(it);
+  }
+
+  // the options are views into the Connection fields so those go last
+  //
+  {
+    auto const range = header.equal_range(http::field::connection);
+    for (auto it = range.first; it != range.second; ++it) {
+      hop_by_hops.insert(http::field::connection, it->name_string(), it->value());
+    }
+    header.erase(http::field::connection);
+  }
+
+  // an HTTP/1.0 message without a keep-alive option already means close
+  //
+  if ((close || !keep_alive) && header.version() >= 11) {
+    header.insert(http::field::connection, "close");
+  }
+
+  if (is_chunked) { header.insert(http::field::transfer_encoding, "chunked"); }
+
+  header.insert(http::field::via, via);
+
+  return {false, keep_alive};
+}
+
+#endif // FOXY_DETAIL_REWRITE_HEADER_HPP_
@@ -0,0 +1,427 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_SPLICE_RELAY_HPP_
+#define FOXY_DETAIL_SPLICE_RELAY_HPP_
+
+#if defined(__linux__)
+
+#define FOXY_HAS_SPLICE
+
+#include <foxy/session.hpp>
+#include <foxy/shared_handler_ptr.hpp>
+#include <foxy/detail/close_stream.hpp>
+#include <foxy/detail/watchdog.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <boost/asio/coroutine.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+namespace foxy
+{
+namespace detail
+{
+// only plain TCP sockets hand us a descriptor the kernel can splice from and into
+//
+template <class Stream>
+struct is_spliceable_stream : std::is_same<Stream, boost::asio::ip::tcp::socket>
+{
+};
+
+// splice_pipe is the in-kernel buffer that bytes are moved through on their way from one socket to
+// the other
+//
+struct splice_pipe
+{
+  int read_fd  = -1;
+  int write_fd = -1;
+
+  splice_pipe() = default;
+
+  splice_pipe(splice_pipe const&) = delete;
+  splice_pipe(splice_pipe&& rhs) noexcept
+    : read_fd(std::exchange(rhs.read_fd, -1))
+    , write_fd(std::exchange(rhs.write_fd, -1))
+  {
+  }
+
+  ~splice_pipe()
+  {
+    if (read_fd != -1) { ::close(read_fd); }
+    if (write_fd != -1) { ::close(write_fd); }
+  }
+
+  auto
+  open(boost::system::error_code& ec) -> void
+  {
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+      ec.assign(errno, boost::system::system_category());
+      return;
+    }
+
+    read_fd  = fds[0];
+    write_fd = fds[1];
+  }
+};
+
+// splice_relay_op is the zero-copy counterpart of `opaque_relay_op` for tunnels where both sessions
+// are plain TCP sockets
+//
+// Each direction moves bytes socket -> pipe -> socket with `splice(2)` so that the payload never
+// crosses into user-space. The sockets are put into non-blocking mode and whenever the kernel
+// reports EAGAIN, the direction parks itself on an `async_wait` for the matching readiness.
+//
+// Semantics are otherwise identical to the opaque relay: buffered bytes are forwarded first, EOF is
+// propagated as a half-close and the server session's timer is used as the deadline watchdog.
+//
+template <class RelayHandler>
+struct splice_relay_op
+{
+public:
+  using socket_type = boost::asio::ip::tcp::socket;
+
+  using executor_type = boost::asio::associated_executor_t<
+    RelayHandler,
+    decltype((std::declval<::foxy::basic_session<socket_type>&>().get_executor()))>;
+
+  using allocator_type = boost::asio::associated_allocator_t<RelayHandler>;
+
+  static constexpr std::size_t chunk_size = 64 * 1024;
+
+private:
+  struct direction
+  {
+    socket_type&               src;
+    socket_type&               dst;
+    boost::beast::flat_buffer& buffer;
+    splice_pipe                pipe;
+
+    boost::asio::coroutine coro;
+
+    // the number of bytes currently sitting in the pipe that still need to go out to `dst`
+    //
+    std::size_t pending = 0;
+
+    bool is_done = false;
+
+    direction(socket_type&               src_,
+              socket_type&               dst_,
+              boost::beast::flat_buffer& buffer_,
+              splice_pipe&&              pipe_)
+      : src(src_)
+      , dst(dst_)
+      , buffer(buffer_)
+      , pipe(std::move(pipe_))
+    {
+    }
+  };
+
+  struct state
+  {
+    ::foxy::basic_session<socket_type>& server;
+    ::foxy::basic_session<socket_type>& client;
+
+    direction up;
+    direction down;
+
+    boost::system::error_code ec;
+
+    int ops;
+
+    bool is_aborted;
+
+    boost::asio::executor_work_guard<decltype(server.get_executor())> work;
+
+    state(RelayHandler const&,
+          ::foxy::basic_session<socket_type>& server_,
+          ::foxy::basic_session<socket_type>& client_,
+          splice_pipe&&                       up_pipe,
+          splice_pipe&&                       down_pipe)
+      : server(server_)
+      , client(client_)
+      , up(server.stream.plain(), client.stream.plain(), server.buffer, std::move(up_pipe))
+      , down(client.stream.plain(), server.stream.plain(), client.buffer, std::move(down_pipe))
+      , ops{0}
+      , is_aborted{false}
+      , work(server.get_executor())
+    {
+    }
+  };
+
+  ::foxy::shared_handler_ptr<state, RelayHandler, ::foxy::plain_count> p_;
+
+  auto
+  abort(boost::system::error_code ec) -> void;
+
+  auto
+  complete() -> void;
+
+  template <class Tag>
+  auto
+  pump(Tag, direction& d, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void;
+
+public:
+  splice_relay_op()                       = delete;
+  splice_relay_op(splice_relay_op const&) = default;
+  splice_relay_op(splice_relay_op&&)      = default;
+
+  template <class DeducedHandler>
+  splice_relay_op(::foxy::basic_session<socket_type>& server,
+                  ::foxy::basic_session<socket_type>& client,
+                  splice_pipe&&                       up_pipe,
+                  splice_pipe&&                       down_pipe,
+                  DeducedHandler&&                    handler)
+    : p_(std::forward<DeducedHandler>(handler),
+         server,
+         client,
+         std::move(up_pipe),
+         std::move(down_pipe))
+  {
+  }
+
+  auto
+  get_executor() const noexcept -> executor_type
+  {
+    return boost::asio::get_associated_executor(p_.handler(), p_->server.get_executor());
+  }
+
+  auto
+  get_allocator() const noexcept -> allocator_type
+  {
+    return boost::asio::get_associated_allocator(p_.handler());
+  }
+
+  struct on_upstream_t
+  {
+  };
+  struct on_downstream_t
+  {
+  };
+  struct on_timer_t
+  {
+  };
+
+  auto
+  init() -> void;
+
+  auto
+  operator()(on_upstream_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void
+  {
+    pump(on_upstream_t{}, p_->up, ec, bytes_transferred);
+  }
+
+  auto
+  operator()(on_downstream_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+    -> void
+  {
+    pump(on_downstream_t{}, p_->down, ec, bytes_transferred);
+  }
+
+  auto
+  operator()(on_timer_t, boost::system::error_code ec) -> void;
+};
+
+template <class RelayHandler>
+auto
+splice_relay_op<RelayHandler>::abort(boost::system::error_code ec) -> void
+{
+  auto& s = *p_;
+  if (s.is_aborted) { return; }
+
+  s.is_aborted = true;
+  if (!s.ec) { s.ec = ec; }
+
+  ::foxy::detail::cancel(s.server.stream.plain());
+  ::foxy::detail::cancel(s.client.stream.plain());
+
+  s.server.timer.cancel();
+}
+
+template <class RelayHandler>
+auto
+splice_relay_op<RelayHandler>::complete() -> void
+{
+  auto& s = *p_;
+  if (++s.ops < 3) { return; }
+
+  auto       work = std::move(s.work);
+  auto const ec   = s.ec;
+
+  p_.invoke(ec);
+}
+
+template <class RelayHandler>
+auto
+splice_relay_op<RelayHandler>::init() -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  auto& s = *p_;
+
+  auto ec = boost::system::error_code();
+  s.server.stream.plain().native_non_blocking(true, ec);
+  if (!ec) { s.client.stream.plain().native_non_blocking(true, ec); }
+
+  s.server.timer.expires_at(watchdog_expiry(s.server));
+  s.server.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
+
+  if (ec) {
+    abort(ec);
+    complete();
+    complete();
+  } else {
+    (*this)(on_downstream_t{}, {}, 0);
+    (*this)(on_upstream_t{}, {}, 0);
+  }
+
+  p_.reset();
+}
+
+template <class RelayHandler>
+auto
+splice_relay_op<RelayHandler>::operator()(on_timer_t, boost::system::error_code ec) -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  auto& s = *p_;
+
+  auto const is_done = s.is_aborted || (s.up.is_done && s.down.is_done);
+  if (!is_done) {
+    auto const expiry = watchdog_expiry(s.server);
+    if (session_deadline::clock_type::now() < expiry) {
+      s.server.timer.expires_at(expiry);
+      return s.server.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
+    }
+
+    abort(boost::asio::error::timed_out);
+  }
+
+  complete();
+}
+
+template <class RelayHandler>
+template <class Tag>
+auto
+splice_relay_op<RelayHandler>::pump(Tag,
+                                    direction&                d,
+                                    boost::system::error_code ec,
+                                    std::size_t const         bytes_transferred) -> void
+{
+  using namespace std::placeholders;
+  using boost::beast::bind_handler;
+
+  namespace net = boost::asio;
+
+  auto& s = *p_;
+
+  s.server.deadline.progress(bytes_transferred);
+  BOOST_ASIO_CORO_REENTER(d.coro)
+  {
+    if (d.buffer.size() > 0) {
+      BOOST_ASIO_CORO_YIELD
+      net::async_write(d.dst, d.buffer.data(), bind_handler(*this, Tag{}, _1, _2));
+
+      if (ec) { goto upcall; }
+      d.buffer.consume(bytes_transferred);
+    }
+
+    while (true) {
+      // fill the pipe from the source socket, parking on read readiness whenever it's drained
+      //
+      while (true) {
+        {
+          auto const n = ::splice(d.src.native_handle(), nullptr, d.pipe.write_fd, nullptr,
+                                  chunk_size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+          if (n >= 0) {
+            d.pending = static_cast<std::size_t>(n);
+            s.server.deadline.progress(d.pending);
+            break;
+          }
+
+          if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            ec.assign(errno, boost::system::system_category());
+            goto upcall;
+          }
+        }
+
+        BOOST_ASIO_CORO_YIELD
+        d.src.async_wait(socket_type::wait_read, bind_handler(*this, Tag{}, _1, 0));
+
+        if (ec) { goto upcall; }
+      }
+
+      if (d.pending == 0) {
+        d.dst.shutdown(net::socket_base::shutdown_send, ec);
+        break;
+      }
+
+      // and then empty it into the destination one
+      //
+      while (d.pending > 0) {
+        {
+          auto const n = ::splice(d.pipe.read_fd, nullptr, d.dst.native_handle(), nullptr,
+                                  d.pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+          if (n > 0) {
+            d.pending -= static_cast<std::size_t>(n);
+            s.server.deadline.progress(static_cast<std::size_t>(n));
+            continue;
+          }
+
+          if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            ec.assign(errno, boost::system::system_category());
+            goto upcall;
+          }
+        }
+
+        BOOST_ASIO_CORO_YIELD
+        d.dst.async_wait(socket_type::wait_write, bind_handler(*this, Tag{}, _1, 0));
+
+        if (ec) { goto upcall; }
+      }
+    }
+
+    d.is_done = true;
+    if (s.up.is_done && s.down.is_done) { s.server.timer.cancel(); }
+    return complete();
+
+  upcall:
+    d.is_done = true;
+    abort(ec);
+    complete();
+  }
+}
+
+} // namespace detail
+} // namespace foxy
+
+#endif // defined(__linux__)
+
+#endif // FOXY_DETAIL_SPLICE_RELAY_HPP_
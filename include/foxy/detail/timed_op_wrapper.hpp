@@ -11,46 +11,39 @@
 #define FOXY_DETAIL_TIMED_OP_WRAPPER_HPP_
 
 #include <foxy/session.hpp>
-#include <foxy/shared_handler_ptr.hpp>
+#include <foxy/op_storage.hpp>
 #include <foxy/detail/close_stream.hpp>
 
-#include <boost/callable_traits/args.hpp>
-#include <boost/hof/unpack.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/error.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 
 namespace foxy
 {
 namespace detail
 {
+// timed_op_wrapper runs `Op` on a session under the session's timeout
+//
+// The wrapper doesn't allocate any state of its own. It carries the user's handler into `Op`, whose
+// state, like everything else started on the session's behalf, comes out of the session's
+// `storage`. Whether the operation is still running is tracked by `storage->timed_op`, which
+// outlives the session for as long as our timeout handler is queued.
+//
 template <class Stream, template <class, class...> class Op, class Handler, class Sig>
 struct timed_op_wrapper
 {
 private:
-  // our state needs to store the result type of the main operation because of the when_all delaying
-  // the execution of the final handler
-  //
-  struct state
-  {
-    using args_t = boost::callable_traits::args_t<Sig>;
-
-    args_t                         args;
-    ::foxy::basic_session<Stream>& session;
-    int                            ops;
-    boost::asio::coroutine         coro;
-    boost::asio::coroutine         timer_coro;
-    bool                           done;
-
-    boost::asio::executor_work_guard<decltype(session.get_executor())> work;
-
-    explicit state(Handler const& handler, ::foxy::basic_session<Stream>& session_)
-      : session(session_)
-      , ops{0}
-      , done{false}
-      , work(session.get_executor())
-    {
-    }
-  };
-
-  ::foxy::shared_handler_ptr<state, Handler> p_;
+  ::foxy::basic_session<Stream>* session_;
+  Handler                        handler_;
 
 public:
   timed_op_wrapper()                        = delete;
@@ -59,7 +52,8 @@ public:
 
   template <class DeducedHandler>
   timed_op_wrapper(::foxy::basic_session<Stream>& session, DeducedHandler&& handler)
-    : p_(std::forward<DeducedHandler>(handler), session)
+    : session_(std::addressof(session))
+    , handler_(std::forward<DeducedHandler>(handler))
   {
   }
 
@@ -70,112 +64,115 @@ public:
   auto
   get_executor() const noexcept -> executor_type
   {
-    return boost::asio::get_associated_executor(p_.handler(), p_->session.get_executor());
+    return boost::asio::get_associated_executor(handler_, session_->get_executor());
   }
 
-  using allocator_type = boost::asio::associated_allocator_t<Handler>;
+  using allocator_type = ::foxy::op_allocator<void>;
 
   auto
   get_allocator() const noexcept -> allocator_type
   {
-    return boost::asio::get_associated_allocator(p_.handler());
+    return allocator_type(session_->storage);
   }
 
-  template <class... Types, class... Args>
-  auto
-  init(Args&&... args) -> void
+private:
+  // reads and writes complete with the number of bytes they transferred, which counts towards the
+  // exchange's rate, everything else only completes with an error code
+  //
+  static auto
+  record_progress(session_deadline& deadline, boost::system::error_code, std::size_t const n)
+    -> void
   {
-    using boost::beast::bind_handler;
-    using namespace std::placeholders;
-
-    auto& s = *p_;
-    Op<Types..., typename std::decay<decltype(*this)>::type>(s.session, std::forward<Args>(args)...,
-                                                             *this)({}, 0, false);
-
-    s.session.timer.expires_after(s.session.opts.timeout);
-    s.session.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
-    (*this)(on_completion_t{}, {});
-
-    p_.reset();
+    deadline.progress(n);
   }
 
-  struct on_timer_t
-  {
-  };
-  struct on_completion_t
+  template <class... Args>
+  static auto
+  record_progress(session_deadline&, Args const&...) -> void
   {
-  };
+  }
 
-  auto
-  operator()(on_timer_t, boost::system::error_code ec) -> void
+  // timeout_handler is what waits on the session's timer
+  //
+  // It never gets to invoke the user's handler. Once the main operation has completed, whatever the
+  // timer completes with is simply dropped, without touching the session which may be long gone by
+  // then.
+  //
+  struct timeout_handler
   {
-    using namespace std::placeholders;
+    ::foxy::basic_session<Stream>*           session_;
+    boost::intrusive_ptr<::foxy::op_storage> storage_;
+    std::uint64_t                            timed_op_;
+    executor_type                            executor_;
 
-    auto& s = *p_;
-    BOOST_ASIO_CORO_REENTER(s.timer_coro)
+    auto
+    get_executor() const noexcept -> executor_type
     {
-      // this means the user called `expires_after` _or_ our timer was cancelled
-      //
-      while (ec == boost::asio::error::operation_aborted) {
-        // we know that we were cancelled if `p_->done` is true
-        // note that this implies a precondition that no one  else will be calling cancel on the
-        // timer
-        //
-        if (s.done) { break; }
-
-        // otherwise, the user likely updated the timer's expiration so we need to prolong the async
-        // operation accordingly
-        //
-        BOOST_ASIO_CORO_YIELD
-        s.session.timer.async_wait(boost::beast::bind_handler(*this, on_timer_t{}, _1));
-      }
+      return executor_;
     }
 
-    if (!s.timer_coro.is_complete()) { return; }
+    using allocator_type = ::foxy::op_allocator<void>;
 
-    s.ops++;
-    if (ec || s.done) { return (*this)(on_completion_t{}, {}); }
+    auto
+    get_allocator() const noexcept -> allocator_type
+    {
+      return allocator_type(storage_);
+    }
 
-    auto& stream =
-      s.session.stream.is_ssl() ? s.session.stream.ssl().next_layer() : s.session.stream.plain();
+    auto
+    operator()(boost::system::error_code ec) -> void
+    {
+      if (storage_->timed_op != timed_op_) { return; }
 
-    close(stream);
-    (*this)(on_completion_t{}, {});
-  }
+      auto& s = *session_;
 
-  template <class... Args>
+      // the operation is still running so the only one who could've cancelled us is the user
+      // updating the timer's expiration, in which case we keep waiting for the new one
+      // note that this implies a precondition that no one else will be calling cancel on the timer
+      //
+      if (ec == boost::asio::error::operation_aborted) {
+        return s.timer.async_wait(std::move(*this));
+      }
+
+      if (ec) { return; }
+
+      auto& stream = s.stream.is_ssl() ? s.stream.ssl().next_layer() : s.stream.plain();
+      close(stream);
+    }
+  };
+
+public:
+  template <class... Types, class... Args>
   auto
-  operator()(Args&&... args) -> void
+  init(Args&&... args) -> void
   {
-    p_->ops++;
+    auto& s = *session_;
 
-    p_->args = typename state::args_t(std::forward<Args>(args)...);
-    p_->done = true;
+    // the operation gets its own timeout but it can't outlive the exchange it's a part of
+    //
+    auto const expiry = std::min(session_deadline::clock_type::now() + s.opts.timeout,
+                                 s.deadline.expiry(s.opts.deadlines));
 
-    p_->session.timer.cancel();
+    s.timer.expires_at(expiry);
+    s.timer.async_wait(timeout_handler{session_, s.storage, ++s.storage->timed_op, get_executor()});
 
-    return (*this)(on_completion_t{}, {});
+    Op<Types..., timed_op_wrapper>(s, std::forward<Args>(args)..., std::move(*this))({}, 0, false);
   }
 
+  // the main operation completing is all we need to invoke the user's handler, there's no reason to
+  // wait for the cancelled timer to get back to us
+  //
+  template <class... Args>
   auto
-  operator()(on_completion_t, boost::system::error_code ec) -> void
+  operator()(Args&&... args) -> void
   {
-    namespace hof = boost::hof;
-
-    auto& s = *p_;
-    BOOST_ASIO_CORO_REENTER(s.coro)
-    {
-      while (s.ops < 2) { BOOST_ASIO_CORO_YIELD; }
-    }
-
-    if (!s.coro.is_complete()) { return; }
-
-    auto args = std::move(s.args);
-    auto work = std::move(s.work);
+    auto& s = *session_;
 
-    auto f = [&](auto&&... args) { p_.invoke(std::forward<decltype(args)>(args)...); };
+    ++s.storage->timed_op;
+    s.timer.cancel();
+    record_progress(s.deadline, args...);
 
-    hof::unpack(f)(std::move(args));
+    handler_(std::forward<Args>(args)...);
   }
 };
 
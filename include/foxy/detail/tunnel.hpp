@@ -12,9 +12,12 @@
 
 #include <foxy/client_session.hpp>
 #include <foxy/server_session.hpp>
+#include <foxy/message_arena.hpp>
 #include <foxy/type_traits.hpp>
 #include <foxy/uri_parts.hpp>
-#include <foxy/detail/relay.hpp>
+#include <foxy/upstream_pool.hpp>
+#include <foxy/detail/duplex_relay.hpp>
+#include <foxy/detail/opaque_relay.hpp>
 #include <foxy/detail/detect_ssl.hpp>
 
 #include <boost/beast/http/empty_body.hpp>
@@ -23,6 +26,8 @@
 #include <boost/beast/http/verb.hpp>
 #include <boost/beast/http/status.hpp>
 
+#include <boost/asio/ip/tcp.hpp>
+
 #include <boost/optional/optional.hpp>
 
 #include <iostream>
@@ -41,21 +46,38 @@ public:
 
   using allocator_type = boost::asio::associated_allocator_t<TunnelHandler>;
 
+  // the parsers and fields of every exchange come out of the arena, which is reset in between
+  // exchanges, this includes the ones the relay creates for the exchange
+  //
+  using fields_allocator_type = foxy::arena_allocator<char>;
+
 private:
   struct state
   {
     foxy::server_session& server;
     foxy::client_session& client;
+    foxy::upstream_pool&  pool;
+    foxy::message_arena&  arena;
+
+    // the pooled connection absolute-form requests are relayed over, it's held onto for as long as
+    // the client keeps sending requests for the same authority
+    //
+    foxy::upstream_pool::session_ptr upstream;
+    foxy::upstream_key               upstream_key;
 
     boost::optional<
-      boost::beast::http::request_parser<boost::beast::http::empty_body, allocator_type>>
+      boost::beast::http::request_parser<boost::beast::http::empty_body, fields_allocator_type>>
       parser;
 
-    boost::optional<boost::beast::http::response<boost::beast::http::string_body,
-                                                 boost::beast::http::basic_fields<allocator_type>>>
+    boost::optional<
+      boost::beast::http::response<boost::beast::http::string_body,
+                                   boost::beast::http::basic_fields<fields_allocator_type>>>
       response;
 
-    foxy::uri_parts uri_parts;
+    // the parts are offsets into the parser's target so they're as cheap to carry around as the
+    // flags below
+    //
+    foxy::compact_uri_parts uri_parts;
 
     boost::tribool is_ssl;
 
@@ -63,24 +85,21 @@ private:
     bool is_connect   = false;
     bool is_absolute  = false;
     bool is_http      = false;
+    bool is_warm      = false;
 
     bool close_tunnel = false;
 
     boost::asio::executor_work_guard<decltype(server.get_executor())> work;
 
-    explicit state(TunnelHandler const&  handler,
+    explicit state(TunnelHandler const&,
                    foxy::server_session& server_,
-                   foxy::client_session& client_)
+                   foxy::client_session& client_,
+                   foxy::upstream_pool&  pool_,
+                   foxy::message_arena&  arena_)
       : server(server_)
       , client(client_)
-      , parser(boost::in_place_init,
-               std::piecewise_construct,
-               std::make_tuple(),
-               std::make_tuple(boost::asio::get_associated_allocator(handler)))
-      , response(boost::in_place_init,
-                 std::piecewise_construct,
-                 std::make_tuple(boost::asio::get_associated_allocator(handler)),
-                 std::make_tuple(boost::asio::get_associated_allocator(handler)))
+      , pool(pool_)
+      , arena(arena_)
       , work(server.get_executor())
     {
     }
@@ -94,8 +113,12 @@ public:
   tunnel_op(tunnel_op&&)      = default;
 
   template <class DeducedHandler>
-  tunnel_op(foxy::server_session& server, foxy::client_session& client, DeducedHandler&& handler)
-    : p_(std::forward<DeducedHandler>(handler), server, client)
+  tunnel_op(foxy::server_session& server,
+            foxy::client_session& client,
+            foxy::upstream_pool&  pool,
+            foxy::message_arena&  arena,
+            DeducedHandler&&      handler)
+    : p_(std::forward<DeducedHandler>(handler), server, client, pool, arena)
   {
   }
 
@@ -111,6 +134,10 @@ public:
     return boost::asio::get_associated_allocator(p_.handler());
   }
 
+  struct on_acquire_t
+  {
+  };
+
   struct on_connect_t
   {
   };
@@ -123,11 +150,18 @@ public:
   {
   };
 
+  struct on_opaque_relay_t
+  {
+  };
+
   auto
   operator()(boost::system::error_code ec,
              std::size_t const         bytes_transferred,
              bool const                is_continuation = true) -> void;
 
+  auto
+  operator()(on_acquire_t, boost::system::error_code ec) -> void;
+
   auto
   operator()(on_connect_t, boost::system::error_code ec, boost::asio::ip::tcp::endpoint) -> void;
 
@@ -136,8 +170,18 @@ public:
 
   auto
   operator()(on_detect_t, boost::system::error_code ec, boost::tribool is_ssl_) -> void;
+
+  auto
+  operator()(on_opaque_relay_t, boost::system::error_code ec) -> void;
 };
 
+template <class TunnelHandler>
+auto
+tunnel_op<TunnelHandler>::operator()(on_acquire_t, boost::system::error_code ec) -> void
+{
+  (*this)(ec, 0);
+}
+
 template <class TunnelHandler>
 auto
 tunnel_op<TunnelHandler>::
@@ -148,8 +192,10 @@ operator()(on_connect_t, boost::system::error_code ec, boost::asio::ip::tcp::end
 
 template <class TunnelHandler>
 auto
-tunnel_op<TunnelHandler>::operator()(on_relay_t, boost::system::error_code ec, bool) -> void
+tunnel_op<TunnelHandler>::operator()(on_relay_t, boost::system::error_code ec, bool close_tunnel)
+  -> void
 {
+  p_->close_tunnel = close_tunnel;
   (*this)(ec, 0);
 }
 
@@ -162,6 +208,13 @@ operator()(on_detect_t, boost::system::error_code ec, boost::tribool is_ssl_) ->
   (*this)(ec, 0);
 }
 
+template <class TunnelHandler>
+auto
+tunnel_op<TunnelHandler>::operator()(on_opaque_relay_t, boost::system::error_code ec) -> void
+{
+  (*this)(ec, 0);
+}
+
 template <class TunnelHandler>
 auto
 tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
@@ -178,23 +231,34 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
   BOOST_ASIO_CORO_REENTER(*this)
   {
     while (true) {
+      // the previous exchange is over and so is everything it allocated from the arena
+      //
+      s.parser.reset();
+      s.response.reset();
+      s.arena.reset();
+
       s.parser.emplace(std::piecewise_construct, std::make_tuple(),
-                       std::make_tuple(get_allocator()));
+                       std::make_tuple(fields_allocator_type(s.arena)));
+
+      s.response.emplace(std::piecewise_construct, std::make_tuple(),
+                         std::make_tuple(fields_allocator_type(s.arena)));
 
-      s.response.emplace(std::piecewise_construct, std::make_tuple(get_allocator()),
-                         std::make_tuple(get_allocator()));
+      // every request the client sends starts a new exchange, the time spent waiting for it
+      // included
+      //
+      s.server.deadline.start();
 
       BOOST_ASIO_CORO_YIELD
       s.server.async_read_header(*s.parser, std::move(*this));
 
       if (ec) { goto upcall; }
 
-      s.uri_parts = foxy::parse_uri(s.parser->get().target());
+      s.uri_parts = foxy::parse_compact_uri(s.parser->get().target());
 
       s.is_authority = s.uri_parts.is_authority();
       s.is_connect   = s.parser->get().method() == http::verb::connect;
       s.is_absolute  = s.uri_parts.is_absolute();
-      s.is_http      = s.uri_parts.is_http();
+      s.is_http      = s.uri_parts.is_http(s.parser->get().target());
 
       if (s.is_connect && s.is_authority && !s.parser->keep_alive()) {
         s.close_tunnel = true;
@@ -211,22 +275,69 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
       }
 
       if ((s.is_connect && s.is_authority) || (s.is_absolute && s.is_http)) {
-        BOOST_ASIO_CORO_YIELD
         {
           auto const scheme =
             s.client.stream.is_ssl() ? boost::string_view("https") : boost::string_view("http");
 
-          auto port = s.uri_parts.port().size() == 0 ? static_cast<std::string>(scheme)
-                                                     : static_cast<std::string>(s.uri_parts.port());
+          auto const uri = s.parser->get().target();
+
+          auto key   = foxy::upstream_key();
+          key.scheme = static_cast<std::string>(scheme);
+          key.host   = static_cast<std::string>(s.uri_parts.host(uri));
+          key.port   = s.uri_parts.port(uri).size() == 0
+                       ? key.scheme
+                       : static_cast<std::string>(s.uri_parts.port(uri));
+
+          // the client moved on to a different authority so the connection held over from its
+          // previous request goes back to the pool for somebody else to use
+          //
+          if (s.upstream && (s.is_connect || !(key == s.upstream_key))) {
+            s.pool.release(s.upstream_key, std::move(s.upstream), true);
+          }
+
+          s.upstream_key = std::move(key);
+        }
 
-          s.client.async_connect(static_cast<std::string>(s.uri_parts.host()), std::move(port),
+        if (s.is_absolute && s.is_http) {
+          if (s.upstream && !foxy::upstream_pool::is_alive(*s.upstream)) {
+            s.pool.release(s.upstream_key, std::move(s.upstream), false);
+          }
+
+          s.is_warm = static_cast<bool>(s.upstream);
+          if (!s.upstream) {
+            BOOST_ASIO_CORO_YIELD
+            s.pool.async_acquire(s.upstream_key, s.upstream,
+                                 bind_handler(std::move(*this), on_acquire_t{}, _1));
+
+            // the pool hands out either a warm connection or a fresh session that's ours to
+            // connect
+            //
+            if (!ec) {
+              auto& socket = s.upstream->stream.is_ssl() ? s.upstream->stream.ssl().next_layer()
+                                                         : s.upstream->stream.plain();
+
+              s.is_warm = socket.is_open();
+            }
+          }
+
+          if (!ec && !s.is_warm) {
+            BOOST_ASIO_CORO_YIELD
+            s.upstream->async_connect(s.upstream_key.host, s.upstream_key.port,
+                                      bind_handler(std::move(*this), on_connect_t{}, _1, _2));
+          }
+
+        } else {
+          BOOST_ASIO_CORO_YIELD
+          s.client.async_connect(s.upstream_key.host, s.upstream_key.port,
                                  bind_handler(std::move(*this), on_connect_t{}, _1, _2));
         }
 
         if (ec) {
+          if (s.upstream) { s.pool.release(s.upstream_key, std::move(s.upstream), false); }
+
           s.response->result(http::status::bad_request);
           s.response->body() =
-            "Unable to connect to the remote at: " + static_cast<std::string>(s.uri_parts.host()) +
+            "Unable to connect to the remote at: " + s.upstream_key.host +
             "\nError code: " + ec.message() + "\n\n";
 
           s.response->prepare_payload();
@@ -236,9 +347,22 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
 
           if (ec) { goto upcall; }
           if (s.parser->get().keep_alive()) { continue; }
+
+          s.close_tunnel = true;
           break;
         }
 
+        // the relays write a header and its body separately, left to Nagle's algorithm the body
+        // would wait on the ACK for the header, which the peer is in no hurry to send
+        //
+        if (!(s.is_absolute && s.is_http) || !s.is_warm) {
+          auto& upstream = (s.is_absolute && s.is_http) ? s.upstream->stream : s.client.stream;
+          auto& socket   = upstream.is_ssl() ? upstream.ssl().next_layer() : upstream.plain();
+
+          auto ignored = boost::system::error_code();
+          socket.set_option(net::ip::tcp::no_delay(true), ignored);
+        }
+
       } else {
         s.response->result(http::status::bad_request);
         s.response->body() =
@@ -250,42 +374,51 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
 
         if (ec) { goto upcall; }
         if (s.parser.get().keep_alive()) { continue; }
+
+        s.close_tunnel = true;
         break;
       }
 
       if (s.is_absolute && s.is_http) {
-        s.parser->get().keep_alive(false);
-
         BOOST_ASIO_CORO_YIELD
         {
+          auto const uri = s.parser->get().target();
+
           auto const path =
-            s.uri_parts.path().size() == 0
+            s.uri_parts.path(uri).size() == 0
               ? (s.parser->get().method() == http::verb::options ? boost::string_view("*")
                                                                  : boost::string_view("/"))
-              : s.uri_parts.path();
+              : s.uri_parts.path(uri);
 
           auto target = static_cast<std::string>(path);
-          if (s.uri_parts.query().size() > 0) {
+          if (s.uri_parts.query(uri).size() > 0) {
             target += "?";
-            target += static_cast<std::string>(s.uri_parts.query());
+            target += static_cast<std::string>(s.uri_parts.query(uri));
           }
 
-          auto hostname = static_cast<std::string>(s.uri_parts.host());
-          if (s.uri_parts.port().size() > 0) {
+          auto hostname = static_cast<std::string>(s.uri_parts.host(uri));
+          if (s.uri_parts.port(uri).size() > 0) {
             hostname += ":";
-            hostname += static_cast<std::string>(s.uri_parts.port());
+            hostname += static_cast<std::string>(s.uri_parts.port(uri));
           }
 
           s.parser->get().target(target);
           s.parser->get().set(http::field::host, hostname);
 
-          async_relay(s.server, s.client, std::move(*s.parser),
-                      bind_handler(std::move(*this), on_relay_t{}, _1, _2));
+          async_duplex_relay(s.server, *s.upstream, std::move(*s.parser),
+                             bind_handler(std::move(*this), on_relay_t{}, _1, _2));
+        }
+
+        // the relay mirrors a `Connection: close` from either side onto the other so a relay that
+        // doesn't close the tunnel leaves both connections ready for another request
+        //
+        if (ec || s.close_tunnel) {
+          s.pool.release(s.upstream_key, std::move(s.upstream), false);
         }
 
         if (ec) { goto upcall; }
-        s.close_tunnel = true;
-        break;
+        if (s.close_tunnel) { break; }
+        continue;
       }
 
       s.response->result(http::status::ok);
@@ -306,15 +439,40 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
       BOOST_ASIO_CORO_YIELD
       async_detect_ssl(s.server.stream.plain(), s.server.buffer,
                        bind_handler(std::move(*this), on_detect_t{}, _1, _2));
+
+      if (ec) {
+        s.close_tunnel = true;
+        goto upcall;
+      }
+
+      // the client is negotiating TLS with the remote through us so there's no HTTP we'd be able
+      // to make sense of, all that's left to do is shovel bytes back and forth until both sides
+      // hang up
+      //
+      if (s.is_ssl) {
+        BOOST_ASIO_CORO_YIELD
+        async_opaque_relay(s.server, s.client,
+                           bind_handler(std::move(*this), on_opaque_relay_t{}, _1));
+
+        s.close_tunnel = true;
+        if (ec) { goto upcall; }
+      }
     }
 
     {
+      if (s.upstream) { s.pool.release(s.upstream_key, std::move(s.upstream), true); }
+
       auto const guard        = std::move(s.work);
       auto const close_tunnel = s.close_tunnel;
       return p_.invoke(boost::system::error_code(), close_tunnel);
     }
 
   upcall:
+    // a connection that's still held finished its last exchange cleanly, failed ones are released
+    // as soon as they fail
+    //
+    if (s.upstream) { s.pool.release(s.upstream_key, std::move(s.upstream), true); }
+
     if (!is_continuation) {
       BOOST_ASIO_CORO_YIELD
       net::post(bind_handler(std::move(*this), ec, 0));
@@ -327,7 +485,11 @@ tunnel_op<TunnelHandler>::operator()(boost::system::error_code ec,
 
 template <class TunnelHandler>
 auto
-async_tunnel(foxy::server_session& server, foxy::client_session& client, TunnelHandler&& handler) ->
+async_tunnel(foxy::server_session& server,
+             foxy::client_session& client,
+             foxy::upstream_pool&  pool,
+             foxy::message_arena&  arena,
+             TunnelHandler&&       handler) ->
   typename boost::asio::async_result<std::decay_t<TunnelHandler>,
                                      void(boost::system::error_code, bool)>::return_type
 {
@@ -335,7 +497,7 @@ async_tunnel(foxy::server_session& server, foxy::client_session& client, TunnelH
 
   tunnel_op<typename boost::asio::async_completion<
     TunnelHandler, void(boost::system::error_code, bool)>::completion_handler_type>(
-    server, client, std::move(init.completion_handler))({}, 0, false);
+    server, client, pool, arena, std::move(init.completion_handler))({}, 0, false);
 
   return init.result.get();
 }
@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DETAIL_WATCHDOG_HPP_
+#define FOXY_DETAIL_WATCHDOG_HPP_
+
+#include <foxy/session.hpp>
+#include <foxy/session_deadline.hpp>
+
+#include <algorithm>
+
+namespace foxy
+{
+namespace detail
+{
+// watchdog_expiry is when a relay has to give up on the exchange `session` is in unless more bytes
+// move before then
+//
+// The relays see every read and write so, unlike the session's own operations, they enforce the
+// idle timeout too. When none was set, the session's per-operation `timeout` is used instead.
+//
+template <class Stream>
+auto
+watchdog_expiry(::foxy::basic_session<Stream> const& session) -> session_deadline::time_point
+{
+  auto const& opts = session.opts;
+  auto const  idle =
+    opts.deadlines.idle > session_deadline::duration::zero() ? opts.deadlines.idle : opts.timeout;
+
+  return std::min(session.deadline.expiry(opts.deadlines), session.deadline.idle_expiry(idle));
+}
+
+} // namespace detail
+} // namespace foxy
+
+#endif // FOXY_DETAIL_WATCHDOG_HPP_
@@ -0,0 +1,364 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DNS_CACHE_HPP_
+#define FOXY_DNS_CACHE_HPP_
+
+#include <foxy/dns_resolver.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/beast/core/handler_ptr.hpp>
+
+#include <boost/container_hash/hash.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace foxy
+{
+// dns_cache_opts controls how long a `dns_cache` remembers the outcome of a lookup
+//
+// getaddrinfo doesn't report record TTLs so every successful lookup is kept for `ttl` and every
+// failed one for `negative_ttl`. At most `max_entries` lookups are cached, of which at most
+// `max_negative_entries` can be failures. Expired entries are purged once a limit is reached and if
+// that doesn't make room, the new outcome simply isn't cached.
+//
+// Misses go out to `resolver` when it's set and to `tcp::resolver` otherwise.
+//
+struct dns_cache_opts
+{
+  using duration_type = typename boost::asio::steady_timer::duration;
+
+  duration_type ttl                  = std::chrono::seconds{60};
+  duration_type negative_ttl         = std::chrono::seconds{5};
+  std::size_t   max_entries          = 4096;
+  std::size_t   max_negative_entries = 256;
+
+  std::shared_ptr<::foxy::dns_resolver> resolver = {};
+};
+
+// dns_cache_stats counts how lookups were answered
+//
+// `hits` and `negative_hits` were answered straight from the cache, `misses` went out to the
+// resolver and `coalesced` piggy-backed on a lookup for the same host that was already in-flight.
+//
+struct dns_cache_stats
+{
+  std::size_t hits          = 0;
+  std::size_t negative_hits = 0;
+  std::size_t misses        = 0;
+  std::size_t coalesced     = 0;
+};
+
+// dns_cache sits in front of `tcp::resolver` and is meant to be shared by every `client_session`
+// via `session_opts::dns_cache`, including sessions running on different threads
+//
+// Concurrent lookups for the same (host, service) are deduplicated, only the first one goes out to
+// the resolver and all of the others complete with its results on their own io_context. Should the
+// io_context of the first one shut down before the lookup finishes, the others start over.
+//
+struct dns_cache
+{
+public:
+  using results_type = boost::asio::ip::tcp::resolver::results_type;
+  using clock_type   = std::chrono::steady_clock;
+
+private:
+  using key_type = std::pair<std::string, std::string>;
+
+  // waiter is how a lookup that piggy-backs on another one learns of its outcome, the timer never
+  // expires on its own and is cancelled instead
+  //
+  // The wait is armed on the waiter's io_context after the waiter was published, which can be after
+  // the outcome is already known. `is_armed` and `is_complete` are guarded by the cache's mutex and
+  // whichever of the two is set last cancels the timer.
+  //
+  struct waiter
+  {
+    boost::asio::steady_timer timer;
+    boost::system::error_code ec;
+    results_type              results;
+    bool                      is_armed    = false;
+    bool                      is_complete = false;
+
+    explicit waiter(boost::asio::io_context& io);
+  };
+
+  struct entry
+  {
+    results_type              results;
+    boost::system::error_code ec;
+    clock_type::time_point    expiry;
+    bool                      is_pending = false;
+
+    std::vector<std::shared_ptr<waiter>> waiters;
+  };
+
+  enum class lookup_result
+  {
+    hit,
+    pending,
+    miss
+  };
+
+  template <class ResolveHandler>
+  struct wait_op
+  {
+    dns_cache&               cache;
+    key_type                 key;
+    boost::asio::io_context& io;
+    std::shared_ptr<waiter>  w;
+    ResolveHandler           handler;
+
+    using executor_type = boost::asio::associated_executor_t<
+      ResolveHandler,
+      decltype(std::declval<boost::asio::steady_timer&>().get_executor())>;
+
+    using allocator_type = boost::asio::associated_allocator_t<ResolveHandler>;
+
+    auto
+    get_executor() const noexcept -> executor_type
+    {
+      return boost::asio::get_associated_executor(handler, w->timer.get_executor());
+    }
+
+    auto
+    get_allocator() const noexcept -> allocator_type
+    {
+      return boost::asio::get_associated_allocator(handler);
+    }
+
+    auto
+    operator()(boost::system::error_code) -> void
+    {
+      auto const ec      = w->ec;
+      auto       results = std::move(w->results);
+
+      w.reset();
+
+      // whoever went out to the resolver gave up on the lookup before it finished, nothing we did
+      // so we try again ourselves
+      //
+      if (ec == boost::asio::error::operation_aborted) {
+        cache.async_resolve(io, std::move(key.first), std::move(key.second), std::move(handler));
+        return;
+      }
+
+      handler(ec, std::move(results));
+    }
+  };
+
+  template <class ResolveHandler>
+  struct resolve_op
+  {
+  private:
+    struct state
+    {
+      dns_cache&                     cache;
+      key_type                       key;
+      boost::asio::io_context&       io;
+      boost::asio::ip::tcp::resolver resolver;
+
+      boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
+
+      bool is_complete = false;
+
+      state(ResolveHandler const&, dns_cache& cache_, key_type key_, boost::asio::io_context& io_)
+        : cache(cache_)
+        , key(std::move(key_))
+        , io(io_)
+        , resolver(io_)
+        , work(io_.get_executor())
+      {
+      }
+
+      state(state const&) = delete;
+      state(state&&)      = delete;
+
+      // the op is only ever destroyed without completing when its io_context is stopped for good,
+      // the waiters behind it still need to hear that the key is no longer pending
+      //
+      ~state()
+      {
+        if (!is_complete) { cache.complete(key, boost::asio::error::operation_aborted, {}); }
+      }
+    };
+
+    boost::beast::handler_ptr<state, ResolveHandler> p_;
+
+  public:
+    resolve_op()                  = delete;
+    resolve_op(resolve_op const&) = default;
+    resolve_op(resolve_op&&)      = default;
+
+    template <class DeducedHandler>
+    resolve_op(dns_cache&               cache,
+               key_type                 key,
+               boost::asio::io_context& io,
+               DeducedHandler&&         handler)
+      : p_(std::forward<DeducedHandler>(handler), cache, std::move(key), io)
+    {
+    }
+
+    using executor_type =
+      boost::asio::associated_executor_t<ResolveHandler,
+                                         boost::asio::ip::tcp::resolver::executor_type>;
+
+    using allocator_type = boost::asio::associated_allocator_t<ResolveHandler>;
+
+    auto
+    get_executor() const noexcept -> executor_type
+    {
+      return boost::asio::get_associated_executor(p_.handler(), p_->resolver.get_executor());
+    }
+
+    auto
+    get_allocator() const noexcept -> allocator_type
+    {
+      return boost::asio::get_associated_allocator(p_.handler());
+    }
+
+    auto
+    init() -> void
+    {
+      auto& s = *p_;
+      if (s.cache.opts_.resolver) {
+        s.cache.opts_.resolver->async_resolve(s.io, s.key.first, s.key.second, std::move(*this));
+      } else {
+        s.resolver.async_resolve(s.key.first, s.key.second, std::move(*this));
+      }
+    }
+
+    auto
+    operator()(boost::system::error_code ec, results_type results) -> void
+    {
+      auto& s = *p_;
+      s.cache.complete(s.key, ec, results);
+      s.is_complete = true;
+
+      auto work = std::move(s.work);
+      p_.invoke(ec, std::move(results));
+    }
+  };
+
+  mutable std::mutex mtx_;
+  dns_cache_opts     opts_;
+  dns_cache_stats    stats_;
+  std::size_t        num_negative_ = 0;
+
+  std::unordered_map<key_type, entry, boost::hash<key_type>> entries_;
+
+  // lookup either answers from the cache, enqueues a waiter behind a pending lookup or marks the
+  // key as pending because the caller is now responsible for resolving it
+  //
+  auto
+  lookup(key_type const&            key,
+         boost::asio::io_context&   io,
+         boost::system::error_code& ec,
+         results_type&              results,
+         std::shared_ptr<waiter>&   w) -> lookup_result;
+
+  auto
+  complete(key_type const& key, boost::system::error_code ec, results_type const& results)
+    -> void;
+
+  // arm is called once the waiter's timer is waited on
+  //
+  auto
+  arm(std::shared_ptr<waiter> const& w) -> void;
+
+  auto
+  purge_expired(clock_type::time_point const now) -> void;
+
+public:
+  dns_cache(dns_cache const&) = delete;
+  dns_cache(dns_cache&&)      = delete;
+
+  explicit dns_cache(dns_cache_opts opts = {});
+
+  // async_resolve has the same semantics as `tcp::resolver::async_resolve` but only goes out to a
+  // resolver running on `io` when there's no cached or in-flight lookup it can use instead
+  //
+  template <class ResolveHandler>
+  auto
+  async_resolve(boost::asio::io_context& io,
+                std::string              host,
+                std::string              service,
+                ResolveHandler&&         handler) ->
+    typename boost::asio::async_result<std::decay_t<ResolveHandler>,
+                                       void(boost::system::error_code, results_type)>::return_type;
+
+  auto
+  stats() const -> dns_cache_stats;
+};
+
+template <class ResolveHandler>
+auto
+dns_cache::async_resolve(boost::asio::io_context& io,
+                         std::string              host,
+                         std::string              service,
+                         ResolveHandler&&         handler) ->
+  typename boost::asio::async_result<std::decay_t<ResolveHandler>,
+                                     void(boost::system::error_code, results_type)>::return_type
+{
+  using completion_handler_type = typename boost::asio::async_completion<
+    ResolveHandler, void(boost::system::error_code, results_type)>::completion_handler_type;
+
+  boost::asio::async_completion<ResolveHandler, void(boost::system::error_code, results_type)> init(
+    handler);
+
+  auto key = key_type(std::move(host), std::move(service));
+
+  auto ec      = boost::system::error_code();
+  auto results = results_type();
+  auto w       = std::shared_ptr<waiter>();
+
+  switch (lookup(key, io, ec, results, w)) {
+    case lookup_result::hit:
+      boost::asio::post(io, boost::beast::bind_handler(std::move(init.completion_handler), ec,
+                                                       std::move(results)));
+      break;
+
+    case lookup_result::pending:
+      w->timer.async_wait(wait_op<completion_handler_type>{
+        *this, std::move(key), io, w, std::move(init.completion_handler)});
+
+      arm(w);
+      break;
+
+    case lookup_result::miss:
+      resolve_op<completion_handler_type>(*this, std::move(key), io,
+                                          std::move(init.completion_handler))
+        .init();
+      break;
+  }
+
+  return init.result.get();
+}
+
+} // namespace foxy
+
+#endif // FOXY_DNS_CACHE_HPP_
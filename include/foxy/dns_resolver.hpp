@@ -0,0 +1,431 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_DNS_RESOLVER_HPP_
+#define FOXY_DNS_RESOLVER_HPP_
+
+#include <foxy/shared_handler_ptr.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/post.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace foxy
+{
+// dns_resolver_opts describes where a `dns_resolver` sends its queries
+//
+// When `nameservers` is left empty they're read from `resolv_conf` instead, along with the
+// `timeout:n` and `attempts:n` options found there. Every nameserver is tried in turn for each of
+// the `attempts`, with each try waiting `timeout` for an answer. Names listed in the `hosts` file
+// are answered without sending any queries, an empty path skips it altogether.
+//
+struct dns_resolver_opts
+{
+  using duration_type = typename boost::asio::steady_timer::duration;
+
+  std::vector<boost::asio::ip::udp::endpoint> nameservers = {};
+
+  duration_type timeout     = std::chrono::seconds{5};
+  std::size_t   attempts    = 2;
+  std::string   resolv_conf = "/etc/resolv.conf";
+  std::string   hosts       = "/etc/hosts";
+};
+
+// dns_resolver is a stub resolver that speaks DNS over UDP straight from the io_context a lookup is
+// started on so a slow nameserver only ever delays the lookups that are waiting on it
+//
+// The A and AAAA queries for a host are sent together and the IPv4 results are listed ahead of the
+// IPv6 ones. Services must either be numeric ports or one of "http" and "https". Truncated answers
+// aren't retried over TCP, whatever addresses fit into the UDP reply are used.
+//
+// A dns_resolver is immutable once constructed so it can be shared between threads but it has to
+// outlive every lookup started on it.
+//
+struct dns_resolver
+{
+public:
+  using results_type = boost::asio::ip::tcp::resolver::results_type;
+
+private:
+  static constexpr std::size_t max_message_size = 512;
+
+  struct query
+  {
+    std::vector<std::uint8_t> message;
+    std::uint16_t             id          = 0;
+    std::uint16_t             type        = 0;
+    bool                      is_answered = false;
+  };
+
+  enum class reply_status
+  {
+    ignored,
+    answered,
+    failed
+  };
+
+  template <class ResolveHandler>
+  struct query_op
+  {
+  private:
+    struct state
+    {
+      dns_resolver const&          resolver;
+      std::string                  host;
+      std::string                  service;
+      std::uint16_t                port;
+      boost::asio::ip::udp::socket socket;
+      boost::asio::steady_timer    timer;
+      std::array<query, 2>         queries;
+      std::vector<std::uint8_t>    reply;
+
+      // the IPv4 and IPv6 endpoints are kept apart so they can be listed in a fixed order
+      //
+      std::vector<boost::asio::ip::tcp::endpoint> endpoints[2];
+
+      boost::system::error_code ec;
+      std::size_t               attempt       = 0;
+      std::size_t               num_pending   = 0;
+      bool                      is_round_over = false;
+
+      boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
+
+      state(ResolveHandler const&,
+            dns_resolver const&      resolver_,
+            boost::asio::io_context& io,
+            std::string              host_,
+            std::string              service_,
+            std::uint16_t const      port_)
+        : resolver(resolver_)
+        , host(std::move(host_))
+        , service(std::move(service_))
+        , port(port_)
+        , socket(io)
+        , timer(io)
+        , reply(max_message_size)
+        , work(io.get_executor())
+      {
+      }
+    };
+
+    ::foxy::shared_handler_ptr<state, ResolveHandler, ::foxy::plain_count> p_;
+
+  public:
+    query_op()                = delete;
+    query_op(query_op const&) = default;
+    query_op(query_op&&)      = default;
+
+    template <class DeducedHandler>
+    query_op(dns_resolver const&      resolver,
+             boost::asio::io_context& io,
+             std::string              host,
+             std::string              service,
+             std::uint16_t const      port,
+             DeducedHandler&&         handler)
+      : p_(std::forward<DeducedHandler>(handler),
+           resolver,
+           io,
+           std::move(host),
+           std::move(service),
+           port)
+    {
+    }
+
+    using executor_type =
+      boost::asio::associated_executor_t<ResolveHandler,
+                                         boost::asio::ip::udp::socket::executor_type>;
+
+    using allocator_type = boost::asio::associated_allocator_t<ResolveHandler>;
+
+    auto
+    get_executor() const noexcept -> executor_type
+    {
+      return boost::asio::get_associated_executor(p_.handler(), p_->socket.get_executor());
+    }
+
+    auto
+    get_allocator() const noexcept -> allocator_type
+    {
+      return boost::asio::get_associated_allocator(p_.handler());
+    }
+
+    struct on_timer_t
+    {
+    };
+    struct on_receive_t
+    {
+    };
+    struct on_finish_t
+    {
+    };
+
+    auto
+    init() -> void
+    {
+      auto& s = *p_;
+
+      static constexpr std::uint16_t types[] = {1, 28};
+      for (std::size_t idx = 0; idx < s.queries.size(); ++idx) {
+        auto& q = s.queries[idx];
+        q.type  = types[idx];
+        q.id    = dns_resolver::make_id();
+
+        if (!dns_resolver::make_query(q.id, q.type, s.host, q.message)) {
+          s.ec = boost::asio::error::host_not_found;
+          return boost::asio::post(boost::beast::bind_handler(std::move(*this), on_finish_t{}));
+        }
+      }
+
+      if (!start_round()) {
+        return boost::asio::post(boost::beast::bind_handler(std::move(*this), on_finish_t{}));
+      }
+    }
+
+    // start_round (re)sends every query that's still unanswered to the next nameserver in line and
+    // waits for the replies or the timeout, whichever comes first
+    //
+    auto
+    start_round() -> bool
+    {
+      using namespace std::placeholders;
+      using boost::beast::bind_handler;
+
+      auto& s = *p_;
+
+      auto const& nameservers = s.resolver.opts_.nameservers;
+      while (s.attempt < nameservers.size() * s.resolver.opts_.attempts) {
+        auto const& nameserver = nameservers[s.attempt++ % nameservers.size()];
+
+        auto ec = boost::system::error_code();
+        s.socket.close(ec);
+        s.socket.open(nameserver.protocol(), ec);
+        if (!ec) { s.socket.non_blocking(true, ec); }
+        if (!ec) { s.socket.connect(nameserver, ec); }
+        if (ec) {
+          s.ec = ec;
+          continue;
+        }
+
+        // a send that would block is no different from a datagram lost on the way, the timeout
+        // takes care of both
+        //
+        for (auto const& q : s.queries) {
+          if (q.is_answered) { continue; }
+          s.socket.send(boost::asio::buffer(q.message), 0, ec);
+        }
+
+        s.is_round_over = false;
+        s.num_pending   = 2;
+
+        s.timer.expires_after(s.resolver.opts_.timeout);
+        s.timer.async_wait(bind_handler(*this, on_timer_t{}, _1));
+        s.socket.async_receive(boost::asio::buffer(s.reply),
+                               bind_handler(*this, on_receive_t{}, _1, _2));
+
+        return true;
+      }
+
+      if (!s.ec) { s.ec = boost::asio::error::timed_out; }
+      return false;
+    }
+
+    auto
+    operator()(on_timer_t, boost::system::error_code) -> void
+    {
+      auto& s = *p_;
+      --s.num_pending;
+
+      if (!s.is_round_over) {
+        s.is_round_over = true;
+
+        auto ec = boost::system::error_code();
+        s.socket.cancel(ec);
+      }
+
+      end_round();
+    }
+
+    auto
+    operator()(on_receive_t, boost::system::error_code ec, std::size_t const bytes_transferred)
+      -> void
+    {
+      using namespace std::placeholders;
+      using boost::beast::bind_handler;
+
+      auto& s = *p_;
+      if (!ec && !s.is_round_over) {
+        auto const status = s.resolver.on_reply(boost::asio::buffer(s.reply, bytes_transferred),
+                                                s.queries, s.endpoints, s.port, s.ec);
+
+        if (status != reply_status::failed && !is_complete()) {
+          return s.socket.async_receive(boost::asio::buffer(s.reply),
+                                        bind_handler(*this, on_receive_t{}, _1, _2));
+        }
+      }
+
+      --s.num_pending;
+      if (!s.is_round_over) {
+        s.is_round_over = true;
+        s.timer.cancel();
+      }
+
+      end_round();
+    }
+
+    // end_round moves on to the next nameserver once both the timer and the receive have finished
+    // and finishes the lookup once there's nothing left to try
+    //
+    auto
+    end_round() -> void
+    {
+      if (p_->num_pending > 0) { return; }
+      if (is_complete() || !start_round()) { (*this)(on_finish_t{}); }
+    }
+
+    auto
+    is_complete() const -> bool
+    {
+      auto const& queries = p_->queries;
+      return std::all_of(queries.begin(), queries.end(),
+                         [](auto const& q) { return q.is_answered; });
+    }
+
+    auto
+    operator()(on_finish_t) -> void
+    {
+      auto& s = *p_;
+
+      auto endpoints = std::move(s.endpoints[0]);
+      endpoints.insert(endpoints.end(), s.endpoints[1].begin(), s.endpoints[1].end());
+
+      auto ec = endpoints.empty() ? s.ec : boost::system::error_code();
+      if (endpoints.empty() && !ec) { ec = boost::asio::error::host_not_found; }
+
+      auto results = results_type::create(endpoints.begin(), endpoints.end(), s.host, s.service);
+
+      auto work = std::move(s.work);
+      p_.invoke(ec, std::move(results));
+    }
+  };
+
+  dns_resolver_opts opts_;
+
+  std::unordered_map<std::string, std::vector<boost::asio::ip::address>> hosts_;
+
+  auto
+  load_resolv_conf() -> void;
+
+  auto
+  load_hosts() -> void;
+
+  // resolve_locally answers lookups that don't need any queries, numeric hosts and the names found
+  // in the hosts file, and converts the service into a port
+  //
+  auto
+  resolve_locally(std::string const&         host,
+                  std::string const&         service,
+                  std::uint16_t&             port,
+                  boost::system::error_code& ec,
+                  results_type&              results) const -> bool;
+
+  auto
+  on_reply(boost::asio::const_buffer                   reply,
+           std::array<query, 2>&                       queries,
+           std::vector<boost::asio::ip::tcp::endpoint> (&endpoints)[2],
+           std::uint16_t const                         port,
+           boost::system::error_code&                  ec) const -> reply_status;
+
+  static auto
+  make_id() -> std::uint16_t;
+
+  static auto
+  make_query(std::uint16_t const         id,
+             std::uint16_t const         type,
+             std::string const&          host,
+             std::vector<std::uint8_t>& message) -> bool;
+
+public:
+  dns_resolver(dns_resolver const&) = delete;
+  dns_resolver(dns_resolver&&)      = delete;
+
+  explicit dns_resolver(dns_resolver_opts opts = {});
+
+  // async_resolve has the same semantics as `tcp::resolver::async_resolve`, the lookup runs on `io`
+  //
+  template <class ResolveHandler>
+  auto
+  async_resolve(boost::asio::io_context& io,
+                std::string              host,
+                std::string              service,
+                ResolveHandler&&         handler) const ->
+    typename boost::asio::async_result<std::decay_t<ResolveHandler>,
+                                       void(boost::system::error_code, results_type)>::return_type;
+
+  // opts returns the options in effect, i.e. including whatever was read from `resolv_conf`
+  //
+  auto
+  opts() const noexcept -> dns_resolver_opts const&;
+};
+
+template <class ResolveHandler>
+auto
+dns_resolver::async_resolve(boost::asio::io_context& io,
+                            std::string              host,
+                            std::string              service,
+                            ResolveHandler&&         handler) const ->
+  typename boost::asio::async_result<std::decay_t<ResolveHandler>,
+                                     void(boost::system::error_code, results_type)>::return_type
+{
+  using completion_handler_type = typename boost::asio::async_completion<
+    ResolveHandler, void(boost::system::error_code, results_type)>::completion_handler_type;
+
+  boost::asio::async_completion<ResolveHandler, void(boost::system::error_code, results_type)> init(
+    handler);
+
+  auto port    = std::uint16_t{0};
+  auto ec      = boost::system::error_code();
+  auto results = results_type();
+
+  if (resolve_locally(host, service, port, ec, results)) {
+    boost::asio::post(io, boost::beast::bind_handler(std::move(init.completion_handler), ec,
+                                                     std::move(results)));
+  } else {
+    query_op<completion_handler_type>(*this, io, std::move(host), std::move(service), port,
+                                      std::move(init.completion_handler))
+      .init();
+  }
+
+  return init.result.get();
+}
+
+} // namespace foxy
+
+#endif // FOXY_DNS_RESOLVER_HPP_
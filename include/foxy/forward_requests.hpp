@@ -0,0 +1,233 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_FORWARD_REQUESTS_HPP_
+#define FOXY_FORWARD_REQUESTS_HPP_
+
+#include <foxy/awaitable.hpp>
+
+#ifdef FOXY_HAS_CO_AWAIT
+
+#include <foxy/client_session.hpp>
+#include <foxy/server_session.hpp>
+#include <foxy/uri_parts.hpp>
+#include <foxy/upstream_pool.hpp>
+#include <foxy/detail/export_connect_fields.hpp>
+#include <foxy/detail/has_token.hpp>
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/fields.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/parser.hpp>
+#include <boost/beast/http/status.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/http/verb.hpp>
+
+#include <boost/optional/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+
+#include <string>
+
+namespace foxy
+{
+// forward_requests is a coroutine that does for a single client what the proxy does for
+// absolute-form requests
+//
+// Every request read from `server` is relayed to the origin its target names, over a client
+// session created from `client_opts` that's kept around for as long as the requests stay with the
+// same authority and the origin keeps the connection open. Unlike the proxy's relay, messages are
+// read in full before they're forwarded so their bodies have to fit in memory. Nothing but beast's
+// body limit bounds how much that is, 1 MB for a request and 8 MB for a response by default, and a
+// chunked body is only checked against it as it arrives. Anything other than an absolute-form HTTP
+// request is answered with a 400 and an origin that can't be reached or fails to answer with a 502.
+//
+// The coroutine returns once either side ends the connection, any other error is thrown.
+//
+// Pass `client_opts` as a named object. GCC mishandles a braced temporary like `{}` initializing
+// a coroutine's by-value parameter, destroying the parameter's copy then frees memory the copy
+// doesn't own.
+//
+inline auto
+forward_requests(server_session& server, session_opts client_opts) -> ::foxy::awaitable<void>
+{
+  namespace http = boost::beast::http;
+
+  auto&      io  = detail::io_context_of(server.get_executor());
+  auto const via = detail::via_entry(client_opts.relay.via);
+
+  auto client    = boost::optional<client_session>();
+  auto authority = std::string();
+
+  auto const error_response = [](http::status const status, std::string body,
+                                 bool const keep_alive) {
+    auto response   = http::response<http::string_body>(status, 11);
+    response.body() = std::move(body);
+    response.keep_alive(keep_alive);
+    response.prepare_payload();
+    return response;
+  };
+
+  while (true) {
+    // every request the client sends starts a new exchange, the time spent waiting for it included
+    //
+    server.deadline.start();
+
+    auto ec     = boost::system::error_code();
+    auto parser = http::request_parser<http::string_body>();
+
+    try {
+      co_await server.async_read(parser);
+    }
+    catch (boost::system::system_error const& e) {
+      ec = e.code();
+    }
+
+    if (ec == http::error::end_of_stream) { co_return; }
+    if (ec) { throw boost::system::system_error(ec); }
+
+    auto       request    = parser.release();
+    auto const keep_alive = request.keep_alive();
+    auto const uri        = parse_uri(request.target());
+
+    if (!uri.is_absolute() || !uri.is_http() || request.method() == http::verb::connect ||
+        detail::has_foxy_via(request, via)) {
+      auto response = error_response(http::status::bad_request,
+                                     "Malformed client request. Use <verb> <absolute-uri>\n\n",
+                                     keep_alive);
+
+      co_await server.async_write(response);
+      if (!keep_alive) { co_return; }
+      continue;
+    }
+
+    // the views into the target are only good until the target's rewritten
+    //
+    auto const host = static_cast<std::string>(uri.host());
+    auto const port = static_cast<std::string>(uri.port().empty() ? uri.scheme() : uri.port());
+
+    auto target = static_cast<std::string>(uri.path().empty() ? "/" : uri.path());
+    if (!uri.query().empty()) {
+      target += "?";
+      target += static_cast<std::string>(uri.query());
+    }
+
+    auto hostname = host;
+    if (!uri.port().empty()) {
+      hostname += ":";
+      hostname += port;
+    }
+
+    if (client && (authority != hostname || !upstream_pool::is_alive(*client))) {
+      client.reset();
+      authority.clear();
+    }
+
+    if (!client) {
+      client.emplace(io, client_opts);
+
+      try {
+        co_await client->async_connect(host, port);
+      }
+      catch (boost::system::system_error const& e) {
+        ec = e.code();
+      }
+
+      if (ec) {
+        client.reset();
+
+        auto response = error_response(
+          http::status::bad_gateway,
+          "Unable to connect to the remote at: " + host + "\nError code: " + ec.message() + "\n\n",
+          keep_alive);
+
+        co_await server.async_write(response);
+        if (!keep_alive) { co_return; }
+        continue;
+      }
+
+      authority = hostname;
+
+      auto& socket = client->stream.is_ssl() ? client->stream.ssl().next_layer()
+                                             : client->stream.plain();
+
+      auto ignored = boost::system::error_code();
+      socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+    }
+
+    auto       hop_by_hop = http::fields();
+    auto const is_head    = request.method() == http::verb::head;
+
+    request.target(target);
+    request.set(http::field::host, hostname);
+    detail::export_connect_fields(request, hop_by_hop);
+    request.insert(http::field::via, via);
+    request.prepare_payload();
+
+    // the response to a HEAD describes a body that never follows
+    //
+    auto res_parser = http::response_parser<http::string_body>();
+    res_parser.skip(is_head);
+
+    try {
+      co_await client->async_request(request, res_parser);
+    }
+    catch (boost::system::system_error const& e) {
+      ec = e.code();
+    }
+
+    if (ec) {
+      client.reset();
+      authority.clear();
+
+      auto response = error_response(
+        http::status::bad_gateway,
+        "Unable to relay the request to the remote at: " + host + "\nError code: " + ec.message() +
+          "\n\n",
+        keep_alive);
+
+      co_await server.async_write(response);
+      if (!keep_alive) { co_return; }
+      continue;
+    }
+
+    auto       response      = res_parser.release();
+    auto const is_persistent = response.keep_alive();
+    auto const status        = response.result_int();
+
+    hop_by_hop.clear();
+    detail::export_connect_fields(response, hop_by_hop);
+    response.insert(http::field::via, via);
+    response.keep_alive(keep_alive);
+
+    // Transfer-Encoding went with the hop-by-hops so the framing is recomputed for the body we've
+    // buffered, the responses that never carry one keep the origin's Content-Length as is
+    //
+    auto const has_body = !is_head && status >= 200 && status != 204 && status != 304;
+    if (has_body) { response.prepare_payload(); }
+
+    co_await server.async_write(response);
+
+    if (!is_persistent) {
+      client.reset();
+      authority.clear();
+    }
+
+    if (!keep_alive) { co_return; }
+  }
+}
+
+} // namespace foxy
+
+#endif // FOXY_HAS_CO_AWAIT
+
+#endif // FOXY_FORWARD_REQUESTS_HPP_
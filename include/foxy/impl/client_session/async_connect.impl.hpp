@@ -11,7 +11,10 @@
 #define FOXY_IMPL_CLIENT_SESSION_ASYNC_CONNECT_IMPL_HPP_
 
 #include <foxy/client_session.hpp>
+#include <foxy/dns_cache.hpp>
+#include <foxy/dns_resolver.hpp>
 #include <foxy/type_traits.hpp>
+#include <foxy/detail/race_connect.hpp>
 
 namespace foxy
 {
@@ -141,8 +144,19 @@ connect_op<ConnectHandler>::operator()(boost::system::error_code ec,
     }
 
     BOOST_ASIO_CORO_YIELD
-    s.resolver.async_resolve(s.host, s.service,
-                             bind_handler(std::move(*this), on_resolve_t{}, _1, _2));
+    {
+      auto& opts = s.session.opts;
+      if (opts.dns_cache) {
+        opts.dns_cache->async_resolve(s.resolver.get_executor().context(), s.host, s.service,
+                                      bind_handler(std::move(*this), on_resolve_t{}, _1, _2));
+      } else if (opts.dns_resolver) {
+        opts.dns_resolver->async_resolve(s.resolver.get_executor().context(), s.host, s.service,
+                                         bind_handler(std::move(*this), on_resolve_t{}, _1, _2));
+      } else {
+        s.resolver.async_resolve(s.host, s.service,
+                                 bind_handler(std::move(*this), on_resolve_t{}, _1, _2));
+      }
+    }
 
     if (ec) { goto upcall; }
 
@@ -150,8 +164,9 @@ connect_op<ConnectHandler>::operator()(boost::system::error_code ec,
     {
       auto& socket =
         s.session.stream.is_ssl() ? s.session.stream.ssl().next_layer() : s.session.stream.plain();
-      boost::asio::async_connect(socket, s.results,
-                                 bind_handler(std::move(*this), on_connect_t{}, _1, _2));
+      ::foxy::detail::async_race_connect(socket, s.results, s.session.opts.connect_delay,
+                                         s.session.timer.expiry(),
+                                         bind_handler(std::move(*this), on_connect_t{}, _1, _2));
     }
 
     if (ec) { goto upcall; }
@@ -205,6 +220,23 @@ client_session::async_connect(std::string host, std::string service, ConnectHand
   return init.result.get();
 }
 
+#ifdef FOXY_HAS_CO_AWAIT
+
+inline auto
+client_session::async_connect(std::string host, std::string service) &
+  -> ::foxy::awaitable<boost::asio::ip::tcp::endpoint>
+{
+  using signature_type = void(boost::system::error_code, boost::asio::ip::tcp::endpoint);
+
+  return boost::asio::async_initiate<boost::asio::use_awaitable_t<> const&, signature_type>(
+    [this](auto handler, std::string host, std::string service) {
+      this->async_connect(std::move(host), std::move(service), std::move(handler));
+    },
+    boost::asio::use_awaitable, std::move(host), std::move(service));
+}
+
+#endif // FOXY_HAS_CO_AWAIT
+
 } // namespace foxy
 
 #endif // FOXY_IMPL_CLIENT_SESSION_ASYNC_CONNECT_IMPL_HPP_
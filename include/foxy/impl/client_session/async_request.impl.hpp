@@ -129,6 +129,10 @@ client_session::async_request(Request&         request,
 {
   boost::asio::async_completion<RequestHandler, void(boost::system::error_code)> init(handler);
 
+  // a request and its response make up one whole exchange
+  //
+  deadline.start();
+
   detail::timed_op_wrapper<
     boost::asio::ip::tcp::socket, detail::request_op,
     typename boost::asio::async_completion<
@@ -139,6 +143,22 @@ client_session::async_request(Request&         request,
   return init.result.get();
 }
 
+#ifdef FOXY_HAS_CO_AWAIT
+
+template <class Request, class ResponseParser>
+auto
+client_session::async_request(Request& request, ResponseParser& parser) & -> ::foxy::awaitable<void>
+{
+  return boost::asio::async_initiate<boost::asio::use_awaitable_t<> const&,
+                                     void(boost::system::error_code)>(
+    [this, &request, &parser](auto handler) {
+      this->async_request(request, parser, std::move(handler));
+    },
+    boost::asio::use_awaitable);
+}
+
+#endif // FOXY_HAS_CO_AWAIT
+
 } // namespace foxy
 
 #endif // FOXY_IMPL_CLIENT_SESSION_ASYNC_REQUEST_IMPL_HPP_
@@ -15,12 +15,16 @@
 
 namespace foxy
 {
+template <class Stream, class X>
+constexpr bool basic_session<Stream, X>::is_concurrent;
+
 template <class Stream, class X>
 foxy::basic_session<Stream, X>::basic_session(boost::asio::io_context& io,
                                               session_opts             opts_)
   : opts(std::move(opts_))
   , stream(opts.ssl_ctx ? stream_type(io, *opts.ssl_ctx) : stream_type(io))
-  , timer(io)
+  , timer(io, opts.use_timer_wheel && !is_concurrent)
+  , storage(new op_storage(is_concurrent))
 {
 }
 
@@ -29,7 +33,8 @@ foxy::basic_session<Stream, X>::basic_session(stream_type  stream_,
                                               session_opts opts_)
   : opts(std::move(opts_))
   , stream(std::move(stream_))
-  , timer(stream.get_executor().context())
+  , timer(detail::io_context_of(stream.get_executor()), opts.use_timer_wheel && !is_concurrent)
+  , storage(new op_storage(is_concurrent))
 {
 }
 
@@ -40,6 +45,58 @@ foxy::basic_session<Stream, X>::get_executor() -> executor_type
   return stream.get_executor();
 }
 
+#ifdef FOXY_HAS_CO_AWAIT
+
+template <class Stream, class X>
+template <class Parser>
+auto
+foxy::basic_session<Stream, X>::async_read_header(Parser& parser) &
+  -> ::foxy::awaitable<std::size_t>
+{
+  return boost::asio::async_initiate<boost::asio::use_awaitable_t<> const&,
+                                     void(boost::system::error_code, std::size_t)>(
+    [this, &parser](auto handler) { this->async_read_header(parser, std::move(handler)); },
+    boost::asio::use_awaitable);
+}
+
+template <class Stream, class X>
+template <class Parser>
+auto
+foxy::basic_session<Stream, X>::async_read(Parser& parser) &
+  -> ::foxy::awaitable<std::size_t>
+{
+  return boost::asio::async_initiate<boost::asio::use_awaitable_t<> const&,
+                                     void(boost::system::error_code, std::size_t)>(
+    [this, &parser](auto handler) { this->async_read(parser, std::move(handler)); },
+    boost::asio::use_awaitable);
+}
+
+template <class Stream, class X>
+template <class Serializer>
+auto
+foxy::basic_session<Stream, X>::async_write_header(Serializer& serializer) &
+  -> ::foxy::awaitable<std::size_t>
+{
+  return boost::asio::async_initiate<boost::asio::use_awaitable_t<> const&,
+                                     void(boost::system::error_code, std::size_t)>(
+    [this, &serializer](auto handler) { this->async_write_header(serializer, std::move(handler)); },
+    boost::asio::use_awaitable);
+}
+
+template <class Stream, class X>
+template <class Serializer>
+auto
+foxy::basic_session<Stream, X>::async_write(Serializer& serializer) &
+  -> ::foxy::awaitable<std::size_t>
+{
+  return boost::asio::async_initiate<boost::asio::use_awaitable_t<> const&,
+                                     void(boost::system::error_code, std::size_t)>(
+    [this, &serializer](auto handler) { this->async_write(serializer, std::move(handler)); },
+    boost::asio::use_awaitable);
+}
+
+#endif // FOXY_HAS_CO_AWAIT
+
 } // namespace foxy
 
 #include <foxy/detail/timed_op_wrapper.hpp>
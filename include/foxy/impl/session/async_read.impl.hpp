@@ -26,14 +26,11 @@ private:
     ::foxy::basic_session<Stream>& session;
     Parser&                        parser;
 
-    boost::asio::executor_work_guard<decltype(session.get_executor())> work;
-
     explicit state(ReadHandler const&             handler,
                    ::foxy::basic_session<Stream>& session_,
                    Parser&                        parser_)
       : session(session_)
       , parser(parser_)
-      , work(session.get_executor())
     {
     }
   };
@@ -99,17 +96,13 @@ operator()(boost::system::error_code ec,
 
     if (ec) { goto upcall; }
 
-    {
-      auto work = std::move(s.work);
-      return p_.invoke(boost::system::error_code(), bytes_transferred);
-    }
+    return p_.invoke(boost::system::error_code(), bytes_transferred);
 
   upcall:
     if (!is_continuation) {
       BOOST_ASIO_CORO_YIELD
       boost::asio::post(bind_handler(std::move(*this), ec, 0));
     }
-    auto work = std::move(s.work);
     p_.invoke(ec, 0);
   }
 }
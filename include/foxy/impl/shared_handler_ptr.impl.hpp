@@ -18,10 +18,10 @@
 
 namespace foxy {
 
-template<class T, class Handler>
+template<class T, class Handler, class Count>
 template<class DeducedHandler, class... Args>
 inline
-shared_handler_ptr<T, Handler>::P::
+shared_handler_ptr<T, Handler, Count>::P::
 P(DeducedHandler&& h, Args&&... args)
     : n(1)
     , handler(std::forward<DeducedHandler>(h))
@@ -44,8 +44,8 @@ P(DeducedHandler&& h, Args&&... args)
     }
 }
 
-template<class T, class Handler>
-shared_handler_ptr<T, Handler>::
+template<class T, class Handler, class Count>
+shared_handler_ptr<T, Handler, Count>::
 ~shared_handler_ptr()
 {
     if(! p_)
@@ -66,16 +66,16 @@ shared_handler_ptr<T, Handler>::
     delete p_;
 }
 
-template<class T, class Handler>
-shared_handler_ptr<T, Handler>::
+template<class T, class Handler, class Count>
+shared_handler_ptr<T, Handler, Count>::
 shared_handler_ptr(shared_handler_ptr&& other)
     : p_(other.p_)
 {
     other.p_ = nullptr;
 }
 
-template<class T, class Handler>
-shared_handler_ptr<T, Handler>::
+template<class T, class Handler, class Count>
+shared_handler_ptr<T, Handler, Count>::
 shared_handler_ptr(shared_handler_ptr const& other)
     : p_(other.p_)
 {
@@ -83,9 +83,9 @@ shared_handler_ptr(shared_handler_ptr const& other)
         ++p_->n;
 }
 
-template<class T, class Handler>
+template<class T, class Handler, class Count>
 template<class... Args>
-shared_handler_ptr<T, Handler>::
+shared_handler_ptr<T, Handler, Count>::
 shared_handler_ptr(Handler&& handler, Args&&... args)
     : p_(new P{std::move(handler),
         std::forward<Args>(args)...})
@@ -93,18 +93,18 @@ shared_handler_ptr(Handler&& handler, Args&&... args)
     BOOST_STATIC_ASSERT(! std::is_array<T>::value);
 }
 
-template<class T, class Handler>
+template<class T, class Handler, class Count>
 template<class... Args>
-shared_handler_ptr<T, Handler>::
+shared_handler_ptr<T, Handler, Count>::
 shared_handler_ptr(Handler const& handler, Args&&... args)
     : p_(new P{handler, std::forward<Args>(args)...})
 {
     BOOST_STATIC_ASSERT(! std::is_array<T>::value);
 }
 
-template<class T, class Handler>
+template<class T, class Handler, class Count>
 auto
-shared_handler_ptr<T, Handler>::
+shared_handler_ptr<T, Handler, Count>::
 release_handler() ->
     handler_type
 {
@@ -122,10 +122,10 @@ release_handler() ->
     return std::move(p_->handler);
 }
 
-template<class T, class Handler>
+template<class T, class Handler, class Count>
 template<class... Args>
 void
-shared_handler_ptr<T, Handler>::
+shared_handler_ptr<T, Handler, Count>::
 invoke(Args&&... args)
 {
     BOOST_ASSERT(p_);
@@ -142,9 +142,9 @@ invoke(Args&&... args)
     p_->handler(std::forward<Args>(args)...);
 }
 
-template<class T, class Handler>
+template<class T, class Handler, class Count>
 void
-shared_handler_ptr<T, Handler>::
+shared_handler_ptr<T, Handler, Count>::
 reset() noexcept
 {
     auto const old = --(p_->n);
@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_MESSAGE_ARENA_HPP_
+#define FOXY_MESSAGE_ARENA_HPP_
+
+#include <cstddef>
+
+namespace foxy
+{
+// message_arena is a monotonic arena for the headers of one request/response exchange
+//
+// Allocating is a matter of bumping an offset and deallocating only takes back the most recent
+// allocation, everything else is reclaimed once the exchange is over and the arena is `reset()`.
+// Inserting and erasing fields thus never touches the heap while an exchange is in progress.
+//
+// Whenever an exchange outgrew the arena, `reset()` replaces its chunks with a single one that's as
+// large as all of them together so the next exchange of the same size fits in one go. A connection
+// that keeps sending similar requests stops allocating after its first few exchanges.
+//
+// Resetting the arena while anything allocated from it is still alive is undefined behavior.
+//
+struct message_arena
+{
+private:
+  struct chunk;
+
+  chunk*            head_;
+  std::size_t const initial_capacity_;
+
+  auto
+  push_chunk(std::size_t const capacity) -> void;
+
+  auto
+  free_chunks() noexcept -> void;
+
+public:
+  static constexpr std::size_t default_capacity = 4096;
+
+  message_arena(message_arena const&) = delete;
+  message_arena& operator=(message_arena const&) = delete;
+
+  explicit message_arena(std::size_t const initial_capacity = default_capacity);
+  ~message_arena();
+
+  auto
+  allocate(std::size_t const size, std::size_t const alignment) -> void*;
+
+  auto
+  deallocate(void* p, std::size_t const size) noexcept -> void;
+
+  auto
+  reset() -> void;
+
+  // capacity is the number of bytes the arena can hand out before it has to go to the heap again
+  //
+  auto
+  capacity() const noexcept -> std::size_t;
+};
+
+// arena_allocator allocates from a `message_arena`, the arena has to outlive every container that
+// uses it
+//
+template <class T>
+struct arena_allocator
+{
+public:
+  using value_type = T;
+
+  template <class U>
+  struct rebind
+  {
+    using other = arena_allocator<U>;
+  };
+
+private:
+  template <class U>
+  friend struct arena_allocator;
+
+  message_arena* arena_;
+
+public:
+  explicit arena_allocator(message_arena& arena) noexcept
+    : arena_(&arena)
+  {
+  }
+
+  template <class U>
+  arena_allocator(arena_allocator<U> const& other) noexcept
+    : arena_(other.arena_)
+  {
+  }
+
+  auto
+  allocate(std::size_t const n) -> T*
+  {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  auto
+  deallocate(T* p, std::size_t const n) noexcept -> void
+  {
+    arena_->deallocate(p, n * sizeof(T));
+  }
+
+  template <class U>
+  auto
+  operator==(arena_allocator<U> const& other) const noexcept -> bool
+  {
+    return arena_ == other.arena_;
+  }
+
+  template <class U>
+  auto
+  operator!=(arena_allocator<U> const& other) const noexcept -> bool
+  {
+    return arena_ != other.arena_;
+  }
+};
+
+} // namespace foxy
+
+#endif // FOXY_MESSAGE_ARENA_HPP_
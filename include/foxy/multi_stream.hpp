@@ -12,8 +12,6 @@
 
 #include <foxy/detail/variant2/variant.hpp>
 
-#include <boost/asio/io_context.hpp>
-
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/beast/core/type_traits.hpp>
 
@@ -25,13 +23,18 @@
 
 namespace foxy
 {
+// basic_multi_stream is either a `Stream` or an SSL stream on top of one
+//
+// Its executor is always the one of `Stream` itself, the SSL layer is only ever asked for its
+// executor by way of the stream it wraps.
+//
 template <class Stream, class = std::enable_if_t<boost::beast::is_async_stream<Stream>::value>>
 struct basic_multi_stream
 {
 public:
   using stream_type     = Stream;
   using ssl_stream_type = boost::beast::ssl_stream<stream_type>;
-  using executor_type   = boost::asio::io_context::executor_type;
+  using executor_type   = decltype(std::declval<Stream&>().get_executor());
 
 private:
   boost::variant2::variant<stream_type, ssl_stream_type> stream_;
@@ -128,9 +131,9 @@ basic_multi_stream<Stream, X>::is_ssl() const noexcept -> bool
 
 template <class Stream, class X>
 auto
-basic_multi_stream<Stream, X>::get_executor() -> boost::asio::io_context::executor_type
+basic_multi_stream<Stream, X>::get_executor() -> executor_type
 {
-  return boost::variant2::visit([](auto& stream) { return stream.get_executor(); }, stream_);
+  return is_ssl() ? ssl().next_layer().get_executor() : plain().get_executor();
 }
 
 using multi_stream = basic_multi_stream<boost::asio::ip::tcp::socket>;
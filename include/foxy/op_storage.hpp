@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_OP_STORAGE_HPP_
+#define FOXY_OP_STORAGE_HPP_
+
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+namespace foxy
+{
+// op_storage recycles the memory a session's composed operations, and the asio operations they
+// start, allocate for their state
+//
+// An operation frees its state right before its handler is invoked and the handler usually starts
+// the next operation right away, asking for the very same sizes again. Instead of going back to
+// the heap, freed blocks are kept around and handed out again, so a session that's past its first
+// few reads and writes doesn't allocate at all. Only when more blocks are in use at once than the
+// storage can keep track of does it fall back to the heap.
+//
+// Blocks larger than `max_block_size` are never kept. Operation state stays well below it, what
+// doesn't are the buffers a relay moves bodies through, and holding on to those would pin them to
+// every idle keep-alive connection that once saw a bulk transfer.
+//
+// The storage is reference-counted, every `op_allocator` holds on to it. It thus outlives the
+// session as long as a handler that allocated from it is still queued.
+//
+// Asio frees an operation's memory on the thread that completed it, before the handler is handed
+// to its executor. A session behind a strand can therefore have two of its operations freed at the
+// same time by different threads, which is what `is_concurrent` is for: it makes the reference
+// count atomic and puts the cached blocks behind a mutex. Otherwise the storage isn't synchronized
+// at all.
+//
+struct op_storage
+{
+private:
+  static constexpr std::size_t num_blocks = 8;
+
+  bool const                          is_concurrent_;
+  std::atomic<std::size_t>            refs_{0};
+  std::mutex                          mutex_;
+  std::array<void*, num_blocks>       blocks_;
+  std::array<std::size_t, num_blocks> capacities_;
+
+  auto
+  lock() -> std::unique_lock<std::mutex>;
+
+  friend auto
+  intrusive_ptr_add_ref(op_storage* storage) -> void;
+
+  friend auto
+  intrusive_ptr_release(op_storage* storage) -> void;
+
+public:
+  static constexpr std::size_t max_block_size = 4096;
+
+  // timed_op is bumped whenever a timed operation on the session starts or completes, a timeout
+  // that fires for an earlier value belongs to an operation that's already over
+  //
+  std::uint64_t timed_op = 0;
+
+  op_storage(op_storage const&) = delete;
+  op_storage& operator=(op_storage const&) = delete;
+
+  explicit op_storage(bool const is_concurrent = false);
+  ~op_storage();
+
+  auto
+  allocate(std::size_t const size) -> void*;
+
+  auto
+  deallocate(void* p, std::size_t const size) -> void;
+};
+
+auto
+intrusive_ptr_add_ref(op_storage* storage) -> void;
+
+auto
+intrusive_ptr_release(op_storage* storage) -> void;
+
+// op_allocator allocates from an `op_storage`, sessions associate it with the handlers of their
+// operations
+//
+template <class T>
+struct op_allocator
+{
+public:
+  using value_type = T;
+
+  template <class U>
+  struct rebind
+  {
+    using other = op_allocator<U>;
+  };
+
+private:
+  template <class U>
+  friend struct op_allocator;
+
+  boost::intrusive_ptr<op_storage> storage_;
+
+public:
+  explicit op_allocator(boost::intrusive_ptr<op_storage> storage) noexcept
+    : storage_(std::move(storage))
+  {
+  }
+
+  template <class U>
+  op_allocator(op_allocator<U> const& other) noexcept
+    : storage_(other.storage_)
+  {
+  }
+
+  auto
+  allocate(std::size_t const n) -> T*
+  {
+    return static_cast<T*>(storage_->allocate(n * sizeof(T)));
+  }
+
+  auto
+  deallocate(T* p, std::size_t const n) -> void
+  {
+    storage_->deallocate(p, n * sizeof(T));
+  }
+
+  template <class U>
+  auto
+  operator==(op_allocator<U> const& other) const noexcept -> bool
+  {
+    return storage_ == other.storage_;
+  }
+
+  template <class U>
+  auto
+  operator!=(op_allocator<U> const& other) const noexcept -> bool
+  {
+    return storage_ != other.storage_;
+  }
+};
+
+} // namespace foxy
+
+#endif // FOXY_OP_STORAGE_HPP_
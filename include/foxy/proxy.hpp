@@ -12,6 +12,7 @@
 
 #include <foxy/session.hpp>
 #include <foxy/multi_stream.hpp>
+#include <foxy/upstream_pool.hpp>
 
 #include <boost/beast/http/serializer.hpp>
 #include <boost/beast/http/buffer_body.hpp>
@@ -32,6 +33,10 @@ namespace foxy
 // It's intended to forward localhost traffic and then relay it for the client, performing any
 // encryption along the way
 //
+// Connections to the remotes of absolute-form requests are drawn from the proxy's `upstream_pool`
+// so that they're kept warm across the proxy's clients. CONNECT tunnels always get a connection of
+// their own.
+//
 struct proxy : public std::enable_shared_from_this<proxy>
 {
 public:
@@ -41,9 +46,10 @@ public:
   using executor_type = stream_type::executor_type;
 
 private:
-  stream_type          stream_;
-  acceptor_type        acceptor_;
-  ::foxy::session_opts client_opts_;
+  stream_type                            stream_;
+  acceptor_type                          acceptor_;
+  ::foxy::session_opts                   client_opts_;
+  std::shared_ptr<::foxy::upstream_pool> pool_;
 
   boost::asio::coroutine accept_coro_;
 
@@ -57,7 +63,17 @@ public:
   proxy(boost::asio::io_context& io,
         endpoint_type const&     endpoint,
         bool                     reuse_addr  = false,
-        session_opts             client_opts = {});
+        session_opts             client_opts = {},
+        upstream_pool_opts       pool_opts   = {});
+
+  // construct a proxy from an acceptor that's already been opened, bound and set to listen
+  // this is useful for when the acceptor needs socket options applied before it's bound, i.e.
+  // SO_REUSEPORT
+  //
+  proxy(boost::asio::io_context& io,
+        acceptor_type            acceptor,
+        session_opts             client_opts = {},
+        upstream_pool_opts       pool_opts   = {});
 
   auto
   get_executor() -> executor_type;
@@ -67,6 +83,12 @@ public:
 
   auto
   cancel(boost::system::error_code& ec) -> void;
+
+  auto
+  local_endpoint() const -> endpoint_type;
+
+  auto
+  pool() noexcept -> ::foxy::upstream_pool&;
 };
 
 } // namespace foxy
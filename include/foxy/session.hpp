@@ -11,7 +11,12 @@
 #define FOXY_SESSION_HPP
 
 #include <foxy/multi_stream.hpp>
+#include <foxy/session_timer.hpp>
+#include <foxy/session_deadline.hpp>
+#include <foxy/op_storage.hpp>
+#include <foxy/awaitable.hpp>
 
+#include <boost/asio/io_context.hpp>
 #include <boost/asio/async_result.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/asio/ssl/context.hpp>
@@ -20,28 +25,99 @@
 #include <boost/beast/http/write.hpp>
 #include <boost/beast/core/flat_buffer.hpp>
 
+#include <memory>
+#include <string>
+#include <type_traits>
+
 namespace foxy
 {
+// relay_opts controls the buffers used to shuttle message bodies and tunneled bytes between two
+// sessions
+//
+// A relay starts out with `buffer_size` bytes and every time a read fills the buffer completely, the
+// transfer is treated as bulk and the buffer is doubled until it reaches `max_buffer_size`. Setting
+// both to the same value disables the growth altogether. Buffers are only allocated once the first
+// body bytes need them so an idle relay doesn't carry any.
+//
+// `via` is what the relays append to the Via field of every message they forward, the protocol
+// version followed by the proxy's pseudonym (RFC 7230, section 5.7.1). A message that already
+// carries it has looped back through the proxy and isn't forwarded any further. An empty `via` is
+// replaced with the default.
+//
+struct relay_opts
+{
+  std::size_t buffer_size     = 2048;
+  std::size_t max_buffer_size = 256 * 1024;
+  std::string via             = "1.1 foxy";
+};
+
+struct dns_cache;
+struct dns_resolver;
+
+// session_opts is copied into every session it's used to construct
+//
+// `client_session::async_connect` races connection attempts to the resolved endpoints, alternating
+// between IPv6 and IPv4, and starts the next attempt every `connect_delay` (RFC 8305's Connection
+// Attempt Delay) until one of them succeeds.
+//
+// `use_timer_wheel` arms the session's deadlines on the `timer_wheel` of its io_context instead of
+// asio's timer queue. That's cheaper to arm and cancel but only as precise as
+// `timer_wheel::resolution`. The wheel isn't synchronized so sessions behind a strand ignore it.
+//
+// When `dns_cache` is set, `client_session::async_connect` resolves hosts through it instead of
+// going out to the system resolver every time. Otherwise, setting `dns_resolver` swaps the
+// blocking system resolver for foxy's own asynchronous one. Both are shared, not copied, so a
+// single instance can serve every session created from the same options.
+//
+// `timeout` applies to each operation on its own. `deadlines` bound the exchange as a whole: the
+// relays enforce all of them, with `timeout` standing in for an unset idle timeout, while the
+// session's own operations never run past the exchange deadline or fall below the minimum rate.
+// An exchange begins whenever `session.deadline.start()` is called, which the proxy does right
+// before reading each request.
+//
 struct session_opts
 {
   using duration_type = typename boost::asio::steady_timer::duration;
 
-  boost::optional<boost::asio::ssl::context&> ssl_ctx = {};
-  duration_type                               timeout = std::chrono::seconds{1};
+  boost::optional<boost::asio::ssl::context&> ssl_ctx         = {};
+  duration_type                               timeout         = std::chrono::seconds{1};
+  duration_type                               connect_delay   = std::chrono::milliseconds{250};
+  bool                                        use_timer_wheel = false;
+  relay_opts                                  relay           = {};
+  std::shared_ptr<::foxy::dns_cache>          dns_cache       = {};
+  std::shared_ptr<::foxy::dns_resolver>       dns_resolver    = {};
+  deadline_opts                               deadlines       = {};
 };
 
+// basic_session allocates the state of every operation it runs from its `storage`, which recycles
+// the memory from one operation to the next
+//
+// The session runs on the executor of its `Stream`. With a plain io_context executor, the session
+// assumes its io_context is run by a single thread, the way `sharded_proxy` runs them. Any other
+// executor, typically the strand of a `basic_strand_stream` over an io_context that's run by a
+// pool of threads, makes the session's storage safe to release from whichever thread an operation
+// happens to complete on.
+//
 template <class Stream, class = std::enable_if_t<boost::beast::is_async_stream<Stream>::value>>
 struct basic_session
 {
 public:
-  using stream_type = ::foxy::basic_multi_stream<Stream>;
-  using buffer_type = boost::beast::flat_buffer;
-  using timer_type  = boost::asio::steady_timer;
-
-  session_opts opts;
-  stream_type  stream;
-  buffer_type  buffer;
-  timer_type   timer;
+  using stream_type   = ::foxy::basic_multi_stream<Stream>;
+  using buffer_type   = boost::beast::flat_buffer;
+  using timer_type    = ::foxy::session_timer;
+  using deadline_type = ::foxy::session_deadline;
+  using storage_type  = boost::intrusive_ptr<::foxy::op_storage>;
+  using executor_type = typename stream_type::executor_type;
+
+  static constexpr bool is_concurrent =
+    !std::is_same<executor_type, boost::asio::io_context::executor_type>::value;
+
+  session_opts  opts;
+  stream_type   stream;
+  buffer_type   buffer;
+  timer_type    timer;
+  deadline_type deadline;
+  storage_type  storage;
 
   basic_session()                     = delete;
   basic_session(basic_session const&) = delete;
@@ -50,8 +126,6 @@ public:
   explicit basic_session(boost::asio::io_context& io, session_opts opts_ = {});
   explicit basic_session(stream_type stream_, session_opts opts_ = {});
 
-  using executor_type = decltype(stream.get_executor());
-
   auto
   get_executor() -> executor_type;
 
@@ -80,6 +154,27 @@ public:
   async_write(Serializer& serializer, WriteHandler&& handler) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
     WriteHandler,
     void(boost::system::error_code, std::size_t));
+
+#ifdef FOXY_HAS_CO_AWAIT
+  // the overloads without a handler are for C++20 coroutines, they report errors by throwing a
+  // `boost::system::system_error`
+  //
+  template <class Parser>
+  auto
+  async_read_header(Parser& parser) & -> ::foxy::awaitable<std::size_t>;
+
+  template <class Parser>
+  auto
+  async_read(Parser& parser) & -> ::foxy::awaitable<std::size_t>;
+
+  template <class Serializer>
+  auto
+  async_write_header(Serializer& serializer) & -> ::foxy::awaitable<std::size_t>;
+
+  template <class Serializer>
+  auto
+  async_write(Serializer& serializer) & -> ::foxy::awaitable<std::size_t>;
+#endif
 };
 
 using session = basic_session<boost::asio::ip::tcp::socket>;
@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_SESSION_DEADLINE_HPP_
+#define FOXY_SESSION_DEADLINE_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace foxy
+{
+// deadline_opts are the policies that bound a whole request/response exchange instead of a single
+// operation
+//
+// `exchange` caps the total time an exchange may take. `idle` caps how long an exchange may go
+// without moving a single byte. `min_rate` is the lowest number of bytes per second an exchange
+// has to average once the first `min_rate_grace` is up. A value of zero disables the policy.
+//
+struct deadline_opts
+{
+  using duration_type = std::chrono::steady_clock::duration;
+
+  duration_type exchange       = duration_type::zero();
+  duration_type idle           = duration_type::zero();
+  std::size_t   min_rate       = 0;
+  duration_type min_rate_grace = std::chrono::seconds{1};
+};
+
+// session_deadline keeps track of the exchange a session is currently in, when it started, when
+// it last made progress and how many bytes it moved so far
+//
+// It doesn't own a timer. Whoever runs the exchange arms the session's one timer for `expiry` and,
+// when it fires, checks again because progress may have pushed the deadline back in the meantime.
+//
+struct session_deadline
+{
+public:
+  using clock_type = std::chrono::steady_clock;
+  using duration   = clock_type::duration;
+  using time_point = clock_type::time_point;
+
+private:
+  time_point    start_;
+  time_point    last_progress_;
+  std::uint64_t num_bytes_ = 0;
+
+public:
+  // a session starts its first exchange as soon as it's created
+  //
+  session_deadline();
+
+  // start begins a new exchange, forgetting about everything the previous one did
+  //
+  auto
+  start() -> void;
+
+  // progress records that `num_bytes` were read or written as part of the current exchange
+  //
+  auto
+  progress(std::size_t const num_bytes) -> void;
+
+  auto
+  num_bytes() const noexcept -> std::uint64_t;
+
+  auto
+  last_progress() const noexcept -> time_point;
+
+  // expiry is the earliest point in time at which the exchange deadline or the minimum rate in
+  // `opts` will be violated if no more bytes move until then
+  //
+  auto
+  expiry(deadline_opts const& opts) const -> time_point;
+
+  // idle_expiry is when the exchange will have been idle for `idle`, a zero `idle` never expires
+  //
+  auto
+  idle_expiry(duration const idle) const -> time_point;
+};
+
+} // namespace foxy
+
+#endif // FOXY_SESSION_DEADLINE_HPP_
@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_SESSION_TIMER_HPP_
+#define FOXY_SESSION_TIMER_HPP_
+
+#include <foxy/timer_wheel.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/async_result.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace foxy
+{
+namespace detail
+{
+// io_context_of returns the io_context that `executor` runs its handlers on, which is where a
+// session's timer has to live
+//
+// Executors that wrap another one, like strands, only hand out an `execution_context` which is cast
+// back, the executor must thus be backed by an io_context.
+//
+template <class Executor>
+auto
+io_context_of(Executor const& executor) -> boost::asio::io_context&
+{
+  return static_cast<boost::asio::io_context&>(executor.context());
+}
+
+} // namespace detail
+
+// session_timer is the timer every session arms its deadlines on
+//
+// It's either a plain `steady_timer` or, when the session was created with
+// `session_opts::use_timer_wheel`, a `wheel_timer` on its io_context's `timer_wheel`. Both behave
+// the same as far as the session's operations are concerned.
+//
+struct session_timer
+{
+public:
+  using clock_type    = std::chrono::steady_clock;
+  using duration      = clock_type::duration;
+  using time_point    = clock_type::time_point;
+  using executor_type = boost::asio::io_context::executor_type;
+
+private:
+  boost::asio::io_context*     io_;
+  boost::asio::steady_timer    steady_;
+  std::unique_ptr<wheel_timer> wheel_;
+
+public:
+  session_timer()                     = delete;
+  session_timer(session_timer const&) = delete;
+  session_timer(session_timer&&)      = default;
+
+  session_timer(boost::asio::io_context& io, bool const use_wheel);
+
+  auto
+  get_executor() noexcept -> executor_type;
+
+  auto
+  expiry() const -> time_point;
+
+  auto
+  expires_at(time_point const expiry) -> std::size_t;
+
+  auto
+  expires_after(duration const d) -> std::size_t;
+
+  auto
+  cancel() -> std::size_t;
+
+  template <class WaitHandler>
+  auto
+  async_wait(WaitHandler&& handler) ->
+    typename boost::asio::async_result<std::decay_t<WaitHandler>,
+                                       void(boost::system::error_code)>::return_type
+  {
+    if (wheel_) { return wheel_->async_wait(std::forward<WaitHandler>(handler)); }
+    return steady_.async_wait(std::forward<WaitHandler>(handler));
+  }
+};
+
+} // namespace foxy
+
+#endif // FOXY_SESSION_TIMER_HPP_
@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_SHARDED_PROXY_HPP_
+#define FOXY_SHARDED_PROXY_HPP_
+
+#include <foxy/proxy.hpp>
+#include <foxy/session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace foxy
+{
+// sharded_proxy runs one `foxy::proxy` per worker thread
+// Every shard owns its own io_context and its own acceptor, all bound to the same endpoint using
+// SO_REUSEPORT so the kernel load-balances incoming connections between them. A tunnel only ever
+// runs on the io_context of the shard that accepted it so no state is shared across threads. This
+// includes the upstream connection pools, every shard keeps one of its own bounded by `pool_opts`.
+//
+// On platforms without SO_REUSEPORT, constructing more than one shard throws a
+// `boost::system::system_error` with `boost::asio::error::operation_not_supported`
+//
+struct sharded_proxy
+{
+public:
+  using endpoint_type = ::foxy::proxy::endpoint_type;
+
+private:
+  struct shard
+  {
+    boost::asio::io_context        io;
+    std::shared_ptr<::foxy::proxy> proxy;
+    std::thread                    thread;
+
+    shard();
+  };
+
+  std::vector<std::unique_ptr<shard>> shards_;
+  endpoint_type                       endpoint_;
+
+public:
+  sharded_proxy()                     = delete;
+  sharded_proxy(sharded_proxy const&) = delete;
+  sharded_proxy(sharded_proxy&&)      = delete;
+
+  // if `num_shards` is 0, one shard per hardware thread is created
+  // if the endpoint's port is 0, the first shard picks an ephemeral port and every other shard
+  // binds to that same port
+  //
+  sharded_proxy(endpoint_type const& endpoint,
+                std::size_t          num_shards  = 0,
+                session_opts         client_opts = {},
+                upstream_pool_opts   pool_opts   = {});
+
+  ~sharded_proxy();
+
+  auto
+  size() const noexcept -> std::size_t;
+
+  auto
+  local_endpoint() const -> endpoint_type;
+
+  // run starts accepting on every shard and launches the worker threads
+  //
+  auto
+  run() -> void;
+
+  // stop cancels every shard's acceptor
+  // Tunnels that are already in flight are allowed to finish normally after which each worker
+  // thread's io_context runs out of work
+  //
+  auto
+  stop() -> void;
+
+  // join blocks until every worker thread has exited
+  //
+  auto
+  join() -> void;
+};
+
+} // namespace foxy
+
+#endif // FOXY_SHARDED_PROXY_HPP_
@@ -33,6 +33,26 @@
 
 namespace foxy {
 
+/** Reference counting policy for a @ref shared_handler_ptr whose
+    copies may be created and destroyed on different threads
+    concurrently.
+*/
+struct atomic_count
+{
+    using type = std::atomic<std::uint16_t>;
+};
+
+/** Reference counting policy for a @ref shared_handler_ptr whose
+    copies are only ever touched by one thread at a time, such as
+    those of a composed operation running on a strand, implicit or
+    not. The count is a plain integer so copying and destroying a
+    container doesn't cost a locked instruction.
+*/
+struct plain_count
+{
+    using type = std::uint16_t;
+};
+
 /** A smart pointer container with associated completion handler.
 
     This is a smart pointer that retains shared ownership of an
@@ -55,7 +75,8 @@ namespace foxy {
     object.
 
     @par Thread Safety
-    @e Distinct @e objects: Safe.@n
+    @e Distinct @e objects: Safe, unless they share ownership
+    and the count is a @ref plain_count.@n
     @e Shared @e objects: Unsafe.
 
     @note The reference count is stored using a 16 bit unsigned
@@ -65,14 +86,17 @@ namespace foxy {
     @tparam T The type of the owned object.
 
     @tparam Handler The type of the completion handler.
+
+    @tparam Count The reference counting policy, either
+    @ref atomic_count or @ref plain_count.
 */
-template<class T, class Handler>
+template<class T, class Handler, class Count = atomic_count>
 class shared_handler_ptr
 {
     struct P
     {
         T* t;
-        std::atomic<std::uint16_t> n;
+        typename Count::type n;
 
         // There's no way to put the handler anywhere else
         // without exposing ourselves to race conditions
@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_STRAND_STREAM_HPP_
+#define FOXY_STRAND_STREAM_HPP_
+
+#include <boost/asio/strand.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <utility>
+
+namespace foxy
+{
+// basic_strand_stream puts a stream behind its own strand, it's meant to be used as the `Stream` of
+// a `basic_session` whose io_context is run by several threads
+//
+// The strand is the stream's executor so a session built on top of it runs every one of its
+// intermediate handlers, timeouts included, through the strand. Handlers that come with an executor
+// of their own keep using it, just like they would with any other asio stream.
+//
+template <class Stream>
+struct basic_strand_stream
+{
+public:
+  using next_layer_type   = Stream;
+  using lowest_layer_type = typename next_layer_type::lowest_layer_type;
+  using executor_type     = boost::asio::strand<typename next_layer_type::executor_type>;
+
+private:
+  next_layer_type stream_;
+  executor_type   strand_;
+
+public:
+  basic_strand_stream()                           = delete;
+  basic_strand_stream(basic_strand_stream const&) = delete;
+  basic_strand_stream(basic_strand_stream&&)      = default;
+
+  template <class... Args>
+  explicit basic_strand_stream(Args&&... args)
+    : stream_(std::forward<Args>(args)...)
+    , strand_(stream_.get_executor())
+  {
+  }
+
+  auto
+  get_executor() noexcept -> executor_type
+  {
+    return strand_;
+  }
+
+  auto
+  next_layer() noexcept -> next_layer_type&
+  {
+    return stream_;
+  }
+
+  auto
+  lowest_layer() noexcept -> lowest_layer_type&
+  {
+    return stream_.lowest_layer();
+  }
+
+  auto
+  close(boost::system::error_code& ec) -> void
+  {
+    stream_.close(ec);
+  }
+
+  auto
+  cancel(boost::system::error_code& ec) -> void
+  {
+    stream_.cancel(ec);
+  }
+
+  template <class MutableBufferSequence, class ReadHandler>
+  auto
+  async_read_some(MutableBufferSequence const& buffers, ReadHandler&& handler)
+    -> BOOST_ASIO_INITFN_RESULT_TYPE(ReadHandler, void(boost::system::error_code, std::size_t))
+  {
+    boost::asio::async_completion<ReadHandler, void(boost::system::error_code, std::size_t)> init(
+      handler);
+
+    auto executor = boost::asio::get_associated_executor(init.completion_handler, strand_);
+    stream_.async_read_some(
+      buffers, boost::asio::bind_executor(executor, std::move(init.completion_handler)));
+
+    return init.result.get();
+  }
+
+  template <class ConstBufferSequence, class WriteHandler>
+  auto
+  async_write_some(ConstBufferSequence const& buffers, WriteHandler&& handler)
+    -> BOOST_ASIO_INITFN_RESULT_TYPE(WriteHandler, void(boost::system::error_code, std::size_t))
+  {
+    boost::asio::async_completion<WriteHandler, void(boost::system::error_code, std::size_t)> init(
+      handler);
+
+    auto executor = boost::asio::get_associated_executor(init.completion_handler, strand_);
+    stream_.async_write_some(
+      buffers, boost::asio::bind_executor(executor, std::move(init.completion_handler)));
+
+    return init.result.get();
+  }
+};
+
+using strand_stream = basic_strand_stream<boost::asio::ip::tcp::socket>;
+
+} // namespace foxy
+
+#endif // FOXY_STRAND_STREAM_HPP_
@@ -0,0 +1,259 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_TIMER_WHEEL_HPP_
+#define FOXY_TIMER_WHEEL_HPP_
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace foxy
+{
+struct wheel_timer;
+
+// timer_wheel is an io_context service that keeps the deadlines of every `wheel_timer` running on
+// that io_context in a hierarchical timing wheel
+//
+// Deadlines are rounded up to the next multiple of `resolution` so timers never fire early but can
+// fire up to a tick late. Arming a timer links it into a slot and cancelling it unlinks it again,
+// both in constant time, and the whole wheel is driven by a single `steady_timer` that only runs
+// while there are timers waiting.
+//
+// The wheel isn't synchronized. It's meant for an io_context that's run by a single thread, like
+// each of the ones `sharded_proxy` creates.
+//
+struct timer_wheel : boost::asio::io_context::service
+{
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  static boost::asio::io_context::id id;
+
+  static constexpr clock_type::duration resolution = std::chrono::milliseconds{10};
+
+private:
+  friend struct wheel_timer;
+
+  static constexpr std::size_t slot_bits  = 6;
+  static constexpr std::size_t num_slots  = std::size_t{1} << slot_bits;
+  static constexpr std::size_t num_levels = 4;
+
+  struct wait_op_base
+  {
+    wait_op_base* next = nullptr;
+
+    virtual ~wait_op_base() = default;
+
+    // complete posts the handler with `ec`, destroy drops it without ever invoking it
+    //
+    virtual auto
+    complete(boost::system::error_code ec) -> void = 0;
+
+    virtual auto
+    destroy() -> void = 0;
+  };
+
+  struct node
+  {
+    node*         prev   = nullptr;
+    node*         next   = nullptr;
+    std::uint64_t expiry = 0;
+
+    // the waits are kept in a singly-linked list in the order they were started
+    //
+    wait_op_base* first = nullptr;
+    wait_op_base* last  = nullptr;
+  };
+
+  boost::asio::io_context&  io_;
+  boost::asio::steady_timer driver_;
+  clock_type::time_point    origin_;
+  std::uint64_t             next_tick_  = 0;
+  std::size_t               size_       = 0;
+  bool                      is_driving_ = false;
+
+  // every slot is the sentinel of a circular list so unlinking never needs to know the slot
+  //
+  std::array<std::array<node, num_slots>, num_levels> slots_;
+
+  auto
+  to_tick(clock_type::time_point const expiry) const -> std::uint64_t;
+
+  auto
+  elapsed_ticks() const -> std::uint64_t;
+
+  auto
+  link(node& n) -> void;
+
+  auto
+  unlink(node& n) -> void;
+
+  auto
+  insert(node& n) -> void;
+
+  auto
+  cascade(std::size_t const level) -> void;
+
+  auto
+  advance() -> void;
+
+  auto
+  drive() -> void;
+
+  auto
+  shutdown() -> void override;
+
+public:
+  explicit timer_wheel(boost::asio::io_context& io);
+
+  // size returns the number of timers that currently have a wait pending
+  //
+  auto
+  size() const noexcept -> std::size_t;
+};
+
+// wheel_timer offers the subset of `steady_timer`'s interface that sessions need, backed by the
+// `timer_wheel` of the io_context it's constructed with
+//
+// Like `steady_timer`, changing the expiry or destroying the timer cancels all of its pending waits
+// and their handlers are posted with `operation_aborted`.
+//
+struct wheel_timer
+{
+public:
+  using clock_type    = timer_wheel::clock_type;
+  using duration      = clock_type::duration;
+  using time_point    = clock_type::time_point;
+  using executor_type = boost::asio::io_context::executor_type;
+
+private:
+  template <class WaitHandler>
+  struct wait_op : timer_wheel::wait_op_base
+  {
+    using allocator_type = typename std::allocator_traits<
+      boost::asio::associated_allocator_t<WaitHandler>>::template rebind_alloc<wait_op>;
+
+    boost::asio::io_context& io;
+    WaitHandler              handler;
+
+    template <class DeducedHandler>
+    wait_op(boost::asio::io_context& io_, DeducedHandler&& handler_)
+      : io(io_)
+      , handler(std::forward<DeducedHandler>(handler_))
+    {
+    }
+
+    static auto
+    create(boost::asio::io_context& io, WaitHandler&& handler) -> wait_op*
+    {
+      auto alloc = allocator_type(boost::asio::get_associated_allocator(handler));
+      auto* p    = std::allocator_traits<allocator_type>::allocate(alloc, 1);
+      return ::new (static_cast<void*>(p)) wait_op(io, std::move(handler));
+    }
+
+    auto
+    release() -> WaitHandler
+    {
+      auto h     = std::move(handler);
+      auto alloc = allocator_type(boost::asio::get_associated_allocator(h));
+
+      this->~wait_op();
+      std::allocator_traits<allocator_type>::deallocate(alloc, this, 1);
+
+      return h;
+    }
+
+    auto
+    complete(boost::system::error_code ec) -> void override
+    {
+      auto& ctx = io;
+      auto  h   = release();
+      auto  ex  = boost::asio::get_associated_executor(h, ctx.get_executor());
+
+      boost::asio::post(ex, boost::beast::bind_handler(std::move(h), ec));
+    }
+
+    auto
+    destroy() -> void override
+    {
+      release();
+    }
+  };
+
+  timer_wheel&      wheel_;
+  timer_wheel::node node_;
+  time_point        expiry_;
+
+  auto
+  add(timer_wheel::wait_op_base* op) -> void;
+
+public:
+  wheel_timer(wheel_timer const&) = delete;
+  wheel_timer(wheel_timer&&)      = delete;
+
+  explicit wheel_timer(boost::asio::io_context& io);
+  ~wheel_timer();
+
+  auto
+  get_executor() noexcept -> executor_type;
+
+  auto
+  expiry() const noexcept -> time_point;
+
+  auto
+  expires_at(time_point const expiry) -> std::size_t;
+
+  auto
+  expires_after(duration const d) -> std::size_t;
+
+  auto
+  cancel() -> std::size_t;
+
+  template <class WaitHandler>
+  auto
+  async_wait(WaitHandler&& handler) ->
+    typename boost::asio::async_result<std::decay_t<WaitHandler>,
+                                       void(boost::system::error_code)>::return_type;
+};
+
+template <class WaitHandler>
+auto
+wheel_timer::async_wait(WaitHandler&& handler) ->
+  typename boost::asio::async_result<std::decay_t<WaitHandler>,
+                                     void(boost::system::error_code)>::return_type
+{
+  using completion_handler_type = typename boost::asio::async_completion<
+    WaitHandler, void(boost::system::error_code)>::completion_handler_type;
+
+  boost::asio::async_completion<WaitHandler, void(boost::system::error_code)> init(handler);
+
+  add(wait_op<completion_handler_type>::create(wheel_.io_, std::move(init.completion_handler)));
+
+  return init.result.get();
+}
+
+} // namespace foxy
+
+#endif // FOXY_TIMER_WHEEL_HPP_
@@ -43,6 +43,19 @@ struct is_closable_stream_nothrow<
 {
 };
 
+template <class T, class = void>
+struct is_cancellable_stream_nothrow : std::false_type
+{
+};
+
+template <class T>
+struct is_cancellable_stream_nothrow<
+  T,
+  boost::void_t<decltype(std::declval<T&>().cancel(std::declval<boost::system::error_code&>()))>>
+  : std::true_type
+{
+};
+
 } // namespace detail
 } // namespace foxy
 
@@ -0,0 +1,272 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#ifndef FOXY_UPSTREAM_POOL_HPP_
+#define FOXY_UPSTREAM_POOL_HPP_
+
+#include <foxy/client_session.hpp>
+#include <foxy/session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/error.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace foxy
+{
+// upstream_pool_opts bounds how many connections an `upstream_pool` keeps around
+//
+// `max_per_host` counts every connection to an upstream, whether it's leased out, being connected
+// or sitting idle. Once a host reaches it, acquirers queue up until a connection is released, for
+// no longer than `acquire_timeout` after which they fail with `boost::asio::error::timed_out`.
+// Idle connections beyond `max_idle_per_host` or `max_idle` in total are closed instead of kept and
+// an idle connection older than `idle_timeout` is never handed out again.
+//
+struct upstream_pool_opts
+{
+  using duration_type = typename boost::asio::steady_timer::duration;
+
+  std::size_t   max_idle          = 64;
+  std::size_t   max_idle_per_host = 8;
+  std::size_t   max_per_host      = 32;
+  duration_type idle_timeout      = std::chrono::seconds{30};
+  duration_type acquire_timeout   = std::chrono::seconds{10};
+};
+
+// upstream_key identifies the remote a pooled connection is connected to
+//
+struct upstream_key
+{
+  std::string scheme;
+  std::string host;
+  std::string port;
+
+  auto
+  operator==(upstream_key const& rhs) const noexcept -> bool
+  {
+    return scheme == rhs.scheme && host == rhs.host && port == rhs.port;
+  }
+
+  struct hash
+  {
+    auto
+    operator()(upstream_key const& key) const noexcept -> std::size_t;
+  };
+};
+
+// upstream_pool_stats counts how acquisitions were satisfied
+//
+// `hits` is the number of times a warm connection was handed out, `misses` the number of times the
+// caller was given a fresh session it had to connect itself. `waits` counts the acquisitions that
+// had to queue up behind `max_per_host` and `wait_time` is the total time they spent doing so.
+//
+struct upstream_pool_stats
+{
+  std::size_t                         hits      = 0;
+  std::size_t                         misses    = 0;
+  std::size_t                         waits     = 0;
+  std::chrono::steady_clock::duration wait_time = {};
+};
+
+// upstream_pool hands out keep-alive `client_session`s keyed by (scheme, host, port)
+//
+// A pool is meant to be owned by a single worker and every member function must be called from
+// that worker's io_context. Connections acquired from the pool are either already connected or are
+// brand-new sessions the caller still needs to `async_connect`, `is_open()` on the lowest layer
+// tells the two apart. Every acquired session must be handed back with `release`, along with
+// whether it's still fit to carry another request.
+//
+struct upstream_pool
+{
+public:
+  using session_type = ::foxy::client_session;
+  using session_ptr  = std::unique_ptr<session_type>;
+  using clock_type   = std::chrono::steady_clock;
+
+private:
+  // waiter is an acquisition queued up behind `max_per_host`
+  //
+  // Its timer expires once the acquisition has waited for `acquire_timeout` and is cancelled when
+  // a connection is handed over, which also clears `ec`. `pool` is reset when the pool goes away
+  // before the waiter's handler got to run.
+  //
+  struct waiter
+  {
+    boost::asio::steady_timer timer;
+    session_ptr*              session;
+    clock_type::time_point    start;
+    boost::system::error_code ec;
+    upstream_pool*            pool;
+    upstream_key              key;
+
+    waiter(upstream_pool& pool_, upstream_key const& key_, session_ptr& session_);
+  };
+
+  struct idle_session
+  {
+    session_ptr            session;
+    clock_type::time_point since;
+  };
+
+  struct host
+  {
+    std::vector<idle_session>           idle;
+    std::deque<std::shared_ptr<waiter>> waiters;
+    std::size_t                         num_sessions = 0;
+  };
+
+  template <class AcquireHandler>
+  struct wait_op
+  {
+    std::shared_ptr<waiter> w;
+    AcquireHandler          handler;
+
+    using executor_type = boost::asio::associated_executor_t<
+      AcquireHandler,
+      decltype(std::declval<boost::asio::steady_timer&>().get_executor())>;
+
+    using allocator_type = boost::asio::associated_allocator_t<AcquireHandler>;
+
+    auto
+    get_executor() const noexcept -> executor_type
+    {
+      return boost::asio::get_associated_executor(handler, w->timer.get_executor());
+    }
+
+    auto
+    get_allocator() const noexcept -> allocator_type
+    {
+      return boost::asio::get_associated_allocator(handler);
+    }
+
+    auto
+    operator()(boost::system::error_code) -> void
+    {
+      // nobody handed over a connection in time, the waiter is still queued up
+      //
+      if (w->ec == boost::asio::error::operation_aborted && w->pool) {
+        w->pool->abandon(*w);
+        w->ec = boost::asio::error::timed_out;
+      }
+
+      auto const ec = w->ec;
+      w.reset();
+      handler(ec);
+    }
+  };
+
+  boost::asio::io_context& io_;
+  session_opts             client_opts_;
+  upstream_pool_opts       opts_;
+  upstream_pool_stats      stats_;
+  std::size_t              num_idle_ = 0;
+
+  std::unordered_map<upstream_key, host, upstream_key::hash> hosts_;
+
+  // try to satisfy an acquisition immediately, returns false if the caller has to wait
+  //
+  auto
+  try_acquire(upstream_key const& key, session_ptr& session) -> bool;
+
+  auto
+  enqueue(upstream_key const& key, session_ptr& session) -> std::shared_ptr<waiter>;
+
+  // abandon removes a waiter that timed out from its host's queue
+  //
+  auto
+  abandon(waiter const& w) -> void;
+
+public:
+  upstream_pool()                     = delete;
+  upstream_pool(upstream_pool const&) = delete;
+  upstream_pool(upstream_pool&&)      = delete;
+
+  upstream_pool(boost::asio::io_context& io,
+                session_opts             client_opts,
+                upstream_pool_opts       opts = {});
+
+  // any acquisitions still waiting complete with `boost::asio::error::operation_aborted`
+  //
+  ~upstream_pool();
+
+  // async_acquire stores a session for `key` in `session` and then invokes the handler
+  // The handler is never invoked from within this function. If `max_per_host` connections to `key`
+  // already exist, the acquisition waits until one of them is released or `acquire_timeout` passes.
+  //
+  template <class AcquireHandler>
+  auto
+  async_acquire(upstream_key const& key, session_ptr& session, AcquireHandler&& handler) ->
+    typename boost::asio::async_result<std::decay_t<AcquireHandler>,
+                                       void(boost::system::error_code)>::return_type;
+
+  // release returns a session obtained from `async_acquire` back to the pool
+  // Sessions that aren't reusable, have unread bytes buffered or don't fit under the idle limits
+  // are closed.
+  //
+  auto
+  release(upstream_key const& key, session_ptr session, bool const is_reusable) -> void;
+
+  // is_alive checks that a connected session hasn't been hung up on and that the remote hasn't
+  // sent anything unsolicited, both of which disqualify it from carrying another request
+  //
+  // TLS remotes are free to send records of their own between requests, a TLS 1.3 server hands out
+  // session tickets after the handshake for instance, so only an alert marks those as unusable.
+  //
+  static auto
+  is_alive(session_type& session) -> bool;
+
+  auto
+  stats() const noexcept -> upstream_pool_stats const&;
+
+  auto
+  num_idle() const noexcept -> std::size_t;
+};
+
+template <class AcquireHandler>
+auto
+upstream_pool::async_acquire(upstream_key const& key,
+                             session_ptr&        session,
+                             AcquireHandler&&    handler) ->
+  typename boost::asio::async_result<std::decay_t<AcquireHandler>,
+                                     void(boost::system::error_code)>::return_type
+{
+  boost::asio::async_completion<AcquireHandler, void(boost::system::error_code)> init(handler);
+
+  if (try_acquire(key, session)) {
+    boost::asio::post(io_, boost::beast::bind_handler(std::move(init.completion_handler),
+                                                      boost::system::error_code()));
+  } else {
+    auto w = enqueue(key, session);
+    w->timer.async_wait(
+      wait_op<typename boost::asio::async_completion<
+        AcquireHandler, void(boost::system::error_code)>::completion_handler_type>{
+        w, std::move(init.completion_handler)});
+  }
+
+  return init.result.get();
+}
+
+} // namespace foxy
+
+#endif // FOXY_UPSTREAM_POOL_HPP_
@@ -12,6 +12,9 @@
 #include <boost/fusion/adapted/struct/adapt_struct.hpp>
 #include <boost/fusion/include/adapt_struct.hpp>
 
+#include <cstddef>
+#include <cstdint>
+
 namespace foxy
 {
 // uri_parts stores a set of `string_views` that identify each relevant portion of a URI as defined
@@ -91,9 +94,88 @@ public:
   is_absolute() const noexcept -> bool;
 };
 
+// compact_uri_parts is `uri_parts` stored as offsets into the URI rather than pointers to it
+//
+// It's a fraction of the size, trivially copyable and stays valid when the text of the URI is moved
+// elsewhere, which is also why every accessor that returns a portion of the URI needs to be handed
+// that text. The URI can be at most 65535 bytes long, a longer one is treated as if it failed to
+// parse.
+//
+struct compact_uri_parts
+{
+public:
+  using string_view = boost::string_view;
+
+private:
+  struct part
+  {
+    std::uint16_t offset = 0;
+    std::uint16_t size   = 0;
+  };
+
+  part scheme_;
+  part host_;
+  part port_;
+  part path_;
+  part query_;
+  part fragment_;
+
+public:
+  static constexpr std::size_t max_size = 65535;
+
+  compact_uri_parts() = default;
+
+  // `uri` is the text `parts` were parsed from
+  //
+  compact_uri_parts(uri_parts const& parts, string_view const uri) noexcept;
+
+  auto
+  scheme(string_view const uri) const noexcept -> string_view;
+
+  auto
+  host(string_view const uri) const noexcept -> string_view;
+
+  auto
+  port(string_view const uri) const noexcept -> string_view;
+
+  auto
+  path(string_view const uri) const noexcept -> string_view;
+
+  auto
+  query(string_view const uri) const noexcept -> string_view;
+
+  auto
+  fragment(string_view const uri) const noexcept -> string_view;
+
+  auto
+  is_http(string_view const uri) const noexcept -> bool;
+
+  auto
+  is_authority() const noexcept -> bool;
+
+  auto
+  is_absolute() const noexcept -> bool;
+};
+
+// parse_uri takes a hand-written fast path for the common shapes of a request target and runs the
+// full RFC 3986 grammar on everything else
+//
 auto
 parse_uri(uri_parts::string_view const uri_view) -> uri_parts;
 
+// parse_compact_uri is `parse_uri` for when the result should be a `compact_uri_parts`
+//
+auto
+parse_compact_uri(uri_parts::string_view const uri_view) -> compact_uri_parts;
+
+namespace detail
+{
+// parse_uri_grammar is `parse_uri` without the fast path
+//
+auto
+parse_uri_grammar(uri_parts::string_view const uri_view) -> uri_parts;
+
+} // namespace detail
 } // namespace foxy
 
 BOOST_FUSION_ADAPT_STRUCT(foxy::uri_parts, scheme_, host_, port_, path_, query_, fragment_)
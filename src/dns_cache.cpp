@@ -0,0 +1,169 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/dns_cache.hpp>
+
+#include <boost/asio/error.hpp>
+
+namespace net = boost::asio;
+
+foxy::dns_cache::waiter::waiter(boost::asio::io_context& io)
+  : timer(io)
+  , ec(net::error::operation_aborted)
+{
+  timer.expires_at(boost::asio::steady_timer::time_point::max());
+}
+
+foxy::dns_cache::dns_cache(dns_cache_opts opts)
+  : opts_(opts)
+{
+}
+
+auto
+foxy::dns_cache::lookup(key_type const&            key,
+                        boost::asio::io_context&   io,
+                        boost::system::error_code& ec,
+                        results_type&              results,
+                        std::shared_ptr<waiter>&   w) -> lookup_result
+{
+  auto const now = clock_type::now();
+
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  auto pos = entries_.find(key);
+  if (pos == entries_.end()) {
+    ++stats_.misses;
+    entries_[key].is_pending = true;
+    return lookup_result::miss;
+  }
+
+  auto& e = pos->second;
+  if (e.is_pending) {
+    ++stats_.coalesced;
+    w = std::make_shared<waiter>(io);
+    e.waiters.push_back(w);
+    return lookup_result::pending;
+  }
+
+  if (now < e.expiry) {
+    ++(e.ec ? stats_.negative_hits : stats_.hits);
+    ec      = e.ec;
+    results = e.results;
+    return lookup_result::hit;
+  }
+
+  // the entry went stale so the caller takes over refreshing it
+  //
+  if (e.ec) { --num_negative_; }
+
+  ++stats_.misses;
+  e.results    = {};
+  e.ec         = {};
+  e.is_pending = true;
+  return lookup_result::miss;
+}
+
+auto
+foxy::dns_cache::complete(key_type const&           key,
+                          boost::system::error_code ec,
+                          results_type const&       results) -> void
+{
+  auto waiters = std::vector<std::shared_ptr<waiter>>();
+
+  {
+    auto const now = clock_type::now();
+
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    auto pos = entries_.find(key);
+    if (pos == entries_.end()) { return; }
+
+    // the waiters that aren't armed yet cancel their timers themselves, see arm()
+    //
+    for (auto& w : pos->second.waiters) {
+      w->ec          = ec;
+      w->results     = results;
+      w->is_complete = true;
+
+      if (w->is_armed) { waiters.push_back(std::move(w)); }
+    }
+    pos->second.waiters.clear();
+
+    // the entry stays pending while purging so it can't be swept up along with the expired ones
+    //
+    auto is_cached = ec != net::error::operation_aborted;
+    if (is_cached && ec) {
+      if (num_negative_ >= opts_.max_negative_entries) { purge_expired(now); }
+      is_cached = num_negative_ < opts_.max_negative_entries;
+    }
+
+    if (is_cached && entries_.size() > opts_.max_entries) {
+      purge_expired(now);
+      is_cached = entries_.size() <= opts_.max_entries;
+    }
+
+    // erasing never invalidates iterators to other elements so `pos` is still good here
+    //
+    if (is_cached) {
+      auto& e = pos->second;
+
+      e.is_pending = false;
+      e.ec         = ec;
+      e.results    = results;
+      e.expiry     = now + (ec ? opts_.negative_ttl : opts_.ttl);
+
+      if (ec) { ++num_negative_; }
+
+    } else {
+      entries_.erase(pos);
+    }
+  }
+
+  // every waiter completes on its own io_context, the results were handed over before the cancel
+  // is posted so they're visible to the waiting thread by the time its handler runs
+  //
+  for (auto& w : waiters) {
+    net::post(w->timer.get_executor(), [w] { w->timer.cancel(); });
+  }
+}
+
+auto
+foxy::dns_cache::arm(std::shared_ptr<waiter> const& w) -> void
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    w->is_armed = true;
+    if (!w->is_complete) { return; }
+  }
+
+  net::post(w->timer.get_executor(), [w] { w->timer.cancel(); });
+}
+
+auto
+foxy::dns_cache::purge_expired(clock_type::time_point const now) -> void
+{
+  for (auto pos = entries_.begin(); pos != entries_.end();) {
+    auto const& e = pos->second;
+    if (e.is_pending || now < e.expiry) {
+      ++pos;
+      continue;
+    }
+
+    if (e.ec) { --num_negative_; }
+    pos = entries_.erase(pos);
+  }
+}
+
+auto
+foxy::dns_cache::stats() const -> dns_cache_stats
+{
+  std::lock_guard<std::mutex> lock(mtx_);
+  return stats_;
+}
@@ -0,0 +1,353 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/dns_resolver.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+
+using boost::asio::ip::tcp;
+using boost::asio::ip::udp;
+
+namespace net = boost::asio;
+namespace ip  = boost::asio::ip;
+
+namespace
+{
+constexpr std::uint16_t type_a     = 1;
+constexpr std::uint16_t type_aaaa  = 28;
+constexpr std::uint16_t class_in   = 1;
+constexpr std::size_t   header_len = 12;
+
+auto
+read_u16(std::uint8_t const* p) -> std::uint16_t
+{
+  return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+auto
+append_u16(std::vector<std::uint8_t>& message, std::uint16_t const value) -> void
+{
+  message.push_back(static_cast<std::uint8_t>(value >> 8));
+  message.push_back(static_cast<std::uint8_t>(value & 0xff));
+}
+
+// skip_name advances `pos` past an encoded domain name, compressed or not, and returns false if the
+// name runs past the end of the message
+//
+auto
+skip_name(std::uint8_t const* const begin, std::size_t const size, std::size_t& pos) -> bool
+{
+  while (pos < size) {
+    auto const len = begin[pos];
+    if ((len & 0xc0) == 0xc0) {
+      pos += 2;
+      return pos <= size;
+    }
+
+    pos += 1 + len;
+    if (len == 0) { return pos <= size; }
+  }
+  return false;
+}
+
+// normalize makes host names compare the way DNS does, i.e. case-insensitively and without regard
+// for the trailing dot of a fully qualified name
+//
+auto
+normalize(std::string host) -> std::string
+{
+  boost::algorithm::to_lower(host);
+  if (!host.empty() && host.back() == '.') { host.pop_back(); }
+  return host;
+}
+
+auto
+parse_port(std::string const& service, std::uint16_t& port) -> bool
+{
+  if (service == "http") {
+    port = 80;
+    return true;
+  }
+
+  if (service == "https") {
+    port = 443;
+    return true;
+  }
+
+  if (service.empty() || service.size() > 5) { return false; }
+
+  auto value = std::uint32_t{0};
+  for (auto const c : service) {
+    if (c < '0' || c > '9') { return false; }
+    value = value * 10 + static_cast<std::uint32_t>(c - '0');
+  }
+
+  if (value > std::numeric_limits<std::uint16_t>::max()) { return false; }
+
+  port = static_cast<std::uint16_t>(value);
+  return true;
+}
+
+} // namespace
+
+constexpr std::size_t foxy::dns_resolver::max_message_size;
+
+foxy::dns_resolver::dns_resolver(dns_resolver_opts opts)
+  : opts_(std::move(opts))
+{
+  if (opts_.nameservers.empty()) { load_resolv_conf(); }
+  if (!opts_.hosts.empty()) { load_hosts(); }
+
+  opts_.attempts = std::max<std::size_t>(opts_.attempts, 1);
+}
+
+// load_resolv_conf mirrors what the libc stub resolver does, a missing or empty resolv.conf means
+// the nameserver is expected to be running on the local machine
+//
+auto
+foxy::dns_resolver::load_resolv_conf() -> void
+{
+  auto file = std::ifstream(opts_.resolv_conf);
+  auto line = std::string();
+
+  while (std::getline(file, line)) {
+    auto tokens  = std::istringstream(line);
+    auto keyword = std::string();
+    tokens >> keyword;
+
+    if (keyword == "nameserver") {
+      auto value = std::string();
+      tokens >> value;
+
+      auto ec      = boost::system::error_code();
+      auto address = ip::make_address(value, ec);
+      if (!ec) { opts_.nameservers.emplace_back(address, 53); }
+
+      continue;
+    }
+
+    if (keyword != "options") { continue; }
+
+    auto option = std::string();
+    while (tokens >> option) {
+      auto const colon = option.find(':');
+      if (colon == std::string::npos) { continue; }
+
+      auto const name  = option.substr(0, colon);
+      auto       value = std::size_t{0};
+      if (!(std::istringstream(option.substr(colon + 1)) >> value)) { continue; }
+
+      if (name == "timeout") { opts_.timeout = std::chrono::seconds{value}; }
+      if (name == "attempts") { opts_.attempts = value; }
+    }
+  }
+
+  if (opts_.nameservers.empty()) {
+    opts_.nameservers.emplace_back(ip::make_address_v4("127.0.0.1"), 53);
+  }
+}
+
+auto
+foxy::dns_resolver::load_hosts() -> void
+{
+  auto file = std::ifstream(opts_.hosts);
+  auto line = std::string();
+
+  while (std::getline(file, line)) {
+    auto const comment = line.find('#');
+    if (comment != std::string::npos) { line.erase(comment); }
+
+    auto tokens = std::istringstream(line);
+    auto value  = std::string();
+    if (!(tokens >> value)) { continue; }
+
+    auto ec      = boost::system::error_code();
+    auto address = ip::make_address(value, ec);
+    if (ec) { continue; }
+
+    auto name = std::string();
+    while (tokens >> name) { hosts_[normalize(std::move(name))].push_back(address); }
+  }
+}
+
+auto
+foxy::dns_resolver::resolve_locally(std::string const&         host,
+                                    std::string const&         service,
+                                    std::uint16_t&             port,
+                                    boost::system::error_code& ec,
+                                    results_type&              results) const -> bool
+{
+  if (!parse_port(service, port)) {
+    ec = net::error::service_not_found;
+    return true;
+  }
+
+  auto addresses = std::vector<ip::address>();
+
+  auto address = ip::make_address(host, ec);
+  if (!ec) {
+    addresses.push_back(address);
+  } else {
+    ec = {};
+
+    auto pos = hosts_.find(normalize(host));
+    if (pos == hosts_.end()) { return false; }
+
+    addresses = pos->second;
+  }
+
+  auto endpoints = std::vector<tcp::endpoint>();
+  for (auto const& a : addresses) { endpoints.emplace_back(a, port); }
+
+  results = results_type::create(endpoints.begin(), endpoints.end(), host, service);
+  return true;
+}
+
+auto
+foxy::dns_resolver::on_reply(boost::asio::const_buffer                   reply,
+                             std::array<query, 2>&                       queries,
+                             std::vector<boost::asio::ip::tcp::endpoint> (&endpoints)[2],
+                             std::uint16_t const                         port,
+                             boost::system::error_code&                  ec) const -> reply_status
+{
+  auto const* const begin = static_cast<std::uint8_t const*>(reply.data());
+  auto const        size  = reply.size();
+
+  if (size < header_len) { return reply_status::ignored; }
+
+  auto const id      = read_u16(begin);
+  auto const flags   = read_u16(begin + 2);
+  auto const qdcount = read_u16(begin + 4);
+  auto const ancount = read_u16(begin + 6);
+
+  auto const is_response = (flags & 0x8000) != 0;
+  auto const rcode       = flags & 0x000f;
+
+  auto pos = std::find_if(queries.begin(), queries.end(),
+                          [=](query const& q) { return q.id == id && !q.is_answered; });
+
+  if (!is_response || qdcount != 1 || pos == queries.end()) { return reply_status::ignored; }
+
+  // the question is echoed back verbatim so a reply that doesn't carry ours belongs to some other
+  // query that happened to reuse the id
+  //
+  auto& q = *pos;
+  if (size < q.message.size() ||
+      !std::equal(q.message.begin() + header_len, q.message.end(), begin + header_len)) {
+    return reply_status::ignored;
+  }
+
+  // NXDOMAIN is an authoritative answer, any other error is worth asking another nameserver about
+  //
+  if (rcode == 3) {
+    q.is_answered = true;
+    ec            = net::error::host_not_found;
+    return reply_status::answered;
+  }
+
+  if (rcode != 0) {
+    ec = net::error::host_not_found_try_again;
+    return reply_status::failed;
+  }
+
+  auto  offset  = q.message.size();
+  auto& results = endpoints[q.type == type_a ? 0 : 1];
+
+  for (std::size_t idx = 0; idx < ancount; ++idx) {
+    if (!skip_name(begin, size, offset) || offset + 10 > size) { break; }
+
+    auto const type   = read_u16(begin + offset);
+    auto const klass  = read_u16(begin + offset + 2);
+    auto const rdlen  = read_u16(begin + offset + 8);
+    auto const* rdata = begin + offset + 10;
+
+    offset += 10 + rdlen;
+    if (offset > size) { break; }
+
+    // answers for an alias are preceded by the CNAME records which are simply skipped over
+    //
+    if (klass != class_in || type != q.type) { continue; }
+
+    if (type == type_a && rdlen == 4) {
+      auto bytes = ip::address_v4::bytes_type();
+      std::copy(rdata, rdata + 4, bytes.begin());
+      results.emplace_back(ip::address_v4(bytes), port);
+    }
+
+    if (type == type_aaaa && rdlen == 16) {
+      auto bytes = ip::address_v6::bytes_type();
+      std::copy(rdata, rdata + 16, bytes.begin());
+      results.emplace_back(ip::address_v6(bytes), port);
+    }
+  }
+
+  q.is_answered = true;
+  return reply_status::answered;
+}
+
+auto
+foxy::dns_resolver::make_id() -> std::uint16_t
+{
+  thread_local auto engine = std::mt19937(std::random_device()());
+  return static_cast<std::uint16_t>(engine());
+}
+
+auto
+foxy::dns_resolver::make_query(std::uint16_t const        id,
+                               std::uint16_t const        type,
+                               std::string const&         host,
+                               std::vector<std::uint8_t>& message) -> bool
+{
+  auto const name = normalize(host);
+  if (name.empty() || name.size() > 253) { return false; }
+
+  message.clear();
+  message.reserve(header_len + name.size() + 6);
+
+  // a standard query with recursion desired and a single question
+  //
+  append_u16(message, id);
+  append_u16(message, 0x0100);
+  append_u16(message, 1);
+  append_u16(message, 0);
+  append_u16(message, 0);
+  append_u16(message, 0);
+
+  auto label_begin = std::size_t{0};
+  while (label_begin <= name.size()) {
+    auto label_end = name.find('.', label_begin);
+    if (label_end == std::string::npos) { label_end = name.size(); }
+
+    auto const len = label_end - label_begin;
+    if (len == 0 || len > 63) { return false; }
+
+    message.push_back(static_cast<std::uint8_t>(len));
+    message.insert(message.end(), name.begin() + label_begin, name.begin() + label_end);
+
+    label_begin = label_end + 1;
+  }
+  message.push_back(0);
+
+  append_u16(message, type);
+  append_u16(message, class_in);
+  return true;
+}
+
+auto
+foxy::dns_resolver::opts() const noexcept -> dns_resolver_opts const&
+{
+  return opts_;
+}
@@ -0,0 +1,244 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/has_token.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FOXY_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define FOXY_HAS_AVX2
+#include <immintrin.h>
+#elif defined(FOXY_HAS_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// the library isn't built for AVX2 but the CPU it runs on might support it anyway, GCC and Clang
+// let us compile that one function for it and check for it once at runtime
+//
+#define FOXY_HAS_AVX2
+#define FOXY_DISPATCH_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+auto
+to_lower(char const c) noexcept -> char
+{
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+auto
+iequals(char const* a, char const* b, std::size_t const n) noexcept -> bool
+{
+  for (std::size_t idx = 0; idx < n; ++idx) {
+    if (to_lower(a[idx]) != to_lower(b[idx])) { return false; }
+  }
+  return true;
+}
+
+auto
+icontains_scalar(boost::string_view const haystack, boost::string_view const needle) noexcept
+  -> bool
+{
+  for (std::size_t pos = 0; pos + needle.size() <= haystack.size(); ++pos) {
+    if (iequals(haystack.data() + pos, needle.data(), needle.size())) { return true; }
+  }
+  return false;
+}
+
+// The vectorized versions look at a block of candidate positions at a time, a candidate being
+// where both the first and the last character of the needle line up with the haystack. Only the
+// candidates get compared in full. Lowercasing a block means adding 0x20 to whatever falls within
+// 'A' to 'Z', the comparisons are signed so bytes above 0x7f are never mistaken for letters.
+//
+// Whatever's left after the last full block is covered by one more block that ends where the
+// haystack does and overlaps the one before it. Haystacks too short for even a single block are
+// handed down to the next narrower version.
+//
+
+#ifdef FOXY_HAS_SSE2
+
+auto
+count_trailing_zeros(std::uint32_t const mask) noexcept -> unsigned
+{
+#ifdef _MSC_VER
+  unsigned long idx = 0;
+  _BitScanForward(&idx, mask);
+  return static_cast<unsigned>(idx);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+auto
+to_lower(__m128i const block) noexcept -> __m128i
+{
+  auto const is_upper = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1)),
+                                      _mm_cmplt_epi8(block, _mm_set1_epi8('Z' + 1)));
+
+  return _mm_or_si128(block, _mm_and_si128(is_upper, _mm_set1_epi8(0x20)));
+}
+
+auto
+match_sse2(char const* const        h,
+           boost::string_view const needle,
+           __m128i const            first,
+           __m128i const            last) noexcept -> bool
+{
+  auto const n = needle.size();
+
+  auto const a = to_lower(_mm_loadu_si128(reinterpret_cast<__m128i const*>(h)));
+  auto const b = to_lower(_mm_loadu_si128(reinterpret_cast<__m128i const*>(h + n - 1)));
+
+  auto mask = static_cast<std::uint32_t>(
+    _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+
+  while (mask != 0) {
+    if (iequals(h + count_trailing_zeros(mask), needle.data(), n)) { return true; }
+    mask &= mask - 1;
+  }
+  return false;
+}
+
+auto
+icontains_sse2(boost::string_view const haystack, boost::string_view const needle) noexcept
+  -> bool
+{
+  auto const* const h    = haystack.data();
+  auto const        span = needle.size() - 1 + 16;
+
+  if (haystack.size() < span) { return icontains_scalar(haystack, needle); }
+
+  auto const first = _mm_set1_epi8(to_lower(needle.front()));
+  auto const last  = _mm_set1_epi8(to_lower(needle.back()));
+
+  auto pos = std::size_t{0};
+  for (; pos + span <= haystack.size(); pos += 16) {
+    if (match_sse2(h + pos, needle, first, last)) { return true; }
+  }
+
+  return pos < haystack.size() - span + 16 &&
+         match_sse2(h + haystack.size() - span, needle, first, last);
+}
+
+#endif // FOXY_HAS_SSE2
+
+// icontains_narrow is the search for CPUs without AVX2
+//
+auto
+icontains_narrow(boost::string_view const haystack, boost::string_view const needle) noexcept
+  -> bool
+{
+#ifdef FOXY_HAS_SSE2
+  return icontains_sse2(haystack, needle);
+#else
+  return icontains_scalar(haystack, needle);
+#endif
+}
+
+#ifdef FOXY_HAS_AVX2
+
+#ifdef FOXY_DISPATCH_AVX2
+#define FOXY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FOXY_TARGET_AVX2
+#endif
+
+FOXY_TARGET_AVX2
+auto
+to_lower(__m256i const block) noexcept -> __m256i
+{
+  auto const is_upper = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('A' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), block));
+
+  return _mm256_or_si256(block, _mm256_and_si256(is_upper, _mm256_set1_epi8(0x20)));
+}
+
+FOXY_TARGET_AVX2
+auto
+match_avx2(char const* const        h,
+           boost::string_view const needle,
+           __m256i const            first,
+           __m256i const            last) noexcept -> bool
+{
+  auto const n = needle.size();
+
+  auto const a = to_lower(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(h)));
+  auto const b = to_lower(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(h + n - 1)));
+
+  auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+    _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+
+  while (mask != 0) {
+    if (iequals(h + count_trailing_zeros(mask), needle.data(), n)) { return true; }
+    mask &= mask - 1;
+  }
+  return false;
+}
+
+FOXY_TARGET_AVX2
+auto
+icontains_avx2(boost::string_view const haystack, boost::string_view const needle) noexcept
+  -> bool
+{
+  auto const* const h    = haystack.data();
+  auto const        span = needle.size() - 1 + 32;
+
+  if (haystack.size() < span) { return icontains_narrow(haystack, needle); }
+
+  auto const first = _mm256_set1_epi8(to_lower(needle.front()));
+  auto const last  = _mm256_set1_epi8(to_lower(needle.back()));
+
+  auto pos = std::size_t{0};
+  for (; pos + span <= haystack.size(); pos += 32) {
+    if (match_avx2(h + pos, needle, first, last)) { return true; }
+  }
+
+  return pos < haystack.size() - span + 32 &&
+         match_avx2(h + haystack.size() - span, needle, first, last);
+}
+
+#undef FOXY_TARGET_AVX2
+
+auto
+has_avx2() noexcept -> bool
+{
+#ifdef FOXY_DISPATCH_AVX2
+  static bool const supported = __builtin_cpu_supports("avx2");
+  return supported;
+#else
+  return true;
+#endif
+}
+
+#endif // FOXY_HAS_AVX2
+
+} // namespace
+
+auto
+foxy::detail::icontains(boost::string_view const haystack, boost::string_view const needle) noexcept
+  -> bool
+{
+  if (needle.empty()) { return true; }
+  if (needle.size() > haystack.size()) { return false; }
+
+#ifdef FOXY_HAS_AVX2
+  if (has_avx2()) { return icontains_avx2(haystack, needle); }
+#endif
+
+  return icontains_narrow(haystack, needle);
+}
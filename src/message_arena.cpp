@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/message_arena.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+constexpr std::size_t foxy::message_arena::default_capacity;
+
+// every chunk is a header followed by its bytes, the header's alignment makes sure the bytes start
+// out suitably aligned for anything
+//
+struct alignas(std::max_align_t) foxy::message_arena::chunk
+{
+  chunk*      next;
+  std::size_t capacity;
+  std::size_t used;
+
+  auto
+  data() noexcept -> unsigned char*
+  {
+    return reinterpret_cast<unsigned char*>(this + 1);
+  }
+};
+
+foxy::message_arena::message_arena(std::size_t const initial_capacity)
+  : head_(nullptr)
+  , initial_capacity_(initial_capacity)
+{
+}
+
+foxy::message_arena::~message_arena() { free_chunks(); }
+
+auto
+foxy::message_arena::push_chunk(std::size_t const capacity) -> void
+{
+  auto* const c = static_cast<chunk*>(::operator new(sizeof(chunk) + capacity));
+
+  c->next     = head_;
+  c->capacity = capacity;
+  c->used     = 0;
+
+  head_ = c;
+}
+
+auto
+foxy::message_arena::free_chunks() noexcept -> void
+{
+  while (head_) {
+    auto* const next = head_->next;
+    ::operator delete(head_);
+    head_ = next;
+  }
+}
+
+auto
+foxy::message_arena::allocate(std::size_t const size, std::size_t const alignment) -> void*
+{
+  if (head_) {
+    auto const base    = reinterpret_cast<std::uintptr_t>(head_->data());
+    auto const aligned = (base + head_->used + alignment - 1) & ~(alignment - 1);
+    auto const offset  = aligned - base;
+
+    if (offset + size <= head_->capacity) {
+      head_->used = offset + size;
+      return head_->data() + offset;
+    }
+  }
+
+  // chunks at least double in size so an exchange that keeps growing only costs a logarithmic
+  // number of trips to the heap
+  //
+  auto const capacity =
+    std::max(size + alignment, head_ ? head_->capacity * 2 : initial_capacity_);
+
+  push_chunk(capacity);
+  return allocate(size, alignment);
+}
+
+// only the most recent allocation can be given back, which covers the temporaries a container
+// creates and destroys right away
+//
+auto
+foxy::message_arena::deallocate(void* p, std::size_t const size) noexcept -> void
+{
+  if (!head_) { return; }
+
+  auto* const end = head_->data() + head_->used;
+  if (static_cast<unsigned char*>(p) + size == end) { head_->used -= size; }
+}
+
+auto
+foxy::message_arena::reset() -> void
+{
+  if (!head_) { return; }
+
+  if (!head_->next) {
+    head_->used = 0;
+    return;
+  }
+
+  auto const total = capacity();
+  free_chunks();
+  push_chunk(total);
+}
+
+auto
+foxy::message_arena::capacity() const noexcept -> std::size_t
+{
+  auto total = std::size_t{0};
+  for (auto* c = head_; c; c = c->next) { total += c->capacity; }
+  return total;
+}
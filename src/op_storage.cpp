@@ -0,0 +1,138 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/op_storage.hpp>
+
+#include <new>
+
+constexpr std::size_t foxy::op_storage::num_blocks;
+constexpr std::size_t foxy::op_storage::max_block_size;
+
+namespace
+{
+// every block is rounded up to a multiple of the granularity so that sizes which only differ by a
+// few bytes can share a block
+//
+constexpr std::size_t granularity = alignof(std::max_align_t) * 4;
+
+constexpr auto
+round_up(std::size_t const size) -> std::size_t
+{
+  return (size + granularity - 1) / granularity * granularity;
+}
+
+} // namespace
+
+foxy::op_storage::op_storage(bool const is_concurrent)
+  : is_concurrent_(is_concurrent)
+{
+  blocks_.fill(nullptr);
+  capacities_.fill(0);
+}
+
+foxy::op_storage::~op_storage()
+{
+  for (auto* block : blocks_) { ::operator delete(block); }
+}
+
+auto
+foxy::op_storage::lock() -> std::unique_lock<std::mutex>
+{
+  if (!is_concurrent_) { return std::unique_lock<std::mutex>(mutex_, std::defer_lock); }
+  return std::unique_lock<std::mutex>(mutex_);
+}
+
+auto
+foxy::op_storage::allocate(std::size_t const size) -> void*
+{
+  auto const capacity = round_up(size);
+  if (capacity > max_block_size) { return ::operator new(capacity); }
+
+  auto const guard = lock();
+
+  // the smallest free block that fits wastes the least
+  //
+  auto best = num_blocks;
+  for (std::size_t idx = 0; idx < num_blocks; ++idx) {
+    if (!blocks_[idx] || capacities_[idx] < capacity) { continue; }
+    if (best == num_blocks || capacities_[idx] < capacities_[best]) { best = idx; }
+  }
+
+  if (best == num_blocks) { return ::operator new(capacity); }
+
+  auto* const block = blocks_[best];
+  blocks_[best]     = nullptr;
+  return block;
+}
+
+// a reused block can be larger than the size it's freed with, remembering the smaller size only
+// means it won't be handed out for everything it could serve
+//
+auto
+foxy::op_storage::deallocate(void* p, std::size_t const size) -> void
+{
+  auto const capacity = round_up(size);
+  if (capacity > max_block_size) {
+    ::operator delete(p);
+    return;
+  }
+
+  auto const guard = lock();
+
+  // keep the larger blocks around, they can serve any request a smaller one could
+  //
+  auto smallest = std::size_t{0};
+  for (std::size_t idx = 0; idx < num_blocks; ++idx) {
+    if (!blocks_[idx]) {
+      blocks_[idx]     = p;
+      capacities_[idx] = capacity;
+      return;
+    }
+    if (capacities_[idx] < capacities_[smallest]) { smallest = idx; }
+  }
+
+  if (capacities_[smallest] < capacity) {
+    ::operator delete(blocks_[smallest]);
+    blocks_[smallest]     = p;
+    capacities_[smallest] = capacity;
+    return;
+  }
+
+  ::operator delete(p);
+}
+
+// a storage that's only ever used by one thread gets by without the read-modify-write
+//
+auto
+foxy::intrusive_ptr_add_ref(op_storage* storage) -> void
+{
+  auto& refs = storage->refs_;
+
+  if (storage->is_concurrent_) {
+    refs.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  refs.store(refs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+auto
+foxy::intrusive_ptr_release(op_storage* storage) -> void
+{
+  auto& refs = storage->refs_;
+
+  if (storage->is_concurrent_) {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) { delete storage; }
+    return;
+  }
+
+  auto const n = refs.load(std::memory_order_relaxed) - 1;
+  refs.store(n, std::memory_order_relaxed);
+  if (n == 0) { delete storage; }
+}
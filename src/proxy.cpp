@@ -11,9 +11,12 @@
 #include <foxy/server_session.hpp>
 #include <foxy/client_session.hpp>
 #include <foxy/log.hpp>
+#include <foxy/message_arena.hpp>
+#include <foxy/op_storage.hpp>
+#include <foxy/upstream_pool.hpp>
 #include <foxy/utility.hpp>
 
-#include <foxy/detail/relay.hpp>
+#include <foxy/detail/duplex_relay.hpp>
 #include <foxy/detail/tunnel.hpp>
 
 #include <boost/beast/http/parser.hpp>
@@ -26,6 +29,7 @@
 
 #include <boost/optional/optional.hpp>
 #include <boost/asio/error.hpp>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
 
 #include <memory>
 #include <iostream>
@@ -41,6 +45,16 @@ using namespace std::placeholders;
 
 namespace
 {
+// async_connect_op drives a client's connection from the moment it's accepted until it's torn down
+//
+// Everything it starts, the tunnel and the relays along with the asio operations they start in
+// turn, allocates from the connection's own `storage`, which the op associates with itself. A
+// connection keeps cycling through the same handful of operations so after its first request it
+// mostly runs off of blocks it has already freed instead of going back to the heap.
+//
+// The headers of each exchange are kept in the connection's `arena` instead, which is reset once
+// the exchange is over.
+//
 struct async_connect_op : boost::asio::coroutine
 {
   struct state
@@ -49,22 +63,48 @@ struct async_connect_op : boost::asio::coroutine
     //
     foxy::server_session session;
 
-    // our session with the client's intended remote
+    // our session with the client's intended remote for CONNECT tunnels, absolute-form requests
+    // are relayed over connections drawn from the pool instead
     //
     foxy::client_session client;
 
+    std::shared_ptr<foxy::upstream_pool> pool;
+
     http::response_parser<http::empty_body> shutdown_parser;
 
-    state(foxy::multi_stream stream, foxy::session_opts const& client_opts)
+    boost::intrusive_ptr<foxy::op_storage> storage;
+
+    foxy::message_arena arena;
+
+    // the request parser for exchanges relayed over a CONNECT tunnel that turned out to be carrying
+    // plain HTTP
+    //
+    optional<http::request_parser<http::empty_body, foxy::arena_allocator<char>>> parser;
+
+    state(foxy::multi_stream                   stream,
+          foxy::session_opts const&            client_opts,
+          std::shared_ptr<foxy::upstream_pool> pool_)
       : session(std::move(stream))
       , client(session.get_executor().context(), client_opts)
+      , pool(std::move(pool_))
+      , storage(new foxy::op_storage(foxy::server_session::is_concurrent))
     {
     }
   };
 
   std::unique_ptr<state> p_;
 
-  async_connect_op(foxy::multi_stream stream, foxy::session_opts const& client_opts);
+  async_connect_op(foxy::multi_stream                   stream,
+                   foxy::session_opts const&            client_opts,
+                   std::shared_ptr<foxy::upstream_pool> pool);
+
+  using allocator_type = foxy::op_allocator<void>;
+
+  auto
+  get_allocator() const noexcept -> allocator_type
+  {
+    return allocator_type(p_->storage);
+  }
 
   auto
   operator()(boost::system::error_code ec, bool close) -> void;
@@ -74,10 +114,23 @@ struct async_connect_op : boost::asio::coroutine
 foxy::proxy::proxy(boost::asio::io_context& io,
                    endpoint_type const&     endpoint,
                    bool                     reuse_addr,
-                   foxy::session_opts       client_opts)
+                   foxy::session_opts       client_opts,
+                   upstream_pool_opts       pool_opts)
   : stream_(io)
   , acceptor_(io, endpoint, reuse_addr)
   , client_opts_(std::move(client_opts))
+  , pool_(std::make_shared<::foxy::upstream_pool>(io, client_opts_, pool_opts))
+{
+}
+
+foxy::proxy::proxy(boost::asio::io_context& io,
+                   acceptor_type            acceptor,
+                   foxy::session_opts       client_opts,
+                   upstream_pool_opts       pool_opts)
+  : stream_(io)
+  , acceptor_(std::move(acceptor))
+  , client_opts_(std::move(client_opts))
+  , pool_(std::make_shared<::foxy::upstream_pool>(io, client_opts_, pool_opts))
 {
 }
 
@@ -93,6 +146,18 @@ foxy::proxy::cancel(boost::system::error_code& ec) -> void
   acceptor_.cancel(ec);
 }
 
+auto
+foxy::proxy::local_endpoint() const -> endpoint_type
+{
+  return acceptor_.local_endpoint();
+}
+
+auto
+foxy::proxy::pool() noexcept -> ::foxy::upstream_pool&
+{
+  return *pool_;
+}
+
 auto
 foxy::proxy::async_accept() -> void
 {
@@ -119,15 +184,22 @@ foxy::proxy::loop(boost::system::error_code ec) -> void
         continue;
       }
 
-      async_connect_op(std::move(stream_), client_opts_)({}, false);
+      // the relays write a header and its body separately so Nagle's algorithm is turned off, the
+      // socket works just as well with it on if the option can't be set
+      //
+      stream_.plain().set_option(tcp::no_delay(true), ec);
+
+      async_connect_op(std::move(stream_), client_opts_, pool_)({}, false);
     }
   }
 }
 
 namespace
 {
-async_connect_op::async_connect_op(foxy::multi_stream stream, foxy::session_opts const& client_opts)
-  : p_(std::make_unique<state>(std::move(stream), client_opts))
+async_connect_op::async_connect_op(foxy::multi_stream                   stream,
+                                   foxy::session_opts const&            client_opts,
+                                   std::shared_ptr<foxy::upstream_pool> pool)
+  : p_(std::make_unique<state>(std::move(stream), client_opts, std::move(pool)))
 {
 }
 
@@ -139,13 +211,21 @@ async_connect_op::operator()(boost::system::error_code ec, bool close_tunnel) ->
   {
     while (true) {
       BOOST_ASIO_CORO_YIELD
-      ::foxy::detail::async_tunnel(s.session, s.client, std::move(*this));
+      ::foxy::detail::async_tunnel(s.session, s.client, *s.pool, s.arena, std::move(*this));
       if (ec) { break; }
 
       if (close_tunnel) { break; }
 
       BOOST_ASIO_CORO_YIELD
-      ::foxy::detail::async_relay(s.session, s.client, std::move(*this));
+      {
+        s.arena.reset();
+        s.parser.emplace(std::piecewise_construct, std::make_tuple(),
+                         std::make_tuple(foxy::arena_allocator<char>(s.arena)));
+
+        ::foxy::detail::async_duplex_relay(s.session, s.client, std::move(*s.parser),
+                                           std::move(*this));
+      }
+      s.parser.reset();
       if (ec) { break; }
 
       if (close_tunnel) { break; }
@@ -174,7 +254,11 @@ async_connect_op::operator()(boost::system::error_code ec, bool close_tunnel) ->
     s.session.stream.plain().shutdown(tcp::socket::shutdown_receive, ec);
     s.session.stream.plain().close(ec);
 
+    // the client session is only ever connected when the tunnel was a CONNECT
+    //
     if (s.client.stream.is_ssl()) {
+      if (!s.client.stream.ssl().next_layer().is_open()) { return; }
+
       BOOST_ASIO_CORO_YIELD
       s.client.stream.ssl().async_shutdown(std::bind(std::move(*this), _1, true));
 
@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/session_deadline.hpp>
+
+#include <algorithm>
+
+foxy::session_deadline::session_deadline() { start(); }
+
+auto
+foxy::session_deadline::start() -> void
+{
+  start_         = clock_type::now();
+  last_progress_ = start_;
+  num_bytes_     = 0;
+}
+
+auto
+foxy::session_deadline::progress(std::size_t const num_bytes) -> void
+{
+  last_progress_ = clock_type::now();
+  num_bytes_ += num_bytes;
+}
+
+auto
+foxy::session_deadline::num_bytes() const noexcept -> std::uint64_t
+{
+  return num_bytes_;
+}
+
+auto
+foxy::session_deadline::last_progress() const noexcept -> time_point
+{
+  return last_progress_;
+}
+
+auto
+foxy::session_deadline::expiry(deadline_opts const& opts) const -> time_point
+{
+  auto expiry = time_point::max();
+
+  if (opts.exchange > duration::zero()) { expiry = start_ + opts.exchange; }
+
+  // the bytes moved so far buy the exchange this much time on top of the grace period, it falls
+  // behind the minimum rate once that's used up
+  //
+  if (opts.min_rate > 0) {
+    auto const earned = std::chrono::duration_cast<duration>(std::chrono::duration<double>(
+      static_cast<double>(num_bytes_) / static_cast<double>(opts.min_rate)));
+
+    expiry = std::min(expiry, start_ + opts.min_rate_grace + earned);
+  }
+
+  return expiry;
+}
+
+auto
+foxy::session_deadline::idle_expiry(duration const idle) const -> time_point
+{
+  if (idle <= duration::zero()) { return time_point::max(); }
+  return last_progress_ + idle;
+}
@@ -0,0 +1,47 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/session_timer.hpp>
+
+foxy::session_timer::session_timer(boost::asio::io_context& io, bool const use_wheel)
+  : io_(&io)
+  , steady_(io)
+  , wheel_(use_wheel ? std::make_unique<wheel_timer>(io) : nullptr)
+{
+}
+
+auto
+foxy::session_timer::get_executor() noexcept -> executor_type
+{
+  return io_->get_executor();
+}
+
+auto
+foxy::session_timer::expiry() const -> time_point
+{
+  return wheel_ ? wheel_->expiry() : steady_.expiry();
+}
+
+auto
+foxy::session_timer::expires_at(time_point const expiry) -> std::size_t
+{
+  return wheel_ ? wheel_->expires_at(expiry) : steady_.expires_at(expiry);
+}
+
+auto
+foxy::session_timer::expires_after(duration const d) -> std::size_t
+{
+  return wheel_ ? wheel_->expires_after(d) : steady_.expires_after(d);
+}
+
+auto
+foxy::session_timer::cancel() -> std::size_t
+{
+  return wheel_ ? wheel_->cancel() : steady_.cancel();
+}
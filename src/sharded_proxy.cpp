@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/sharded_proxy.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/detail/socket_option.hpp>
+
+#include <boost/system/system_error.hpp>
+
+#include <algorithm>
+
+using boost::asio::ip::tcp;
+
+namespace net = boost::asio;
+
+namespace
+{
+#if defined(SO_REUSEPORT)
+using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
+auto
+make_acceptor(net::io_context& io, tcp::endpoint const& endpoint, bool const is_sharded)
+  -> tcp::acceptor
+{
+  auto acceptor = tcp::acceptor(io);
+
+  acceptor.open(endpoint.protocol());
+  acceptor.set_option(net::socket_base::reuse_address(true));
+
+  if (is_sharded) {
+#if defined(SO_REUSEPORT)
+    acceptor.set_option(reuse_port(true));
+#else
+    throw boost::system::system_error(net::error::operation_not_supported);
+#endif
+  }
+
+  acceptor.bind(endpoint);
+  acceptor.listen(net::socket_base::max_listen_connections);
+
+  return acceptor;
+}
+
+} // namespace
+
+foxy::sharded_proxy::shard::shard()
+  : io(1)
+{
+}
+
+foxy::sharded_proxy::sharded_proxy(endpoint_type const& endpoint,
+                                   std::size_t          num_shards,
+                                   session_opts         client_opts,
+                                   upstream_pool_opts   pool_opts)
+  : endpoint_(endpoint)
+{
+  if (num_shards == 0) {
+    num_shards = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  auto const is_sharded = num_shards > 1;
+
+  shards_.reserve(num_shards);
+  for (std::size_t idx = 0; idx < num_shards; ++idx) {
+    auto s = std::make_unique<shard>();
+
+    auto acceptor = make_acceptor(s->io, endpoint_, is_sharded);
+
+    // an ephemeral port is only ever chosen once, every subsequent shard needs to share it
+    //
+    endpoint_ = acceptor.local_endpoint();
+
+    s->proxy =
+      std::make_shared<::foxy::proxy>(s->io, std::move(acceptor), client_opts, pool_opts);
+    shards_.push_back(std::move(s));
+  }
+}
+
+foxy::sharded_proxy::~sharded_proxy()
+{
+  stop();
+  join();
+}
+
+auto
+foxy::sharded_proxy::size() const noexcept -> std::size_t
+{
+  return shards_.size();
+}
+
+auto
+foxy::sharded_proxy::local_endpoint() const -> endpoint_type
+{
+  return endpoint_;
+}
+
+auto
+foxy::sharded_proxy::run() -> void
+{
+  for (auto& s : shards_) {
+    if (s->thread.joinable()) { continue; }
+
+    s->proxy->async_accept();
+    s->thread = std::thread([&io = s->io] { io.run(); });
+  }
+}
+
+auto
+foxy::sharded_proxy::stop() -> void
+{
+  for (auto& s : shards_) {
+    net::post(s->io, [proxy = s->proxy] {
+      auto ec = boost::system::error_code();
+      proxy->cancel(ec);
+    });
+  }
+}
+
+auto
+foxy::sharded_proxy::join() -> void
+{
+  for (auto& s : shards_) {
+    if (s->thread.joinable()) { s->thread.join(); }
+  }
+}
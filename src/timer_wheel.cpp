@@ -0,0 +1,274 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/timer_wheel.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace net = boost::asio;
+
+boost::asio::io_context::id foxy::timer_wheel::id;
+
+constexpr foxy::timer_wheel::clock_type::duration foxy::timer_wheel::resolution;
+constexpr std::size_t                             foxy::timer_wheel::slot_bits;
+constexpr std::size_t                             foxy::timer_wheel::num_slots;
+constexpr std::size_t                             foxy::timer_wheel::num_levels;
+
+foxy::timer_wheel::timer_wheel(boost::asio::io_context& io)
+  : boost::asio::io_context::service(io)
+  , io_(io)
+  , driver_(io)
+  , origin_(clock_type::now())
+{
+  for (auto& level : slots_) {
+    for (auto& sentinel : level) {
+      sentinel.prev = &sentinel;
+      sentinel.next = &sentinel;
+    }
+  }
+}
+
+// to_tick rounds up so that a timer is never considered expired before its deadline
+//
+auto
+foxy::timer_wheel::to_tick(clock_type::time_point const expiry) const -> std::uint64_t
+{
+  if (expiry <= origin_) { return 0; }
+
+  // the far end of the clock, which is what waiting forever looks like, can't be rounded up
+  //
+  auto const elapsed = expiry - origin_;
+  if (elapsed > clock_type::duration::max() - resolution) {
+    return std::numeric_limits<std::uint64_t>::max();
+  }
+
+  return static_cast<std::uint64_t>((elapsed + resolution - clock_type::duration{1}) / resolution);
+}
+
+auto
+foxy::timer_wheel::elapsed_ticks() const -> std::uint64_t
+{
+  return static_cast<std::uint64_t>((clock_type::now() - origin_) / resolution);
+}
+
+auto
+foxy::timer_wheel::link(node& n) -> void
+{
+  // an empty wheel has nothing to catch up on so it skips straight to the current tick
+  //
+  if (size_ == 0) { next_tick_ = std::max(next_tick_, elapsed_ticks() + 1); }
+
+  insert(n);
+  ++size_;
+  drive();
+}
+
+auto
+foxy::timer_wheel::unlink(node& n) -> void
+{
+  n.prev->next = n.next;
+  n.next->prev = n.prev;
+  n.prev       = nullptr;
+  n.next       = nullptr;
+  --size_;
+}
+
+// insert places the node in the lowest level whose span still covers its expiry, a level's slots
+// are each `num_slots` times wider than the ones of the level below
+//
+auto
+foxy::timer_wheel::insert(node& n) -> void
+{
+  auto const max_delta = (std::uint64_t{1} << (slot_bits * num_levels)) - 1;
+
+  auto expiry = std::max(n.expiry, next_tick_);
+  expiry      = std::min(expiry, next_tick_ + max_delta);
+
+  auto const delta = expiry - next_tick_;
+
+  auto level = std::size_t{0};
+  while (level + 1 < num_levels && delta >= (std::uint64_t{1} << (slot_bits * (level + 1)))) {
+    ++level;
+  }
+
+  auto& sentinel = slots_[level][(expiry >> (slot_bits * level)) & (num_slots - 1)];
+
+  n.prev              = sentinel.prev;
+  n.next              = &sentinel;
+  sentinel.prev->next = &n;
+  sentinel.prev       = &n;
+}
+
+// cascade moves every node out of the current slot of `level` and reinserts it further down now
+// that its expiry is close enough
+//
+auto
+foxy::timer_wheel::cascade(std::size_t const level) -> void
+{
+  auto& sentinel = slots_[level][(next_tick_ >> (slot_bits * level)) & (num_slots - 1)];
+
+  auto* n = sentinel.next;
+  sentinel.prev = &sentinel;
+  sentinel.next = &sentinel;
+
+  while (n != &sentinel) {
+    auto* const next = n->next;
+    insert(*n);
+    n = next;
+  }
+}
+
+// advance processes every tick up to and including the current time, firing whatever expired
+//
+auto
+foxy::timer_wheel::advance() -> void
+{
+  auto const now = elapsed_ticks();
+
+  while (next_tick_ <= now && size_ > 0) {
+    for (std::size_t level = 1; level < num_levels; ++level) {
+      if ((next_tick_ & ((std::uint64_t{1} << (slot_bits * level)) - 1)) != 0) { break; }
+      cascade(level);
+    }
+
+    auto& sentinel = slots_[0][next_tick_ & (num_slots - 1)];
+    ++next_tick_;
+
+    while (sentinel.next != &sentinel) {
+      auto& n = *sentinel.next;
+      unlink(n);
+
+      auto* op = n.first;
+      n.first  = nullptr;
+      n.last   = nullptr;
+
+      while (op) {
+        auto* const next = op->next;
+        op->complete({});
+        op = next;
+      }
+    }
+  }
+}
+
+auto
+foxy::timer_wheel::drive() -> void
+{
+  if (is_driving_ || size_ == 0) { return; }
+
+  is_driving_ = true;
+  driver_.expires_at(origin_ + next_tick_ * resolution);
+  driver_.async_wait([this](boost::system::error_code ec) {
+    is_driving_ = false;
+    if (ec == net::error::operation_aborted) { return; }
+
+    advance();
+    drive();
+  });
+}
+
+auto
+foxy::timer_wheel::shutdown() -> void
+{
+  for (auto& level : slots_) {
+    for (auto& sentinel : level) {
+      while (sentinel.next != &sentinel) {
+        auto& n = *sentinel.next;
+        unlink(n);
+
+        auto* op = n.first;
+        n.first  = nullptr;
+        n.last   = nullptr;
+
+        while (op) {
+          auto* const next = op->next;
+          op->destroy();
+          op = next;
+        }
+      }
+    }
+  }
+}
+
+auto
+foxy::timer_wheel::size() const noexcept -> std::size_t
+{
+  return size_;
+}
+
+foxy::wheel_timer::wheel_timer(boost::asio::io_context& io)
+  : wheel_(boost::asio::use_service<timer_wheel>(io))
+{
+}
+
+foxy::wheel_timer::~wheel_timer() { cancel(); }
+
+auto
+foxy::wheel_timer::get_executor() noexcept -> executor_type
+{
+  return wheel_.io_.get_executor();
+}
+
+auto
+foxy::wheel_timer::expiry() const noexcept -> time_point
+{
+  return expiry_;
+}
+
+auto
+foxy::wheel_timer::expires_at(time_point const expiry) -> std::size_t
+{
+  auto const num_cancelled = cancel();
+  expiry_                  = expiry;
+  return num_cancelled;
+}
+
+auto
+foxy::wheel_timer::expires_after(duration const d) -> std::size_t
+{
+  return expires_at(clock_type::now() + d);
+}
+
+auto
+foxy::wheel_timer::cancel() -> std::size_t
+{
+  if (!node_.first) { return 0; }
+
+  wheel_.unlink(node_);
+
+  auto* op    = node_.first;
+  node_.first = nullptr;
+  node_.last  = nullptr;
+
+  auto num_cancelled = std::size_t{0};
+  while (op) {
+    auto* const next = op->next;
+    op->complete(net::error::operation_aborted);
+    op = next;
+    ++num_cancelled;
+  }
+
+  return num_cancelled;
+}
+
+auto
+foxy::wheel_timer::add(timer_wheel::wait_op_base* op) -> void
+{
+  if (node_.last) {
+    node_.last->next = op;
+    node_.last       = op;
+    return;
+  }
+
+  node_.first  = op;
+  node_.last   = op;
+  node_.expiry = wheel_.to_tick(expiry_);
+  wheel_.link(node_);
+}
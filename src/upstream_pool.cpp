@@ -0,0 +1,235 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/upstream_pool.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <boost/container_hash/hash.hpp>
+
+#include <algorithm>
+
+using boost::asio::ip::tcp;
+
+namespace net = boost::asio;
+
+namespace
+{
+auto
+lowest_layer(foxy::client_session& session) -> tcp::socket&
+{
+  return session.stream.is_ssl() ? session.stream.ssl().next_layer() : session.stream.plain();
+}
+
+auto
+close(foxy::client_session& session) -> void
+{
+  auto& socket = lowest_layer(session);
+
+  auto ec = boost::system::error_code();
+  socket.shutdown(tcp::socket::shutdown_both, ec);
+  socket.close(ec);
+}
+
+} // namespace
+
+auto
+foxy::upstream_key::hash::operator()(upstream_key const& key) const noexcept -> std::size_t
+{
+  auto seed = std::size_t{0};
+  boost::hash_combine(seed, key.scheme);
+  boost::hash_combine(seed, key.host);
+  boost::hash_combine(seed, key.port);
+  return seed;
+}
+
+foxy::upstream_pool::waiter::waiter(upstream_pool&      pool_,
+                                    upstream_key const& key_,
+                                    session_ptr&        session_)
+  : timer(pool_.io_)
+  , session(&session_)
+  , start(clock_type::now())
+  , ec(net::error::operation_aborted)
+  , pool(&pool_)
+  , key(key_)
+{
+  timer.expires_after(pool_.opts_.acquire_timeout);
+}
+
+foxy::upstream_pool::upstream_pool(boost::asio::io_context& io,
+                                   session_opts             client_opts,
+                                   upstream_pool_opts       opts)
+  : io_(io)
+  , client_opts_(std::move(client_opts))
+  , opts_(opts)
+{
+  opts_.max_per_host = std::max<std::size_t>(opts_.max_per_host, 1);
+}
+
+foxy::upstream_pool::~upstream_pool()
+{
+  for (auto& entry : hosts_) {
+    for (auto& w : entry.second.waiters) {
+      w->pool = nullptr;
+      w->timer.cancel();
+    }
+  }
+}
+
+auto
+foxy::upstream_pool::try_acquire(upstream_key const& key, session_ptr& session) -> bool
+{
+  auto& h = hosts_[key];
+
+  // warm connections are handed out most-recently-used first, the ones at the back are the least
+  // likely to have been closed by the remote
+  //
+  auto const now = clock_type::now();
+  while (!h.idle.empty()) {
+    auto idle = std::move(h.idle.back());
+    h.idle.pop_back();
+    --num_idle_;
+
+    if (now - idle.since < opts_.idle_timeout && is_alive(*idle.session)) {
+      session = std::move(idle.session);
+      ++stats_.hits;
+      return true;
+    }
+
+    close(*idle.session);
+    --h.num_sessions;
+  }
+
+  if (h.num_sessions < opts_.max_per_host) {
+    ++h.num_sessions;
+    session = std::make_unique<session_type>(io_, client_opts_);
+    ++stats_.misses;
+    return true;
+  }
+
+  return false;
+}
+
+auto
+foxy::upstream_pool::enqueue(upstream_key const& key, session_ptr& session)
+  -> std::shared_ptr<waiter>
+{
+  auto w = std::make_shared<waiter>(*this, key, session);
+  hosts_[key].waiters.push_back(w);
+  ++stats_.waits;
+  return w;
+}
+
+auto
+foxy::upstream_pool::abandon(waiter const& w) -> void
+{
+  auto& waiters = hosts_.at(w.key).waiters;
+
+  auto pos = std::find_if(waiters.begin(), waiters.end(),
+                          [&](std::shared_ptr<waiter> const& p) { return p.get() == &w; });
+
+  if (pos != waiters.end()) { waiters.erase(pos); }
+}
+
+auto
+foxy::upstream_pool::release(upstream_key const& key, session_ptr session, bool const is_reusable)
+  -> void
+{
+  auto pos = hosts_.find(key);
+  if (pos == hosts_.end()) {
+    if (session) { close(*session); }
+    return;
+  }
+
+  auto& h = pos->second;
+
+  auto const serve = [&](session_ptr s) {
+    auto w = std::move(h.waiters.front());
+    h.waiters.pop_front();
+
+    *w->session = std::move(s);
+    w->ec       = {};
+    stats_.wait_time += clock_type::now() - w->start;
+
+    w->timer.cancel();
+  };
+
+  auto const can_reuse = is_reusable && session && session->buffer.size() == 0 &&
+                         lowest_layer(*session).is_open();
+
+  if (can_reuse) {
+    if (!h.waiters.empty()) {
+      ++stats_.hits;
+      return serve(std::move(session));
+    }
+
+    if (h.idle.size() < opts_.max_idle_per_host && num_idle_ < opts_.max_idle) {
+      h.idle.push_back(idle_session{std::move(session), clock_type::now()});
+      ++num_idle_;
+      return;
+    }
+  }
+
+  if (session) { close(*session); }
+  session.reset();
+
+  // the slot this session took up under `max_per_host` is free again so the next acquirer in line
+  // gets to open a new connection in its place
+  //
+  if (!h.waiters.empty()) {
+    ++stats_.misses;
+    return serve(std::make_unique<session_type>(io_, client_opts_));
+  }
+
+  --h.num_sessions;
+  if (h.num_sessions == 0 && h.idle.empty()) { hosts_.erase(pos); }
+}
+
+// an idle keep-alive connection has nothing to say, if the remote sent anything while the
+// connection sat unused it's either a FIN or bytes that don't belong to any request
+//
+// Over TLS the peeked byte is the content type of the next record. Post-handshake messages arrive
+// as application data under TLS 1.3 so they can't be told apart from a stray response, only an
+// alert (a close_notify most likely) is taken as the remote going away.
+//
+auto
+foxy::upstream_pool::is_alive(session_type& session) -> bool
+{
+  auto& socket = lowest_layer(session);
+  if (!socket.is_open()) { return false; }
+
+  auto ec = boost::system::error_code();
+  socket.non_blocking(true, ec);
+  if (ec) { return false; }
+
+  char c;
+  auto const n        = socket.receive(net::buffer(&c, 1), tcp::socket::message_peek, ec);
+  auto const is_quiet = (ec == net::error::would_block);
+
+  auto const tls_alert = char{21};
+  auto const is_usable =
+    is_quiet || (!ec && n == 1 && session.stream.is_ssl() && c != tls_alert);
+
+  socket.non_blocking(false, ec);
+  return is_usable && !ec;
+}
+
+auto
+foxy::upstream_pool::stats() const noexcept -> upstream_pool_stats const&
+{
+  return stats_;
+}
+
+auto
+foxy::upstream_pool::num_idle() const noexcept -> std::size_t
+{
+  return num_idle_;
+}
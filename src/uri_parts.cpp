@@ -11,6 +11,17 @@
 #include <foxy/uri_parts.hpp>
 #include <foxy/uri.hpp>
 
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FOXY_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace x3 = boost::spirit::x3;
 
 auto
@@ -151,10 +162,244 @@ upcall:
   return false;
 }
 
+// The fast path covers the targets a proxy sees over and over again and leaves everything else to
+// the grammar above:
+//
+// * authority-form, `host:port`
+// * absolute-form without userinfo or a fragment, `scheme://host[:port][/path][?query]`
+// * origin-form, `/path[?query]`
+//
+// The host has to start with a letter so it can only ever be a reg-name, IP literals and IPv4
+// addresses always go through the grammar. Whenever the fast path does handle a target, it comes
+// up with exactly the ranges the grammar would have.
+//
+
+enum char_class : std::uint8_t
+{
+  alpha_class    = 1,
+  scheme_class   = 2,
+  reg_name_class = 4,
+  digit_class    = 8,
+  hex_class      = 16,
+  path_class     = 32,
+  query_class    = 64
+};
+
+struct char_table
+{
+  std::uint8_t classes[256];
+};
+
+constexpr auto
+is_one_of(unsigned const c, char const* set) -> bool
+{
+  for (; *set != '\0'; ++set) {
+    if (c == static_cast<unsigned char>(*set)) { return true; }
+  }
+  return false;
+}
+
+constexpr auto
+make_char_table() -> char_table
+{
+  auto table = char_table{};
+
+  for (unsigned c = 0; c < 256; ++c) {
+    auto const is_alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    auto const is_digit = c >= '0' && c <= '9';
+
+    // pct-encoded is left out, a '%' stops a scan and is checked on its own
+    //
+    auto const is_unreserved = is_alpha || is_digit || is_one_of(c, "-._~");
+    auto const is_sub_delim  = is_one_of(c, "!$&'()*+,;=");
+    auto const is_pchar      = is_unreserved || is_sub_delim || c == ':' || c == '@';
+
+    std::uint8_t classes = 0;
+    if (is_alpha) { classes |= alpha_class; }
+    if (is_alpha || is_digit || is_one_of(c, "+-.")) { classes |= scheme_class; }
+    if (is_unreserved || is_sub_delim) { classes |= reg_name_class; }
+    if (is_digit) { classes |= digit_class; }
+    if (is_digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) { classes |= hex_class; }
+    if (is_pchar || c == '/') { classes |= path_class; }
+    if (is_pchar || c == '/' || c == '?') { classes |= query_class; }
+
+    table.classes[c] = classes;
+  }
+  return table;
+}
+
+constexpr char_table char_classes = make_char_table();
+
+auto
+is_class(char const c, std::uint8_t const mask) noexcept -> bool
+{
+  return (char_classes.classes[static_cast<unsigned char>(c)] & mask) != 0;
+}
+
+auto
+scan(char const* pos, char const* const end, std::uint8_t const mask) noexcept -> char const*
+{
+  while (pos != end && is_class(*pos, mask)) { ++pos; }
+  return pos;
+}
+
+#ifdef FOXY_HAS_SSE2
+
+auto
+in_range(__m128i const block, char const lo, char const hi) noexcept -> __m128i
+{
+  return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                       _mm_cmplt_epi8(block, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+#endif // FOXY_HAS_SSE2
+
+// scan_path skips over the characters a path or, with `is_query` set, a query can be made of and
+// stops at the first delimiter, '%' or invalid character
+//
+// Every pchar other than '!', '$', '=', '_' and '~' falls within one of the ranges "&" to ";", "@"
+// to "Z" and "a" to "z" so a block of 16 is classified with a handful of comparisons. The
+// comparisons are signed, which keeps bytes above 0x7f out of every range.
+//
+auto
+scan_path(char const* pos, char const* const end, bool const is_query) noexcept -> char const*
+{
+#ifdef FOXY_HAS_SSE2
+  while (end - pos >= 16) {
+    auto const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pos));
+
+    auto valid = _mm_or_si128(_mm_or_si128(in_range(block, '&', ';'), in_range(block, '@', 'Z')),
+                              in_range(block, 'a', 'z'));
+
+    for (auto const c : {'!', '$', '=', '_', '~'}) {
+      valid = _mm_or_si128(valid, _mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+    }
+
+    if (is_query) { valid = _mm_or_si128(valid, _mm_cmpeq_epi8(block, _mm_set1_epi8('?'))); }
+
+    auto const invalid = static_cast<std::uint32_t>(~_mm_movemask_epi8(valid) & 0xffff);
+    if (invalid != 0) {
+#ifdef _MSC_VER
+      unsigned long idx = 0;
+      _BitScanForward(&idx, invalid);
+      return pos + idx;
+#else
+      return pos + __builtin_ctz(invalid);
+#endif
+    }
+    pos += 16;
+  }
+#endif // FOXY_HAS_SSE2
+
+  return scan(pos, end, is_query ? query_class : path_class);
+}
+
+// scan_pct_encoded is scan_path that also steps over percent-encoded octets, it returns null when
+// a '%' isn't followed by two hex digits
+//
+auto
+scan_pct_encoded(char const* pos, char const* const end, bool const is_query) noexcept
+  -> char const*
+{
+  while (true) {
+    pos = scan_path(pos, end, is_query);
+    if (pos == end || *pos != '%') { return pos; }
+
+    if (end - pos < 3 || !is_class(pos[1], hex_class) || !is_class(pos[2], hex_class)) {
+      return nullptr;
+    }
+    pos += 3;
+  }
+}
+
+// parse_path_and_query fills in the path and the query starting at `pos`, which has to be followed
+// by nothing else
+//
+auto
+parse_path_and_query(char const* pos, char const* const end, foxy::uri_parts& parts) -> bool
+{
+  using range = foxy::uri_parts::range;
+
+  auto const* const path_end = scan_pct_encoded(pos, end, false);
+  if (!path_end) { return false; }
+
+  parts.path_ = range(pos, path_end);
+  if (path_end == end) { return true; }
+  if (*path_end != '?') { return false; }
+
+  auto const* const query_end = scan_pct_encoded(path_end + 1, end, true);
+  if (query_end != end) { return false; }
+
+  parts.query_ = range(path_end + 1, query_end);
+  return true;
+}
+
+auto
+parse_fast(boost::string_view const uri, foxy::uri_parts& parts) -> bool
+{
+  using range = foxy::uri_parts::range;
+
+  if (uri.empty()) { return false; }
+
+  auto const* const begin = uri.data();
+  auto const* const end   = begin + uri.size();
+
+  // origin-form only makes it past the grammar's authority parser, with an empty host
+  //
+  if (*begin == '/') {
+    parts.host_ = range(begin, begin);
+    return parse_path_and_query(begin, end, parts);
+  }
+
+  if (!is_class(*begin, alpha_class)) { return false; }
+
+  auto const* const scheme_end = scan(begin, end, scheme_class);
+
+  auto const is_absolute =
+    end - scheme_end >= 3 && scheme_end[0] == ':' && scheme_end[1] == '/' && scheme_end[2] == '/';
+
+  if (is_absolute) {
+    auto const* const host = scheme_end + 3;
+    if (host == end || !is_class(*host, alpha_class)) { return false; }
+
+    auto const* pos = scan(host, end, reg_name_class);
+
+    parts.scheme_ = range(begin, scheme_end);
+    parts.host_   = range(host, pos);
+
+    if (pos != end && *pos == ':') {
+      auto const* const port_end = scan(pos + 1, end, digit_class);
+
+      parts.port_ = range(pos + 1, port_end);
+      pos         = port_end;
+    }
+
+    // anything else, userinfo and percent-encoded hosts included, is the grammar's job
+    //
+    if (pos != end && *pos != '/' && *pos != '?') { return false; }
+
+    return parse_path_and_query(pos, end, parts);
+  }
+
+  // authority-form, the grammar's URI parser reads the host as a scheme and then fails on the port
+  // which leaves the rest to its authority parser
+  //
+  auto const* const host_end = scan(begin, end, reg_name_class);
+  if (host_end == end || *host_end != ':') { return false; }
+
+  auto const* const port_end = scan(host_end + 1, end, digit_class);
+  if (port_end == host_end + 1 || port_end != end) { return false; }
+
+  parts.host_ = range(begin, host_end);
+  parts.port_ = range(host_end + 1, port_end);
+  parts.path_ = range(end, end);
+  return true;
+}
+
 } // namespace
 
 auto
-foxy::parse_uri(boost::string_view const uri) -> foxy::uri_parts
+foxy::detail::parse_uri_grammar(boost::string_view const uri) -> foxy::uri_parts
 {
   auto parts = foxy::uri_parts();
   if (parse_complete(uri, parts)) { return parts; }
@@ -165,6 +410,15 @@ foxy::parse_uri(boost::string_view const uri) -> foxy::uri_parts
   return foxy::uri_parts();
 }
 
+auto
+foxy::parse_uri(boost::string_view const uri) -> foxy::uri_parts
+{
+  auto parts = foxy::uri_parts();
+  if (parse_fast(uri, parts)) { return parts; }
+
+  return foxy::detail::parse_uri_grammar(uri);
+}
+
 auto
 foxy::uri_parts::is_http() const noexcept -> bool
 {
@@ -183,3 +437,89 @@ foxy::uri_parts::is_absolute() const noexcept -> bool
 {
   return !scheme().empty() && fragment().empty();
 }
+
+constexpr std::size_t foxy::compact_uri_parts::max_size;
+
+foxy::compact_uri_parts::compact_uri_parts(uri_parts const& parts, string_view const uri) noexcept
+{
+  if (uri.size() > max_size) { return; }
+
+  // a portion the parser never set is left as an empty part at the start of the URI
+  //
+  auto const to_part = [uri](uri_parts::range const& range) {
+    auto p = part();
+    if (range.begin() == nullptr) { return p; }
+
+    p.offset = static_cast<std::uint16_t>(range.begin() - uri.data());
+    p.size   = static_cast<std::uint16_t>(range.end() - range.begin());
+    return p;
+  };
+
+  scheme_   = to_part(parts.scheme_);
+  host_     = to_part(parts.host_);
+  port_     = to_part(parts.port_);
+  path_     = to_part(parts.path_);
+  query_    = to_part(parts.query_);
+  fragment_ = to_part(parts.fragment_);
+}
+
+auto
+foxy::compact_uri_parts::scheme(string_view const uri) const noexcept -> string_view
+{
+  return string_view(uri.data() + scheme_.offset, scheme_.size);
+}
+
+auto
+foxy::compact_uri_parts::host(string_view const uri) const noexcept -> string_view
+{
+  return string_view(uri.data() + host_.offset, host_.size);
+}
+
+auto
+foxy::compact_uri_parts::port(string_view const uri) const noexcept -> string_view
+{
+  return string_view(uri.data() + port_.offset, port_.size);
+}
+
+auto
+foxy::compact_uri_parts::path(string_view const uri) const noexcept -> string_view
+{
+  return string_view(uri.data() + path_.offset, path_.size);
+}
+
+auto
+foxy::compact_uri_parts::query(string_view const uri) const noexcept -> string_view
+{
+  return string_view(uri.data() + query_.offset, query_.size);
+}
+
+auto
+foxy::compact_uri_parts::fragment(string_view const uri) const noexcept -> string_view
+{
+  return string_view(uri.data() + fragment_.offset, fragment_.size);
+}
+
+auto
+foxy::compact_uri_parts::is_http(string_view const uri) const noexcept -> bool
+{
+  return scheme(uri) == "http" || scheme(uri) == "https";
+}
+
+auto
+foxy::compact_uri_parts::is_authority() const noexcept -> bool
+{
+  return scheme_.size == 0 && host_.size != 0 && path_.size == 0 && query_.size == 0 &&
+         fragment_.size == 0;
+}
+
+auto
+foxy::compact_uri_parts::is_absolute() const noexcept -> bool
+{
+  return scheme_.size != 0 && fragment_.size == 0;
+}
+
+auto
+foxy::parse_compact_uri(boost::string_view const uri) -> foxy::compact_uri_parts
+{
+  return foxy::compact_uri_parts(foxy::parse_uri(uri), uri);
+}
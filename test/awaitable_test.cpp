@@ -0,0 +1,347 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/awaitable.hpp>
+
+#ifdef FOXY_HAS_CO_AWAIT
+
+#include <foxy/client_session.hpp>
+#include <foxy/server_session.hpp>
+#include <foxy/forward_requests.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <boost/optional/optional.hpp>
+
+#include <exception>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+namespace
+{
+auto
+loopback() -> tcp::endpoint
+{
+  return tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0);
+}
+
+// rethrow makes an exception that escapes a coroutine escape `io.run()` too so Catch gets to see it
+//
+auto
+rethrow(std::exception_ptr e) -> void
+{
+  if (e) { std::rethrow_exception(e); }
+}
+
+} // namespace
+
+TEST_CASE("Our awaitable sessions")
+{
+  SECTION("should read and write messages from a coroutine")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, loopback());
+    auto server   = foxy::server_session(foxy::multi_stream(io));
+    auto client   = foxy::client_session(io);
+
+    auto was_served = false;
+
+    asio::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await acceptor.async_accept(server.stream.plain(), asio::use_awaitable);
+
+        auto parser = http::request_parser<http::string_body>();
+        co_await server.async_read_header(parser);
+        CHECK(parser.is_header_done());
+
+        co_await server.async_read(parser);
+        CHECK(parser.is_done());
+
+        auto res   = http::response<http::string_body>(http::status::ok, 11);
+        res.body() = parser.get().body();
+        res.prepare_payload();
+
+        auto serializer = http::response_serializer<http::string_body>(res);
+        co_await server.async_write_header(serializer);
+        co_await server.async_write(serializer);
+      },
+      rethrow);
+
+    asio::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        auto const endpoint = acceptor.local_endpoint();
+        co_await client.async_connect(endpoint.address().to_string(),
+                                      std::to_string(endpoint.port()));
+
+        auto req   = http::request<http::string_body>(http::verb::post, "/", 11);
+        req.body() = "a body worth echoing";
+        req.prepare_payload();
+
+        auto parser = http::response_parser<http::string_body>();
+        co_await client.async_request(req, parser);
+
+        CHECK(parser.get().result() == http::status::ok);
+        CHECK(parser.get().body() == "a body worth echoing");
+        was_served = true;
+      },
+      rethrow);
+
+    io.run();
+    CHECK(was_served);
+  }
+
+  SECTION("should throw when an operation fails")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, loopback());
+    auto server   = foxy::server_session(foxy::multi_stream(io));
+    auto peer     = tcp::socket(io);
+
+    auto was_thrown = false;
+
+    asio::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await acceptor.async_accept(server.stream.plain(), asio::use_awaitable);
+
+        try {
+          auto parser = http::request_parser<http::empty_body>();
+          co_await server.async_read_header(parser);
+        }
+        catch (boost::system::system_error const& e) {
+          was_thrown = e.code() == http::error::end_of_stream;
+        }
+      },
+      rethrow);
+
+    peer.connect(acceptor.local_endpoint());
+    peer.shutdown(tcp::socket::shutdown_send);
+
+    io.run();
+    CHECK(was_thrown);
+  }
+
+  SECTION("should forward absolute-form requests from a coroutine proxy loop")
+  {
+    asio::io_context io;
+
+    auto origin_acceptor = tcp::acceptor(io, loopback());
+    auto proxy_acceptor  = tcp::acceptor(io, loopback());
+
+    auto origin = foxy::server_session(foxy::multi_stream(io));
+    auto proxy  = foxy::server_session(foxy::multi_stream(io));
+    auto client = foxy::client_session(io);
+
+    auto num_origin_requests = 0;
+    auto is_done             = false;
+
+    // the origin answers every request with the target it was sent, the proxy is expected to have
+    // turned it into origin-form
+    //
+    asio::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await origin_acceptor.async_accept(origin.stream.plain(), asio::use_awaitable);
+
+        while (true) {
+          auto ec     = boost::system::error_code();
+          auto parser = http::request_parser<http::empty_body>();
+
+          try {
+            co_await origin.async_read(parser);
+          }
+          catch (boost::system::system_error const& e) {
+            ec = e.code();
+          }
+
+          if (ec) { co_return; }
+
+          ++num_origin_requests;
+          CHECK(parser.get().count(http::field::via) == 1);
+
+          auto res   = http::response<http::string_body>(http::status::ok, 11);
+          res.body() = static_cast<std::string>(parser.get().target());
+          res.prepare_payload();
+
+          co_await origin.async_write(res);
+        }
+      },
+      rethrow);
+
+    asio::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await proxy_acceptor.async_accept(proxy.stream.plain(), asio::use_awaitable);
+
+        // see forward_requests, the options are a named object rather than a braced temporary
+        //
+        auto const client_opts = foxy::session_opts();
+        co_await foxy::forward_requests(proxy, client_opts);
+      },
+      rethrow);
+
+    asio::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        auto const proxy_endpoint = proxy_acceptor.local_endpoint();
+        co_await client.async_connect(proxy_endpoint.address().to_string(),
+                                      std::to_string(proxy_endpoint.port()));
+
+        auto const origin_uri =
+          "http://127.0.0.1:" + std::to_string(origin_acceptor.local_endpoint().port());
+
+        auto const request =
+          [&](std::string target) -> foxy::awaitable<http::response<http::string_body>> {
+          auto req    = http::request<http::empty_body>(http::verb::get, target, 11);
+          auto parser = http::response_parser<http::string_body>();
+          co_await client.async_request(req, parser);
+          co_return parser.release();
+        };
+
+        auto res = co_await request(origin_uri + "/first");
+        CHECK(res.result() == http::status::ok);
+        CHECK(res.body() == "/first");
+        CHECK(res.count(http::field::via) == 1);
+
+        res = co_await request(origin_uri + "/second?with=query");
+        CHECK(res.body() == "/second?with=query");
+
+        res = co_await request("/not/absolute");
+        CHECK(res.result() == http::status::bad_request);
+
+        auto ec = boost::system::error_code();
+        client.stream.plain().shutdown(tcp::socket::shutdown_send, ec);
+
+        is_done = true;
+      },
+      rethrow);
+
+    io.run();
+
+    CHECK(is_done);
+    CHECK(num_origin_requests == 2);
+  }
+
+  SECTION("should keep the origin's framing for bodiless responses and answer failures with a 502")
+  {
+    asio::io_context io;
+
+    auto origin_acceptor = tcp::acceptor(io, loopback());
+    auto proxy_acceptor  = tcp::acceptor(io, loopback());
+
+    auto origin = foxy::server_session(foxy::multi_stream(io));
+    auto proxy  = foxy::server_session(foxy::multi_stream(io));
+    auto client = foxy::client_session(io);
+
+    auto is_done = false;
+
+    // the origin describes a body it never sends, first for a HEAD and then for a 304, and hangs up
+    // on whatever comes after
+    //
+    asio::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await origin_acceptor.async_accept(origin.stream.plain(), asio::use_awaitable);
+
+        auto parser = boost::optional<http::request_parser<http::empty_body>>();
+
+        parser.emplace();
+        co_await origin.async_read(*parser);
+        CHECK(parser->get().method() == http::verb::head);
+
+        auto head = http::response<http::empty_body>(http::status::ok, 11);
+        head.content_length(1234);
+        co_await origin.async_write(head);
+
+        parser.emplace();
+        co_await origin.async_read(*parser);
+
+        auto not_modified = http::response<http::empty_body>(http::status::not_modified, 11);
+        not_modified.content_length(42);
+        co_await origin.async_write(not_modified);
+
+        parser.emplace();
+        co_await origin.async_read(*parser);
+
+        auto ec = boost::system::error_code();
+        origin.stream.plain().shutdown(tcp::socket::shutdown_both, ec);
+        origin.stream.plain().close(ec);
+      },
+      rethrow);
+
+    asio::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await proxy_acceptor.async_accept(proxy.stream.plain(), asio::use_awaitable);
+
+        auto const client_opts = foxy::session_opts();
+        co_await foxy::forward_requests(proxy, client_opts);
+      },
+      rethrow);
+
+    asio::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        auto const proxy_endpoint = proxy_acceptor.local_endpoint();
+        co_await client.async_connect(proxy_endpoint.address().to_string(),
+                                      std::to_string(proxy_endpoint.port()));
+
+        auto const origin_uri =
+          "http://127.0.0.1:" + std::to_string(origin_acceptor.local_endpoint().port());
+
+        auto req    = http::request<http::empty_body>(http::verb::head, origin_uri + "/", 11);
+        auto parser = boost::optional<http::response_parser<http::string_body>>();
+
+        parser.emplace();
+        parser->skip(true);
+        co_await client.async_request(req, *parser);
+        CHECK(parser->get().result() == http::status::ok);
+        CHECK(parser->get()[http::field::content_length] == "1234");
+
+        req.method(http::verb::get);
+        parser.emplace();
+        co_await client.async_request(req, *parser);
+        CHECK(parser->get().result() == http::status::not_modified);
+        CHECK(parser->get()[http::field::content_length] == "42");
+
+        parser.emplace();
+        co_await client.async_request(req, *parser);
+        CHECK(parser->get().result() == http::status::bad_gateway);
+        CHECK(parser->get().keep_alive());
+
+        auto ec = boost::system::error_code();
+        client.stream.plain().shutdown(tcp::socket::shutdown_send, ec);
+
+        is_done = true;
+      },
+      rethrow);
+
+    io.run();
+
+    CHECK(is_done);
+  }
+}
+
+#endif // FOXY_HAS_CO_AWAIT
@@ -0,0 +1,194 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/dns_cache.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Our DNS cache")
+{
+  SECTION("should answer repeated and concurrent lookups without going back to the resolver")
+  {
+    asio::io_context io;
+
+    auto cache = foxy::dns_cache();
+
+    auto num_resolved = 0;
+    auto const check  = [&](boost::system::error_code ec, tcp::resolver::results_type results) {
+      REQUIRE(!ec);
+      REQUIRE(results.size() > 0);
+      CHECK(results.begin()->endpoint() == tcp::endpoint(ip::make_address_v4("127.0.0.1"), 80));
+      ++num_resolved;
+    };
+
+    cache.async_resolve(io, "127.0.0.1", "80", check);
+    cache.async_resolve(io, "127.0.0.1", "80", check);
+    io.run();
+
+    CHECK(num_resolved == 2);
+    CHECK(cache.stats().misses == 1);
+    CHECK(cache.stats().coalesced == 1);
+
+    io.restart();
+    cache.async_resolve(io, "127.0.0.1", "80", check);
+    io.run();
+
+    CHECK(num_resolved == 3);
+    CHECK(cache.stats().misses == 1);
+    CHECK(cache.stats().hits == 1);
+  }
+
+  SECTION("should remember failed lookups for the negative TTL")
+  {
+    asio::io_context io;
+
+    auto opts         = foxy::dns_cache_opts();
+    opts.negative_ttl = 0s;
+
+    auto remembers = foxy::dns_cache();
+    auto forgets   = foxy::dns_cache(opts);
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      for (auto* cache : {&remembers, &forgets}) {
+        for (auto idx = 0; idx < 2; ++idx) {
+          auto ec = boost::system::error_code();
+          cache->async_resolve(io, "127.0.0.1", "not-a-real-foxy-service", yield[ec]);
+          CHECK(ec);
+        }
+      }
+    });
+
+    io.run();
+
+    CHECK(remembers.stats().misses == 1);
+    CHECK(remembers.stats().negative_hits == 1);
+
+    CHECK(forgets.stats().misses == 2);
+    CHECK(forgets.stats().negative_hits == 0);
+  }
+
+  SECTION("should start over when the lookup it waits on is abandoned")
+  {
+    auto cache = foxy::dns_cache();
+
+    asio::io_context waiting;
+
+    auto abandoned = std::make_unique<asio::io_context>();
+
+    auto num_abandoned = 0;
+    cache.async_resolve(*abandoned, "127.0.0.1", "80",
+                        [&](boost::system::error_code, tcp::resolver::results_type) {
+                          ++num_abandoned;
+                        });
+
+    auto ec       = boost::system::error_code(asio::error::timed_out);
+    auto endpoint = tcp::endpoint();
+    cache.async_resolve(waiting, "127.0.0.1", "80",
+                        [&](boost::system::error_code ec_, tcp::resolver::results_type results) {
+                          ec = ec_;
+                          if (!ec) { endpoint = results.begin()->endpoint(); }
+                        });
+
+    // the lookup goes down with the io_context it was started on, without ever completing
+    //
+    abandoned.reset();
+
+    waiting.run_for(5s);
+
+    CHECK(num_abandoned == 0);
+    CHECK(!ec);
+    CHECK(endpoint == tcp::endpoint(ip::make_address_v4("127.0.0.1"), 80));
+    CHECK(cache.stats().misses == 2);
+    CHECK(cache.stats().coalesced == 1);
+  }
+
+  SECTION("should complete every coalesced lookup on an io_context run by several threads")
+  {
+    asio::io_context io;
+
+    // nothing is cached for long so lookups keep coalescing behind fresh misses
+    //
+    auto opts = foxy::dns_cache_opts();
+    opts.ttl  = 0s;
+
+    auto cache = foxy::dns_cache(opts);
+
+    auto const       num_lookups = 2000;
+    std::atomic<int> num_resolved{0};
+
+    for (auto idx = 0; idx < num_lookups; ++idx) {
+      asio::post(io, [&] {
+        cache.async_resolve(io, "127.0.0.1", "80",
+                            [&](boost::system::error_code ec, tcp::resolver::results_type) {
+                              if (!ec) { ++num_resolved; }
+                            });
+      });
+    }
+
+    // a waiter that missed its wakeup would keep the io_context busy until the time's up
+    //
+    auto threads = std::vector<std::thread>();
+    for (auto idx = 0; idx < 4; ++idx) {
+      threads.emplace_back([&] { io.run_for(10s); });
+    }
+    for (auto& t : threads) { t.join(); }
+
+    CHECK(num_resolved == num_lookups);
+    CHECK(cache.stats().coalesced > 0);
+  }
+
+  SECTION("should be used by client sessions to resolve the host they connect to")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+    auto port     = std::to_string(acceptor.local_endpoint().port());
+
+    auto opts      = foxy::session_opts();
+    opts.dns_cache = std::make_shared<foxy::dns_cache>();
+
+    auto num_connected = 0;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      for (auto idx = 0; idx < 2; ++idx) {
+        auto client = foxy::client_session(io, opts);
+        auto peer   = tcp::socket(io);
+
+        auto endpoint = client.async_connect("127.0.0.1", port, yield);
+        acceptor.accept(peer);
+
+        if (endpoint == acceptor.local_endpoint()) { ++num_connected; }
+      }
+    });
+
+    io.run();
+
+    CHECK(num_connected == 2);
+    CHECK(opts.dns_cache->stats().misses == 1);
+    CHECK(opts.dns_cache->stats().hits == 1);
+  }
+}
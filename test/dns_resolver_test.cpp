@@ -0,0 +1,322 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/dns_resolver.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/address_v6.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+using boost::asio::ip::udp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+to_bytes(ip::address const& address) -> std::vector<std::uint8_t>
+{
+  if (address.is_v4()) {
+    auto const bytes = address.to_v4().to_bytes();
+    return {bytes.begin(), bytes.end()};
+  }
+
+  auto const bytes = address.to_v6().to_bytes();
+  return {bytes.begin(), bytes.end()};
+}
+
+// stand_in_server answers A and AAAA queries on loopback from a fixed table of names, anything else
+// gets NXDOMAIN
+//
+struct stand_in_server
+{
+  udp::socket socket;
+
+  std::map<std::string, std::vector<ip::address>> records;
+
+  int num_queries = 0;
+  int num_dropped = 0;
+
+  explicit stand_in_server(asio::io_context& io)
+    : socket(io, udp::endpoint(ip::make_address_v4("127.0.0.1"), 0))
+  {
+  }
+
+  auto
+  endpoint() const -> udp::endpoint
+  {
+    return socket.local_endpoint();
+  }
+
+  auto
+  run(asio::yield_context yield) -> void
+  {
+    auto query = std::vector<std::uint8_t>(512);
+    auto peer  = udp::endpoint();
+
+    while (true) {
+      auto ec   = boost::system::error_code();
+      auto size = socket.async_receive_from(asio::buffer(query), peer, yield[ec]);
+      if (ec) { break; }
+
+      ++num_queries;
+      if (num_dropped > 0) {
+        --num_dropped;
+        continue;
+      }
+
+      auto reply = answer(std::vector<std::uint8_t>(query.begin(), query.begin() + size));
+      socket.async_send_to(asio::buffer(reply), peer, yield[ec]);
+    }
+  }
+
+  auto
+  answer(std::vector<std::uint8_t> query) -> std::vector<std::uint8_t>
+  {
+    auto name = std::string();
+    auto pos  = std::size_t{12};
+    while (query[pos] != 0) {
+      if (!name.empty()) { name += '.'; }
+      name.append(query.begin() + pos + 1, query.begin() + pos + 1 + query[pos]);
+      pos += 1 + query[pos];
+    }
+
+    auto const type = query[pos + 2];
+
+    auto reply = query;
+    reply[2]   = 0x81;
+    reply[3]   = 0x80;
+
+    auto match = records.find(name);
+    if (match == records.end()) {
+      reply[3] |= 3;
+      return reply;
+    }
+
+    auto num_answers = std::uint8_t{0};
+    for (auto const& address : match->second) {
+      if ((type == 1) != address.is_v4()) { continue; }
+
+      auto const bytes = to_bytes(address);
+
+      // a compressed name pointing back at the question, followed by the type, class, TTL and data
+      //
+      auto const record = std::vector<std::uint8_t>{
+        0xc0, 0x0c, 0, type, 0, 1, 0, 0, 0, 60, 0, static_cast<std::uint8_t>(bytes.size())};
+
+      reply.insert(reply.end(), record.begin(), record.end());
+      reply.insert(reply.end(), bytes.begin(), bytes.end());
+      ++num_answers;
+    }
+
+    reply[7] = num_answers;
+    return reply;
+  }
+};
+
+auto
+write_file(std::string const& path, std::string const& contents) -> void
+{
+  auto file = std::ofstream(path);
+  file << contents;
+}
+
+} // namespace
+
+TEST_CASE("Our DNS resolver")
+{
+  SECTION("should query for IPv4 and IPv6 addresses in parallel")
+  {
+    asio::io_context io;
+
+    auto server = stand_in_server(io);
+    server.records["upstream.foxy"] = {ip::make_address("127.0.0.1"), ip::make_address("::1")};
+
+    auto opts        = foxy::dns_resolver_opts();
+    opts.nameservers = {server.endpoint()};
+    opts.hosts       = "";
+
+    auto resolver = foxy::dns_resolver(opts);
+
+    asio::spawn(io, [&](asio::yield_context yield) { server.run(yield); });
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto results = resolver.async_resolve(io, "Upstream.Foxy.", "8080", yield);
+
+      auto endpoints = std::vector<tcp::endpoint>(results.begin(), results.end());
+      CHECK(endpoints == std::vector<tcp::endpoint>{{ip::make_address("127.0.0.1"), 8080},
+                                                    {ip::make_address("::1"), 8080}});
+
+      auto ec = boost::system::error_code();
+      resolver.async_resolve(io, "missing.foxy", "80", yield[ec]);
+      CHECK(ec == asio::error::host_not_found);
+
+      server.socket.close(ec);
+    });
+
+    io.run();
+
+    CHECK(server.num_queries == 4);
+  }
+
+  SECTION("should retry queries that time out")
+  {
+    asio::io_context io;
+
+    auto server = stand_in_server(io);
+    server.records["upstream.foxy"] = {ip::make_address("127.0.0.1")};
+    server.num_dropped              = 2;
+
+    auto opts        = foxy::dns_resolver_opts();
+    opts.nameservers = {server.endpoint()};
+    opts.hosts       = "";
+    opts.timeout     = 50ms;
+    opts.attempts    = 2;
+
+    auto resolver = foxy::dns_resolver(opts);
+
+    asio::spawn(io, [&](asio::yield_context yield) { server.run(yield); });
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto results = resolver.async_resolve(io, "upstream.foxy", "80", yield);
+      REQUIRE(results.size() == 1);
+      CHECK(results.begin()->endpoint().address() == ip::make_address("127.0.0.1"));
+
+      // once every attempt has gone unanswered the lookup gives up
+      //
+      server.num_dropped = 4;
+
+      auto ec = boost::system::error_code();
+      resolver.async_resolve(io, "upstream.foxy", "80", yield[ec]);
+      CHECK(ec == asio::error::timed_out);
+
+      server.socket.close(ec);
+    });
+
+    io.run();
+
+    CHECK(server.num_queries == 8);
+  }
+
+  SECTION("should answer from the hosts file and for numeric hosts without sending queries")
+  {
+    asio::io_context io;
+
+    auto const hosts = std::string("foxy_dns_resolver_test_hosts");
+    write_file(hosts, "# comment\n"
+                      "10.1.2.3   hosted.foxy alias.foxy # trailing comment\n"
+                      "fe80::1    hosted.foxy\n");
+
+    auto server = stand_in_server(io);
+
+    auto opts        = foxy::dns_resolver_opts();
+    opts.nameservers = {server.endpoint()};
+    opts.hosts       = hosts;
+
+    auto resolver = foxy::dns_resolver(opts);
+    std::remove(hosts.c_str());
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto results = resolver.async_resolve(io, "ALIAS.foxy", "https", yield);
+      REQUIRE(results.size() == 1);
+      CHECK(results.begin()->endpoint() == tcp::endpoint(ip::make_address("10.1.2.3"), 443));
+
+      results = resolver.async_resolve(io, "hosted.foxy", "80", yield);
+      CHECK(results.size() == 2);
+
+      results = resolver.async_resolve(io, "::1", "80", yield);
+      REQUIRE(results.size() == 1);
+      CHECK(results.begin()->endpoint() == tcp::endpoint(ip::make_address("::1"), 80));
+
+      auto ec = boost::system::error_code();
+      resolver.async_resolve(io, "hosted.foxy", "not-a-port", yield[ec]);
+      CHECK(ec == asio::error::service_not_found);
+    });
+
+    io.run();
+
+    CHECK(server.num_queries == 0);
+  }
+
+  SECTION("should read its nameservers and options from resolv.conf")
+  {
+    auto const resolv_conf = std::string("foxy_dns_resolver_test_resolv.conf");
+    write_file(resolv_conf, "# generated\n"
+                            "search example.com\n"
+                            "nameserver 10.0.0.1\n"
+                            "nameserver ::1\n"
+                            "options ndots:1 timeout:3 attempts:4\n");
+
+    auto opts        = foxy::dns_resolver_opts();
+    opts.resolv_conf = resolv_conf;
+    opts.hosts       = "";
+
+    auto resolver = foxy::dns_resolver(opts);
+    std::remove(resolv_conf.c_str());
+
+    CHECK(resolver.opts().nameservers ==
+          std::vector<udp::endpoint>{{ip::make_address("10.0.0.1"), 53},
+                                     {ip::make_address("::1"), 53}});
+    CHECK(resolver.opts().timeout == 3s);
+    CHECK(resolver.opts().attempts == 4);
+  }
+
+  SECTION("should be usable by client sessions")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+    auto port     = std::to_string(acceptor.local_endpoint().port());
+
+    auto server = stand_in_server(io);
+    server.records["upstream.foxy"] = {ip::make_address("127.0.0.1")};
+
+    auto resolver_opts        = foxy::dns_resolver_opts();
+    resolver_opts.nameservers = {server.endpoint()};
+    resolver_opts.hosts       = "";
+
+    auto opts         = foxy::session_opts();
+    opts.dns_resolver = std::make_shared<foxy::dns_resolver>(resolver_opts);
+
+    auto is_connected = false;
+
+    asio::spawn(io, [&](asio::yield_context yield) { server.run(yield); });
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client = foxy::client_session(io, opts);
+      auto peer   = tcp::socket(io);
+
+      auto endpoint = client.async_connect("upstream.foxy", port, yield);
+      acceptor.accept(peer);
+
+      is_connected = (endpoint == acceptor.local_endpoint());
+
+      auto ec = boost::system::error_code();
+      server.socket.close(ec);
+    });
+
+    io.run();
+
+    CHECK(is_connected);
+  }
+}
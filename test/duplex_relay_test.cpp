@@ -0,0 +1,358 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/session.hpp>
+#include <foxy/detail/duplex_relay.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/ostream.hpp>
+#include <boost/beast/experimental/test/stream.hpp>
+
+#include <random>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+namespace net   = boost::asio;
+namespace beast = boost::beast;
+namespace http  = boost::beast::http;
+
+using test_stream = beast::test::stream;
+
+namespace
+{
+auto
+random_body(std::size_t const size, unsigned const seed) -> std::string
+{
+  auto rng    = std::mt19937(seed);
+  auto letter = std::uniform_int_distribution<int>('a', 'z');
+
+  auto body = std::string(size, '\0');
+  for (auto& c : body) { c = static_cast<char>(letter(rng)); }
+  return body;
+}
+
+// parse reads back a message the relay wrote out
+//
+template <bool isRequest>
+auto
+parse(beast::string_view const wire) -> http::message<isRequest, http::string_body>
+{
+  auto parser = http::parser<isRequest, http::string_body>();
+  parser.eager(true);
+
+  auto ec     = boost::system::error_code();
+  auto buffer = net::buffer(wire.data(), wire.size());
+  while (!parser.is_done() && buffer.size() > 0) {
+    auto const n = parser.put(buffer, ec);
+    if (ec) { break; }
+    buffer += n;
+  }
+
+  REQUIRE(!ec);
+  REQUIRE(parser.is_done());
+  return parser.release();
+}
+
+// relay_bodies pushes a body many times the size of the relay's buffers through in both directions,
+// with reads and writes that stop short of a buffer so the reads keep overlapping with the writes
+//
+auto
+relay_bodies(bool const is_chunked) -> void
+{
+  net::io_context io;
+
+  auto opts = foxy::session_opts();
+
+  opts.relay.buffer_size     = 1024;
+  opts.relay.max_buffer_size = 1024;
+
+  auto req_stream = test_stream(io);
+  auto res_stream = test_stream(io);
+
+  auto server = foxy::basic_session<test_stream>(test_stream(io), opts);
+  auto client = foxy::basic_session<test_stream>(test_stream(io), opts);
+
+  auto const req_body = random_body(64 * 1024 + 123, 1);
+  auto const res_body = random_body(96 * 1024 + 45, 2);
+
+  auto request   = http::request<http::string_body>(http::verb::post, "/upload", 11);
+  request.body() = req_body;
+
+  auto response   = http::response<http::string_body>(http::status::ok, 11);
+  response.body() = res_body;
+
+  if (is_chunked) {
+    request.chunked(true);
+    response.chunked(true);
+  } else {
+    request.prepare_payload();
+    response.prepare_payload();
+  }
+
+  beast::ostream(server.stream.plain().buffer()) << request;
+  beast::ostream(client.stream.plain().buffer()) << response;
+
+  server.stream.plain().read_size(700);
+  client.stream.plain().read_size(700);
+  server.stream.plain().write_size(300);
+  client.stream.plain().write_size(300);
+
+  server.stream.plain().connect(res_stream);
+  client.stream.plain().connect(req_stream);
+
+  auto ec           = boost::system::error_code();
+  auto close_tunnel = true;
+
+  net::spawn([&](net::yield_context yield) mutable {
+    close_tunnel = foxy::detail::async_duplex_relay(server, client, yield[ec]);
+  });
+
+  io.run();
+
+  REQUIRE(!ec);
+  CHECK(!close_tunnel);
+
+  auto const relayed_req = parse<true>(req_stream.str());
+  auto const relayed_res = parse<false>(res_stream.str());
+
+  CHECK(relayed_req.chunked() == is_chunked);
+  CHECK(relayed_res.chunked() == is_chunked);
+
+  CHECK(relayed_req.body().size() == req_body.size());
+  CHECK(relayed_req.body() == req_body);
+  CHECK(relayed_res.body().size() == res_body.size());
+  CHECK(relayed_res.body() == res_body);
+}
+
+} // namespace
+
+TEST_CASE("Our full-duplex HTTP relay")
+{
+  SECTION("should relay a complete request/response exchange")
+  {
+    net::io_context io;
+
+    auto req_stream = test_stream(io);
+    auto res_stream = test_stream(io);
+
+    auto server = foxy::basic_session<test_stream>(test_stream(io));
+    auto client = foxy::basic_session<test_stream>(test_stream(io));
+
+    auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+
+    auto response = http::response<http::string_body>(
+      http::status::ok, 11, "I bestow the heads of virgins and the first-born sons!!!!\n");
+
+    response.prepare_payload();
+
+    beast::ostream(server.stream.plain().buffer()) << request;
+    beast::ostream(client.stream.plain().buffer()) << response;
+
+    server.stream.plain().connect(res_stream);
+    client.stream.plain().connect(req_stream);
+
+    auto close_tunnel = true;
+
+    net::spawn([&](net::yield_context yield) mutable {
+      close_tunnel = foxy::detail::async_duplex_relay(server, client, yield);
+    });
+
+    io.run();
+
+    CHECK(!close_tunnel);
+    CHECK(req_stream.str() == "GET / HTTP/1.1\r\nVia: 1.1 foxy\r\n\r\n");
+    CHECK(res_stream.str() ==
+          "HTTP/1.1 200 OK\r\n"
+          "Content-Length: 58\r\n"
+          "Via: 1.1 foxy\r\n"
+          "\r\n"
+          "I bestow the heads of virgins and the first-born sons!!!!\n");
+  }
+
+  SECTION("should forward an early response without waiting on the upload to finish")
+  {
+    net::io_context io;
+
+    auto req_stream = test_stream(io);
+    auto res_stream = test_stream(io);
+
+    auto server = foxy::basic_session<test_stream>(test_stream(io));
+    auto client = foxy::basic_session<test_stream>(test_stream(io));
+
+    // the client promises a body that never arrives, a half-duplex relay would sit on the read
+    // until it timed out
+    //
+    beast::ostream(server.stream.plain().buffer()) << "POST / HTTP/1.1\r\n"
+                                                      "Content-Length: 4096\r\n"
+                                                      "\r\n"
+                                                      "only a little bit";
+
+    auto response = http::response<http::empty_body>(http::status::payload_too_large, 11);
+    response.keep_alive(false);
+    response.prepare_payload();
+
+    beast::ostream(client.stream.plain().buffer()) << response;
+
+    server.stream.plain().connect(res_stream);
+    client.stream.plain().connect(req_stream);
+
+    auto ec           = boost::system::error_code();
+    auto close_tunnel = false;
+
+    net::spawn([&](net::yield_context yield) mutable {
+      close_tunnel = foxy::detail::async_duplex_relay(server, client, yield[ec]);
+    });
+
+    io.run();
+
+    CHECK(!ec);
+    CHECK(close_tunnel);
+    CHECK(res_stream.str() ==
+          "HTTP/1.1 413 Payload Too Large\r\n"
+          "Content-Length: 0\r\n"
+          "Connection: close\r\n"
+          "Via: 1.1 foxy\r\n"
+          "\r\n");
+  }
+
+  SECTION("should relay large chunked bodies intact and in order")
+  {
+    relay_bodies(true);
+  }
+
+  SECTION("should relay large bodies with a Content-Length intact and in order")
+  {
+    relay_bodies(false);
+  }
+
+  SECTION("should relay interim responses and carry on with the final one")
+  {
+    net::io_context io;
+
+    auto req_stream = test_stream(io);
+    auto res_stream = test_stream(io);
+
+    auto server = foxy::basic_session<test_stream>(test_stream(io));
+    auto client = foxy::basic_session<test_stream>(test_stream(io));
+
+    beast::ostream(server.stream.plain().buffer()) << "POST / HTTP/1.1\r\n"
+                                                      "Expect: 100-continue\r\n"
+                                                      "Content-Length: 5\r\n"
+                                                      "\r\n"
+                                                      "hello";
+
+    beast::ostream(client.stream.plain().buffer()) << "HTTP/1.1 100 Continue\r\n"
+                                                      "\r\n"
+                                                      "HTTP/1.1 103 Early Hints\r\n"
+                                                      "Link: </style.css>; rel=preload\r\n"
+                                                      "\r\n"
+                                                      "HTTP/1.1 200 OK\r\n"
+                                                      "Content-Length: 5\r\n"
+                                                      "\r\n"
+                                                      "world";
+
+    server.stream.plain().connect(res_stream);
+    client.stream.plain().connect(req_stream);
+
+    auto ec           = boost::system::error_code();
+    auto close_tunnel = true;
+
+    net::spawn([&](net::yield_context yield) mutable {
+      close_tunnel = foxy::detail::async_duplex_relay(server, client, yield[ec]);
+    });
+
+    io.run();
+
+    CHECK(!ec);
+    CHECK(!close_tunnel);
+    CHECK(res_stream.str() ==
+          "HTTP/1.1 100 Continue\r\n"
+          "Via: 1.1 foxy\r\n"
+          "\r\n"
+          "HTTP/1.1 103 Early Hints\r\n"
+          "Link: </style.css>; rel=preload\r\n"
+          "Via: 1.1 foxy\r\n"
+          "\r\n"
+          "HTTP/1.1 200 OK\r\n"
+          "Content-Length: 5\r\n"
+          "Via: 1.1 foxy\r\n"
+          "\r\n"
+          "world");
+  }
+
+  SECTION("should fail the exchange when the remote switches protocols")
+  {
+    net::io_context io;
+
+    auto req_stream = test_stream(io);
+    auto res_stream = test_stream(io);
+
+    auto server = foxy::basic_session<test_stream>(test_stream(io));
+    auto client = foxy::basic_session<test_stream>(test_stream(io));
+
+    auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+
+    beast::ostream(server.stream.plain().buffer()) << request;
+    beast::ostream(client.stream.plain().buffer()) << "HTTP/1.1 101 Switching Protocols\r\n"
+                                                      "Upgrade: websocket\r\n"
+                                                      "Connection: upgrade\r\n"
+                                                      "\r\n";
+
+    server.stream.plain().connect(res_stream);
+    client.stream.plain().connect(req_stream);
+
+    auto ec = boost::system::error_code();
+
+    net::spawn([&](net::yield_context yield) mutable {
+      foxy::detail::async_duplex_relay(server, client, yield[ec]);
+    });
+
+    io.run();
+
+    CHECK(ec == http::error::bad_status);
+    CHECK(res_stream.str() == "");
+  }
+
+  SECTION("should signal to close the tunnel for a potential request loop attack")
+  {
+    net::io_context io;
+
+    auto req_stream = test_stream(io);
+    auto res_stream = test_stream(io);
+
+    auto server = foxy::basic_session<test_stream>(test_stream(io));
+    auto client = foxy::basic_session<test_stream>(test_stream(io));
+
+    auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+    request.insert(http::field::via, "1.1 foxy");
+
+    beast::ostream(server.stream.plain().buffer()) << request;
+
+    server.stream.plain().connect(res_stream);
+    client.stream.plain().connect(req_stream);
+
+    auto ec           = boost::system::error_code();
+    auto close_tunnel = false;
+
+    net::spawn([&](net::yield_context yield) mutable {
+      close_tunnel = foxy::detail::async_duplex_relay(server, client, yield[ec]);
+    });
+
+    io.run();
+
+    CHECK(!ec);
+    CHECK(close_tunnel);
+    CHECK(req_stream.str() == "");
+    CHECK(res_stream.str() == "");
+  }
+}
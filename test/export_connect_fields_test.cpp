@@ -16,6 +16,8 @@
 #include <boost/range/algorithm/for_each.hpp>
 
 #include <algorithm>
+#include <iterator>
+#include <string>
 
 #include <catch2/catch.hpp>
 
@@ -74,4 +76,47 @@ TEST_CASE("Our detail::export_connect_fields function")
     ++transfer_encoding_iter;
     CHECK(transfer_encoding_iter->value() == "chunked");
   }
+
+  SECTION("should match Connection options regardless of case")
+  {
+    auto a = http::fields();
+    auto b = http::fields();
+
+    a.insert(http::field::connection, "Keep-Alive, X-Trace");
+    a.insert(http::field::keep_alive, "timeout=5");
+    a.insert(http::field::content_type, "text/plain");
+    a.insert("x-trace", "a1b2c3d4");
+
+    foxy::detail::export_connect_fields(a, b);
+
+    CHECK(a["x-trace"] == "");
+    CHECK(b["X-Trace"] == "a1b2c3d4");
+    CHECK(b[http::field::keep_alive] == "timeout=5");
+    CHECK(a[http::field::content_type] == "text/plain");
+    CHECK(std::distance(a.begin(), a.end()) == 1);
+  }
+
+  SECTION("should handle more Connection options than it keeps on hand")
+  {
+    auto a = http::fields();
+    auto b = http::fields();
+
+    auto opts = std::string();
+    for (int idx = 0; idx < 40; ++idx) {
+      opts += (idx > 0 ? ", x-opt-" : "x-opt-") + std::to_string(idx);
+      a.insert("x-opt-" + std::to_string(idx), "hop");
+      a.insert("x-keep-" + std::to_string(idx), "end-to-end");
+    }
+    a.insert(http::field::connection, opts);
+
+    foxy::detail::export_connect_fields(a, b);
+
+    CHECK(std::distance(a.begin(), a.end()) == 40);
+    CHECK(std::distance(b.begin(), b.end()) == 41);
+
+    CHECK(a["x-opt-39"] == "");
+    CHECK(b["x-opt-39"] == "hop");
+    CHECK(a["x-keep-39"] == "end-to-end");
+    CHECK(b[http::field::connection] == opts);
+  }
 }
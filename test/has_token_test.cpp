@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/has_token.hpp>
+
+#include <boost/beast/http/fields.hpp>
+
+#include <string>
+
+#include <catch2/catch.hpp>
+
+namespace http = boost::beast::http;
+
+TEST_CASE("Our detail::icontains function")
+{
+  SECTION("should find a needle no matter the case of its letters")
+  {
+    CHECK(foxy::detail::icontains("1.1 FOXY", "1.1 foxy"));
+    CHECK(foxy::detail::icontains("1.0 fred, 1.1 Foxy", "1.1 fOXY"));
+    CHECK(foxy::detail::icontains("abc", ""));
+    CHECK(foxy::detail::icontains("", ""));
+
+    CHECK_FALSE(foxy::detail::icontains("1.1 fox", "1.1 foxy"));
+    CHECK_FALSE(foxy::detail::icontains("", "x"));
+    CHECK_FALSE(foxy::detail::icontains("1.1 foxy", "1.2 foxy"));
+  }
+
+  SECTION("should only fold the case of ASCII letters")
+  {
+    // '@' and '`' sit right below 'A' and 'a', '[' and '{' right above 'Z' and 'z'
+    //
+    CHECK_FALSE(foxy::detail::icontains("@[", "`{"));
+    CHECK_FALSE(foxy::detail::icontains("x\xc0y", "x\xe0y"));
+    CHECK(foxy::detail::icontains("x\xc0y", "X\xc0Y"));
+  }
+
+  SECTION("should find a needle at every offset of a long value")
+  {
+    auto const needle = std::string("1.1 Foxy");
+
+    // the lengths cover values shorter than a block, exactly a block and every way a needle can
+    // straddle the end of one
+    //
+    for (std::size_t size = needle.size(); size < 100; ++size) {
+      for (std::size_t pos = 0; pos + needle.size() <= size; ++pos) {
+        auto value = std::string(size, 'f');
+        value.replace(pos, needle.size(), needle);
+
+        CHECK(foxy::detail::icontains(value, "1.1 fOXY"));
+
+        value[pos + needle.size() - 1] = 'z';
+        CHECK_FALSE(foxy::detail::icontains(value, "1.1 fOXY"));
+      }
+    }
+  }
+
+  SECTION("should handle single character needles")
+  {
+    auto value = std::string(70, '-');
+    CHECK_FALSE(foxy::detail::icontains(value, "q"));
+
+    value.back() = 'Q';
+    CHECK(foxy::detail::icontains(value, "q"));
+  }
+}
+
+TEST_CASE("Our detail::has_foxy_via function")
+{
+  SECTION("should look for the configured Via entry across every Via field")
+  {
+    auto fields = http::fields();
+    fields.insert(http::field::via, "1.0 fred, 1.1 p.example.net");
+    fields.insert(http::field::via, "1.1 varnish (Varnish/6.0), 1.1 Edge-7");
+
+    CHECK(foxy::detail::has_foxy_via(fields, "1.1 edge-7"));
+    CHECK_FALSE(foxy::detail::has_foxy_via(fields, "1.1 foxy"));
+  }
+}
+
+TEST_CASE("Our detail::via_entry function")
+{
+  SECTION("should fall back to the default for an empty entry")
+  {
+    CHECK(foxy::detail::via_entry("") == "1.1 foxy");
+    CHECK(foxy::detail::via_entry("1.1 edge-7") == "1.1 edge-7");
+  }
+}
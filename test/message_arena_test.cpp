@@ -0,0 +1,123 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/message_arena.hpp>
+#include <foxy/detail/export_connect_fields.hpp>
+
+#include <boost/beast/http/fields.hpp>
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+namespace http = boost::beast::http;
+
+using fields = http::basic_fields<foxy::arena_allocator<char>>;
+
+TEST_CASE("Our message arena")
+{
+  SECTION("should not allocate anything until it's first used")
+  {
+    foxy::message_arena arena;
+    CHECK(arena.capacity() == 0);
+
+    arena.reset();
+    CHECK(arena.capacity() == 0);
+
+    arena.allocate(1, 1);
+    CHECK(arena.capacity() == foxy::message_arena::default_capacity);
+  }
+
+  SECTION("should hand out memory with the requested alignment")
+  {
+    foxy::message_arena arena(256);
+
+    auto* const a = static_cast<unsigned char*>(arena.allocate(3, 1));
+    auto* const b = arena.allocate(sizeof(double), alignof(double));
+    auto* const c = arena.allocate(16, 16);
+
+    CHECK(reinterpret_cast<std::uintptr_t>(b) % alignof(double) == 0);
+    CHECK(reinterpret_cast<std::uintptr_t>(c) % 16 == 0);
+
+    CHECK(static_cast<unsigned char*>(b) >= a + 3);
+    CHECK(static_cast<unsigned char*>(c) >= static_cast<unsigned char*>(b) + sizeof(double));
+  }
+
+  SECTION("should only take back the most recent allocation")
+  {
+    foxy::message_arena arena(256);
+
+    auto* const a = arena.allocate(32, 1);
+    auto* const b = arena.allocate(32, 1);
+
+    arena.deallocate(a, 32);
+    CHECK(arena.allocate(32, 1) != a);
+
+    auto* const c = arena.allocate(32, 1);
+    arena.deallocate(c, 32);
+    CHECK(arena.allocate(32, 1) == c);
+
+    CHECK(b != c);
+  }
+
+  SECTION("should fold its chunks into one when it's reset")
+  {
+    foxy::message_arena arena(256);
+
+    for (int idx = 0; idx < 10; ++idx) { arena.allocate(100, 8); }
+
+    auto const capacity = arena.capacity();
+    CHECK(capacity > 256);
+
+    arena.reset();
+    CHECK(arena.capacity() == capacity);
+
+    // the whole lot now fits in the one chunk so there's no need to grow
+    //
+    for (int idx = 0; idx < 10; ++idx) { arena.allocate(100, 8); }
+    CHECK(arena.capacity() == capacity);
+  }
+
+  SECTION("should back a message's fields from one exchange to the next")
+  {
+    foxy::message_arena arena(512);
+
+    auto const exchange = [&arena] {
+      auto src = fields(foxy::arena_allocator<char>(arena));
+      auto dst = fields(foxy::arena_allocator<char>(arena));
+
+      src.insert(http::field::connection, "keep-alive, x-trace");
+      src.insert(http::field::keep_alive, "timeout=5");
+      src.insert("x-trace", "a1b2c3d4");
+
+      for (int idx = 0; idx < 32; ++idx) {
+        src.insert("X-Header-" + std::to_string(idx), std::string(24, 'x'));
+      }
+
+      foxy::detail::export_connect_fields(src, dst);
+
+      CHECK(std::distance(dst.begin(), dst.end()) == 3);
+      CHECK(std::distance(src.begin(), src.end()) == 32);
+    };
+
+    exchange();
+    arena.reset();
+
+    auto const capacity = arena.capacity();
+
+    for (int idx = 0; idx < 8; ++idx) {
+      exchange();
+      arena.reset();
+
+      CHECK(arena.capacity() == capacity);
+    }
+  }
+}
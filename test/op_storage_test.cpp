@@ -0,0 +1,255 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/op_storage.hpp>
+#include <foxy/session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+std::atomic<std::size_t> num_allocations{0};
+
+// body_relay pumps a request body from `server` to `client` in small chunks the way the proxy's
+// relays do, counting the allocations made once the first few chunks are through
+//
+// Plain callbacks are used throughout, coroutines would add allocations of their own.
+//
+struct body_relay
+{
+  foxy::session& server;
+  foxy::session& client;
+  tcp::socket&   upstream;
+
+  http::request_parser<http::buffer_body>     parser;
+  http::request<http::buffer_body>            req;
+  http::request_serializer<http::buffer_body> serializer;
+
+  std::array<char, 512>  chunk;
+  std::array<char, 4096> drain_buffer;
+
+  std::size_t num_chunks   = 0;
+  std::size_t num_drained  = 0;
+  std::size_t start        = 0;
+  std::size_t steady_state = 0;
+
+  boost::system::error_code ec;
+
+  body_relay(foxy::session& server_, foxy::session& client_, tcp::socket& upstream_)
+    : server(server_)
+    , client(client_)
+    , upstream(upstream_)
+    , req(http::verb::post, "/", 11)
+    , serializer(req)
+  {
+  }
+
+  auto
+  run() -> void
+  {
+    drain();
+    server.async_read_header(parser, [this](boost::system::error_code ec_, std::size_t) {
+      if ((ec = ec_)) { return finish(); }
+
+      req.content_length(parser.content_length());
+      req.body().data = nullptr;
+      req.body().more = true;
+
+      client.async_write_header(serializer, [this](boost::system::error_code ec_, std::size_t) {
+        if ((ec = ec_)) { return finish(); }
+        read();
+      });
+    });
+  }
+
+  auto
+  read() -> void
+  {
+    parser.get().body().data = chunk.data();
+    parser.get().body().size = chunk.size();
+
+    server.async_read(parser, [this](boost::system::error_code ec_, std::size_t) {
+      if (ec_ == http::error::need_buffer) { ec_ = {}; }
+      if ((ec = ec_)) { return finish(); }
+
+      req.body().data = chunk.data();
+      req.body().size = chunk.size() - parser.get().body().size;
+      req.body().more = !parser.is_done();
+
+      client.async_write(serializer, [this](boost::system::error_code ec_, std::size_t) {
+        if (ec_ == http::error::need_buffer) { ec_ = {}; }
+        if ((ec = ec_)) { return finish(); }
+
+        // the first few chunks are allowed to fill up the sessions' storage and buffers
+        //
+        if (++num_chunks == 16) { start = num_allocations.load(); }
+        if (!parser.is_done()) { return read(); }
+
+        finish();
+      });
+    });
+  }
+
+  auto
+  drain() -> void
+  {
+    upstream.async_read_some(asio::buffer(drain_buffer),
+                             [this](boost::system::error_code ec_, std::size_t const n) {
+                               num_drained += n;
+                               if (!ec_) { drain(); }
+                             });
+  }
+
+  auto
+  finish() -> void
+  {
+    steady_state = num_allocations.load() - start;
+
+    auto ignored = boost::system::error_code();
+    client.stream.plain().shutdown(tcp::socket::shutdown_send, ignored);
+  }
+};
+
+} // namespace
+
+// these replace the allocation functions for the whole binary, which is why this file is built into
+// an executable of its own
+//
+auto
+operator new(std::size_t const size) -> void*
+{
+  ++num_allocations;
+  if (auto* p = std::malloc(size == 0 ? 1 : size)) { return p; }
+  throw std::bad_alloc();
+}
+
+auto
+operator delete(void* p) noexcept -> void
+{
+  std::free(p);
+}
+
+auto
+operator delete(void* p, std::size_t) noexcept -> void
+{
+  std::free(p);
+}
+
+TEST_CASE("Our op_storage")
+{
+  SECTION("should hand freed blocks out again")
+  {
+    auto storage = boost::intrusive_ptr<foxy::op_storage>(new foxy::op_storage());
+
+    auto alloc = foxy::op_allocator<char>(storage);
+
+    auto* const first = alloc.allocate(100);
+    alloc.deallocate(first, 100);
+
+    auto const before = num_allocations.load();
+
+    // a block that's big enough is reused, even when it's freed with a smaller size
+    //
+    auto* const second = alloc.allocate(64);
+    CHECK(second == first);
+    alloc.deallocate(second, 64);
+
+    auto* const third = foxy::op_allocator<int>(alloc).allocate(4);
+    CHECK(static_cast<void*>(third) == static_cast<void*>(first));
+    foxy::op_allocator<int>(alloc).deallocate(third, 4);
+
+    CHECK(num_allocations.load() == before);
+  }
+
+  SECTION("should send blocks too large to keep straight back to the heap")
+  {
+    auto storage = boost::intrusive_ptr<foxy::op_storage>(new foxy::op_storage());
+
+    auto alloc = foxy::op_allocator<char>(storage);
+
+    auto const largest   = foxy::op_storage::max_block_size;
+    auto const too_large = largest + 1;
+
+    alloc.deallocate(alloc.allocate(largest), largest);
+    alloc.deallocate(alloc.allocate(too_large), too_large);
+
+    auto const before = num_allocations.load();
+
+    // only the block that's small enough to keep gets handed out again
+    //
+    alloc.deallocate(alloc.allocate(largest), largest);
+    CHECK(num_allocations.load() == before);
+
+    alloc.deallocate(alloc.allocate(too_large), too_large);
+    CHECK(num_allocations.load() == before + 1);
+  }
+
+  SECTION("should let a session relay a body without allocating once it's warmed up")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto server = foxy::session(io);
+    auto client = foxy::session(io);
+
+    auto downstream = tcp::socket(io);
+    auto upstream   = tcp::socket(io);
+
+    downstream.connect(acceptor.local_endpoint());
+    acceptor.accept(server.stream.plain());
+
+    client.stream.plain().connect(acceptor.local_endpoint());
+    acceptor.accept(upstream);
+
+    server.opts.timeout = 5s;
+    client.opts.timeout = 5s;
+
+    auto const body    = std::string(256 * 1024, 'x');
+    auto const request = "POST / HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) +
+                         "\r\n\r\n" + body;
+
+    auto relay = body_relay(server, client, upstream);
+
+    asio::async_write(downstream, asio::buffer(request),
+                      [](boost::system::error_code, std::size_t) {});
+    relay.run();
+
+    io.run();
+
+    CHECK(!relay.ec);
+    CHECK(relay.parser.is_done());
+    CHECK(relay.serializer.is_done());
+    CHECK(relay.num_chunks > 64);
+    CHECK(relay.num_drained > body.size());
+    CHECK(relay.steady_state == 0);
+  }
+}
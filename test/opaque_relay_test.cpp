@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/session.hpp>
+#include <foxy/proxy.hpp>
+#include <foxy/detail/opaque_relay.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <memory>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+// read_until_eof drains the socket until the peer shuts down its sending side
+//
+auto
+read_until_eof(tcp::socket& socket, asio::yield_context yield) -> std::string
+{
+  auto ec  = boost::system::error_code();
+  auto str = std::string();
+
+  asio::async_read(socket, asio::dynamic_buffer(str), yield[ec]);
+  CHECK(ec == asio::error::eof);
+
+  return str;
+}
+
+// relay_both_ways pushes a megabyte in each direction through the relay, the upstream only
+// answering once it has seen the downstream's half-close
+//
+auto
+relay_both_ways(bool const zero_copy) -> void
+{
+  asio::io_context io;
+
+  auto const upload   = std::string(1024 * 1024, 'u');
+  auto const download = std::string(1024 * 1024, 'd');
+
+  auto server = foxy::basic_session<tcp::socket>(io);
+  auto client = foxy::basic_session<tcp::socket>(io);
+
+  server.opts.timeout = 5s;
+
+  auto downstream = tcp::socket(io);
+  auto upstream   = tcp::socket(io);
+
+  auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+  downstream.connect(acceptor.local_endpoint());
+  acceptor.accept(server.stream.plain());
+
+  client.stream.plain().connect(acceptor.local_endpoint());
+  acceptor.accept(upstream);
+
+  // whatever the proxy already read off the wire has to make it upstream first
+  //
+  auto const preamble = std::string("\x16\x03\x01\x02");
+  asio::buffer_copy(server.buffer.prepare(preamble.size()), asio::buffer(preamble));
+  server.buffer.commit(preamble.size());
+
+  auto ec          = boost::system::error_code();
+  auto was_relayed = false;
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    if (zero_copy) {
+      foxy::detail::async_opaque_relay(server, client, yield[ec]);
+    } else {
+      foxy::detail::async_copy_relay(server, client, yield[ec]);
+    }
+    was_relayed = true;
+  });
+
+  auto downstream_received = std::string();
+  auto upstream_received   = std::string();
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    asio::async_write(downstream, asio::buffer(upload), yield);
+    downstream.shutdown(tcp::socket::shutdown_send);
+
+    downstream_received = read_until_eof(downstream, yield);
+  });
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    upstream_received = read_until_eof(upstream, yield);
+
+    asio::async_write(upstream, asio::buffer(download), yield);
+    upstream.shutdown(tcp::socket::shutdown_send);
+  });
+
+  io.run();
+
+  CHECK(was_relayed);
+  CHECK(!ec);
+  CHECK(upstream_received == preamble + upload);
+  CHECK(downstream_received == download);
+}
+
+} // namespace
+
+TEST_CASE("Our opaque CONNECT relay")
+{
+  SECTION("should copy bytes in both directions and propagate half-closes")
+  {
+    relay_both_ways(true);
+  }
+
+  SECTION("should do the same when forced through user-space buffers")
+  {
+    relay_both_ways(false);
+  }
+
+  SECTION("should be used by the proxy for CONNECT tunnels carrying TLS")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+    auto proxy    = std::make_shared<foxy::proxy>(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true);
+
+    proxy->async_accept();
+
+    // something that looks enough like a TLS ClientHello for the detection to trip on it followed
+    // by a few bytes that are definitely not HTTP
+    //
+    auto const hello = std::string("\x16\x03\x01\x00\x05\x01\x00\x00\x01\x00", 10);
+
+    auto echoed = std::string();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto upstream = tcp::socket(io);
+      acceptor.async_accept(upstream, yield);
+
+      auto const received = read_until_eof(upstream, yield);
+
+      asio::async_write(upstream, asio::buffer(received), yield);
+      upstream.shutdown(tcp::socket::shutdown_send);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+      socket.async_connect(proxy->local_endpoint(), yield);
+
+      auto const authority = "127.0.0.1:" + std::to_string(acceptor.local_endpoint().port());
+
+      auto request = http::request<http::empty_body>(http::verb::connect, authority, 11);
+      http::async_write(socket, request, yield);
+
+      // a successful response to CONNECT has no body, the tunnel starts right after the header
+      //
+      auto buffer = boost::beast::flat_buffer();
+
+      http::response_parser<http::empty_body> parser;
+      parser.skip(true);
+
+      http::async_read(socket, buffer, parser, yield);
+      CHECK(parser.get().result() == http::status::ok);
+
+      asio::async_write(socket, asio::buffer(hello), yield);
+      socket.shutdown(tcp::socket::shutdown_send);
+
+      echoed = read_until_eof(socket, yield);
+
+      auto ec = boost::system::error_code();
+      proxy->cancel(ec);
+    });
+
+    io.run();
+
+    CHECK(echoed == hello);
+  }
+}
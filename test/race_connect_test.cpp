@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/race_connect.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address.hpp>
+
+#include <chrono>
+#include <list>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+auto
+loopback() -> tcp::endpoint
+{
+  return tcp::endpoint(ip::make_address("127.0.0.1"), 0);
+}
+
+// black_hole is a listener whose accept queue is full so the kernel silently drops every SYN sent
+// to it, connecting to it hangs the same way it would for an unreachable host
+//
+struct black_hole
+{
+  tcp::acceptor          acceptor;
+  std::list<tcp::socket> fillers;
+
+  explicit black_hole(asio::io_context& io)
+    : acceptor(io, loopback().protocol())
+  {
+    acceptor.bind(loopback());
+    acceptor.listen(0);
+
+    for (auto idx = 0; idx < 2; ++idx) {
+      fillers.emplace_back(io);
+      fillers.back().async_connect(acceptor.local_endpoint(), [](boost::system::error_code) {});
+    }
+  }
+
+  auto
+  close() -> void
+  {
+    auto ec = boost::system::error_code();
+    for (auto& filler : fillers) { filler.close(ec); }
+    acceptor.close(ec);
+  }
+};
+
+} // namespace
+
+TEST_CASE("Our racing connect")
+{
+  SECTION("should alternate between address families")
+  {
+    auto const v4a = tcp::endpoint(ip::make_address("10.0.0.1"), 80);
+    auto const v4b = tcp::endpoint(ip::make_address("10.0.0.2"), 80);
+    auto const v6a = tcp::endpoint(ip::make_address("fe80::1"), 80);
+    auto const v6b = tcp::endpoint(ip::make_address("fe80::2"), 80);
+
+    CHECK(foxy::detail::interleave_families(std::vector<tcp::endpoint>{v6a, v6b, v4a, v4b}) ==
+          std::vector<tcp::endpoint>{v6a, v4a, v6b, v4b});
+
+    CHECK(foxy::detail::interleave_families(std::vector<tcp::endpoint>{v4a, v6a, v4b}) ==
+          std::vector<tcp::endpoint>{v4a, v6a, v4b});
+  }
+
+  SECTION("should start the next attempt after the delay and keep the first one to connect")
+  {
+    asio::io_context io;
+
+    auto dead     = black_hole(io);
+    auto acceptor = tcp::acceptor(io, loopback());
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+      auto peer   = tcp::socket(io);
+      acceptor.async_accept(peer, [](boost::system::error_code) {});
+
+      auto const endpoints =
+        std::vector<tcp::endpoint>{dead.acceptor.local_endpoint(), acceptor.local_endpoint()};
+
+      auto const start    = std::chrono::steady_clock::now();
+      auto const deadline = start + 10s;
+
+      auto endpoint = foxy::detail::async_race_connect(socket, endpoints, 50ms, deadline, yield);
+
+      CHECK(endpoint == acceptor.local_endpoint());
+      CHECK(socket.remote_endpoint() == acceptor.local_endpoint());
+      CHECK(std::chrono::steady_clock::now() - start >= 50ms);
+      CHECK(std::chrono::steady_clock::now() - start < 5s);
+
+      dead.close();
+    });
+
+    io.run();
+  }
+
+  SECTION("should move on right away when an attempt fails")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, loopback());
+    auto refused  = [&] {
+      auto closed = tcp::acceptor(io, loopback());
+      return closed.local_endpoint();
+    }();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+      auto peer   = tcp::socket(io);
+      acceptor.async_accept(peer, [](boost::system::error_code) {});
+
+      auto const start = std::chrono::steady_clock::now();
+
+      auto endpoint = foxy::detail::async_race_connect(
+        socket, std::vector<tcp::endpoint>{refused, acceptor.local_endpoint()}, 10s,
+        std::chrono::steady_clock::now() + 20s, yield);
+
+      CHECK(endpoint == acceptor.local_endpoint());
+      CHECK(std::chrono::steady_clock::now() - start < 5s);
+
+      // when every attempt fails the last error is reported without waiting for the deadline
+      //
+      auto ec = boost::system::error_code();
+      foxy::detail::async_race_connect(socket, std::vector<tcp::endpoint>{refused, refused}, 10s,
+                                       std::chrono::steady_clock::now() + 20s, yield[ec]);
+
+      CHECK(ec == asio::error::connection_refused);
+      CHECK(std::chrono::steady_clock::now() - start < 5s);
+    });
+
+    io.run();
+  }
+
+  SECTION("should give up on every attempt once the deadline is reached")
+  {
+    asio::io_context io;
+
+    auto dead = black_hole(io);
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+
+      auto ec = boost::system::error_code();
+      foxy::detail::async_race_connect(
+        socket, std::vector<tcp::endpoint>{dead.acceptor.local_endpoint()}, 10ms,
+        std::chrono::steady_clock::now() + 100ms, yield[ec]);
+
+      CHECK(ec == asio::error::operation_aborted);
+      CHECK(!socket.is_open());
+
+      dead.close();
+    });
+
+    io.run();
+  }
+}
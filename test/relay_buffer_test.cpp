@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/relay_buffer.hpp>
+
+#include <memory>
+
+#include <catch2/catch.hpp>
+
+using relay_buffer      = foxy::detail::relay_buffer<std::allocator<char>>;
+using relay_buffer_ring = foxy::detail::relay_buffer_ring<std::allocator<char>>;
+
+TEST_CASE("Our relay buffer")
+{
+  SECTION("should not allocate anything until it's first prepared")
+  {
+    relay_buffer buffer(foxy::relay_opts{}, {});
+
+    CHECK(buffer.data() == nullptr);
+    CHECK(buffer.size() == 2048);
+
+    buffer.prepare();
+    CHECK(buffer.data() != nullptr);
+  }
+
+  SECTION("should double in size after full reads up until the ceiling")
+  {
+    auto opts            = foxy::relay_opts{};
+    opts.buffer_size     = 1024;
+    opts.max_buffer_size = 3000;
+
+    relay_buffer buffer(opts, {});
+
+    buffer.prepare();
+    buffer.commit(512);
+    CHECK(buffer.size() == 1024);
+
+    buffer.commit(1024);
+    CHECK(buffer.size() == 2048);
+
+    buffer.prepare();
+    buffer.commit(2048);
+    CHECK(buffer.size() == 3000);
+
+    buffer.prepare();
+    buffer.commit(3000);
+    CHECK(buffer.size() == 3000);
+  }
+
+  SECTION("should stay fixed when the ceiling matches the initial size")
+  {
+    auto opts            = foxy::relay_opts{};
+    opts.buffer_size     = 4096;
+    opts.max_buffer_size = 4096;
+
+    relay_buffer buffer(opts, {});
+
+    buffer.prepare();
+    buffer.commit(4096);
+    CHECK(buffer.size() == 4096);
+  }
+
+  SECTION("should hand filled slots from the reading side to the writing side in order")
+  {
+    relay_buffer_ring ring(foxy::relay_opts{}, {});
+
+    CHECK(ring.num_filled() == 0);
+    CHECK(ring.has_free_slot());
+    CHECK(&ring.read_slot() == &ring.write_slot());
+
+    auto* const first = &ring.read_slot();
+    ring.commit_read(10, true);
+
+    auto* const second = &ring.read_slot();
+    CHECK(second != first);
+    CHECK(&ring.write_slot() == first);
+    CHECK(ring.write_slot().size == 10);
+    CHECK(ring.write_slot().more);
+
+    ring.commit_read(20, false);
+    CHECK(ring.num_filled() == 2);
+    CHECK(!ring.has_free_slot());
+
+    ring.commit_write();
+    CHECK(&ring.write_slot() == second);
+    CHECK(ring.write_slot().size == 20);
+    CHECK(!ring.write_slot().more);
+    CHECK(&ring.read_slot() == first);
+
+    ring.commit_write();
+    CHECK(ring.num_filled() == 0);
+  }
+}
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/detail/rewrite_header.hpp>
+#include <foxy/detail/has_token.hpp>
+#include <foxy/detail/export_connect_fields.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace http = boost::beast::http;
+
+namespace
+{
+// rewrite_in_passes is how the relay used to rewrite a header, one pass over the fields at a time
+//
+template <bool isRequest>
+auto
+rewrite_in_passes(http::message<isRequest, http::empty_body>& msg,
+                  http::fields&                               hop_by_hops,
+                  bool                                        close) -> foxy::detail::header_rewrite
+{
+  auto const keep_alive = msg.keep_alive();
+  auto const is_chunked = msg.chunked();
+
+  if (foxy::detail::has_foxy_via(msg, "1.1 foxy")) { return {true, keep_alive}; }
+
+  close = close || !keep_alive;
+
+  foxy::detail::export_connect_fields(msg, hop_by_hops);
+
+  if (close) { msg.keep_alive(false); }
+  if (is_chunked) { msg.chunked(true); }
+
+  msg.insert(http::field::via, "1.1 foxy");
+
+  return {false, keep_alive};
+}
+
+auto
+to_pairs(http::fields const& fields) -> std::vector<std::pair<std::string, std::string>>
+{
+  auto pairs = std::vector<std::pair<std::string, std::string>>();
+  for (auto const& field : fields) {
+    pairs.emplace_back(static_cast<std::string>(field.name_string()),
+                       static_cast<std::string>(field.value()));
+  }
+  return pairs;
+}
+
+template <bool isRequest>
+auto
+check_same_as_passes(http::message<isRequest, http::empty_body> const& msg) -> void
+{
+  for (auto const close : {false, true}) {
+    auto expected      = msg;
+    auto expected_hops = http::fields();
+    auto actual        = msg;
+    auto actual_hops   = http::fields();
+
+    auto const expected_rewrite = rewrite_in_passes(expected, expected_hops, close);
+    auto const actual_rewrite =
+      foxy::detail::rewrite_header(actual, actual_hops, close, "1.1 foxy");
+
+    CHECK(actual_rewrite.is_loop == expected_rewrite.is_loop);
+    CHECK(actual_rewrite.keep_alive == expected_rewrite.keep_alive);
+
+    if (expected_rewrite.is_loop) { continue; }
+
+    CHECK(to_pairs(actual) == to_pairs(expected));
+    CHECK(to_pairs(actual_hops) == to_pairs(expected_hops));
+  }
+}
+
+auto
+browser_request() -> http::request<http::empty_body>
+{
+  auto req = http::request<http::empty_body>(http::verb::get, "/index.html", 11);
+  req.set(http::field::host, "www.example.com");
+  req.set(http::field::user_agent, "Mozilla/5.0 (X11; Linux x86_64; rv:66.0)");
+  req.set(http::field::accept, "text/html,application/xhtml+xml;q=0.9,*/*;q=0.8");
+  req.set(http::field::accept_encoding, "gzip, deflate");
+  req.set(http::field::proxy_connection, "keep-alive");
+  req.set(http::field::connection, "keep-alive");
+  req.set(http::field::cookie, "session=0123456789abcdef");
+  return req;
+}
+
+auto
+chunked_response() -> http::response<http::empty_body>
+{
+  auto res = http::response<http::empty_body>(http::status::ok, 11);
+  res.set(http::field::server, "nginx/1.14.0");
+  res.set(http::field::content_type, "text/html; charset=utf-8");
+  res.set(http::field::transfer_encoding, "gzip, chunked");
+  res.set(http::field::connection, "keep-alive");
+  res.set(http::field::keep_alive, "timeout=5, max=100");
+  res.set(http::field::vary, "Accept-Encoding");
+  return res;
+}
+
+} // namespace
+
+TEST_CASE("Our detail::rewrite_header function")
+{
+  SECTION("should rewrite a header the same way the separate passes did")
+  {
+    auto req = browser_request();
+    check_same_as_passes(req);
+
+    req.set(http::field::connection, "close");
+    check_same_as_passes(req);
+
+    req.set(http::field::connection, "keep-alive, Upgrade, X-Trace");
+    req.set(http::field::upgrade, "h2c");
+    req.set(http::field::te, "trailers");
+    req.insert("X-Trace", "a1b2c3d4");
+    req.insert(http::field::via, "1.1 squid");
+    check_same_as_passes(req);
+
+    req.version(10);
+    check_same_as_passes(req);
+
+    req.erase(http::field::connection);
+    check_same_as_passes(req);
+
+    auto res = chunked_response();
+    check_same_as_passes(res);
+
+    res.set(http::field::connection, "close");
+    check_same_as_passes(res);
+
+    res.set(http::field::transfer_encoding, "chunked, gzip");
+    check_same_as_passes(res);
+  }
+
+  SECTION("should drop a Content-Length that comes with a chunked message")
+  {
+    auto res = chunked_response();
+    res.erase(http::field::transfer_encoding);
+    res.insert(http::field::content_length, "128");
+    res.insert(http::field::transfer_encoding, "chunked");
+
+    auto hops = http::fields();
+
+    auto const rewrite = foxy::detail::rewrite_header(res, hops, false, "1.1 foxy");
+
+    CHECK_FALSE(rewrite.is_loop);
+    CHECK(rewrite.keep_alive);
+    CHECK(res.count(http::field::content_length) == 0);
+    CHECK(res[http::field::transfer_encoding] == "chunked");
+    CHECK(res.count(http::field::connection) == 0);
+    CHECK(res[http::field::via] == "1.1 foxy");
+    CHECK(hops[http::field::keep_alive] == "timeout=5, max=100");
+  }
+
+  SECTION("should detect that a message has already been through us")
+  {
+    auto req = browser_request();
+    req.insert(http::field::via, "1.0 fred, 1.1 FOXY");
+    check_same_as_passes(req);
+
+    auto hops = http::fields();
+
+    auto const rewrite = foxy::detail::rewrite_header(req, hops, false, "1.1 foxy");
+
+    CHECK(rewrite.is_loop);
+    CHECK(rewrite.keep_alive);
+  }
+}
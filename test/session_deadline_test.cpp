@@ -0,0 +1,204 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/session.hpp>
+#include <foxy/session_deadline.hpp>
+#include <foxy/detail/opaque_relay.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+using clock_type = std::chrono::steady_clock;
+
+namespace
+{
+// run_relay relays between a downstream that writes `chunk` every `interval` and an upstream that
+// never sends anything, it returns what the relay completed with and how long that took
+//
+auto
+run_relay(foxy::session_opts const   opts,
+          std::string const          chunk,
+          clock_type::duration const interval)
+  -> std::pair<boost::system::error_code, clock_type::duration>
+{
+  asio::io_context io;
+
+  auto server = foxy::session(io, opts);
+  auto client = foxy::session(io);
+
+  auto downstream = tcp::socket(io);
+  auto upstream   = tcp::socket(io);
+
+  auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+  downstream.connect(acceptor.local_endpoint());
+  acceptor.accept(server.stream.plain());
+
+  client.stream.plain().connect(acceptor.local_endpoint());
+  acceptor.accept(upstream);
+
+  auto       timer = asio::steady_timer(io);
+  auto       ec    = boost::system::error_code();
+  auto const start = clock_type::now();
+  auto       end   = start;
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    server.deadline.start();
+    foxy::detail::async_copy_relay(server, client, yield[ec]);
+    end = clock_type::now();
+
+    auto ignored = boost::system::error_code();
+    downstream.close(ignored);
+    upstream.close(ignored);
+    timer.cancel();
+  });
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    auto error = boost::system::error_code();
+    while (!error) {
+      asio::async_write(downstream, asio::buffer(chunk), yield[error]);
+
+      timer.expires_after(interval);
+      timer.async_wait(yield[error]);
+    }
+  });
+
+  io.run();
+
+  return {ec, end - start};
+}
+
+} // namespace
+
+TEST_CASE("Our session deadlines")
+{
+  SECTION("should expire the exchange according to its policies")
+  {
+    auto const start = clock_type::now();
+
+    auto deadline = foxy::session_deadline();
+    auto opts     = foxy::deadline_opts();
+
+    CHECK(deadline.expiry(opts) == clock_type::time_point::max());
+    CHECK(deadline.idle_expiry(0s) == clock_type::time_point::max());
+
+    opts.exchange = 10s;
+    CHECK(deadline.expiry(opts) >= start + 10s);
+    CHECK(deadline.expiry(opts) < clock_type::now() + 10s + 1ms);
+
+    // every byte moved buys the exchange another 1/min_rate seconds
+    //
+    opts.exchange       = 0s;
+    opts.min_rate       = 1000;
+    opts.min_rate_grace = 1s;
+
+    auto const before = deadline.expiry(opts);
+    deadline.progress(500);
+
+    CHECK(deadline.num_bytes() == 500);
+    CHECK(deadline.expiry(opts) - before == 500ms);
+    CHECK(deadline.idle_expiry(2s) == deadline.last_progress() + 2s);
+
+    deadline.start();
+    CHECK(deadline.num_bytes() == 0);
+  }
+
+  SECTION("should abort a relay that falls below the minimum rate")
+  {
+    // the downstream keeps dribbling bytes so the relay is never idle, it's just too slow
+    //
+    auto opts                     = foxy::session_opts();
+    opts.timeout                  = 5s;
+    opts.deadlines.min_rate       = 64 * 1024;
+    opts.deadlines.min_rate_grace = 200ms;
+
+    auto const result = run_relay(opts, "x", 20ms);
+
+    CHECK(result.first == asio::error::timed_out);
+    CHECK(result.second >= 200ms);
+    CHECK(result.second < 2s);
+  }
+
+  SECTION("should abort a relay that runs past the exchange deadline")
+  {
+    auto opts               = foxy::session_opts();
+    opts.timeout            = 5s;
+    opts.deadlines.exchange = 300ms;
+
+    auto const result = run_relay(opts, std::string(1024, 'x'), 10ms);
+
+    CHECK(result.first == asio::error::timed_out);
+    CHECK(result.second >= 300ms);
+    CHECK(result.second < 2s);
+  }
+
+  SECTION("should abort a relay that's idle for too long")
+  {
+    auto opts           = foxy::session_opts();
+    opts.timeout        = 5s;
+    opts.deadlines.idle = 200ms;
+
+    auto const result = run_relay(opts, "x", 10s);
+
+    CHECK(result.first == asio::error::timed_out);
+    CHECK(result.second >= 200ms);
+    CHECK(result.second < 2s);
+  }
+
+  SECTION("should cut a session's operation short at the exchange deadline")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+    auto peer     = tcp::socket(io);
+
+    auto opts               = foxy::session_opts();
+    opts.timeout            = 10s;
+    opts.deadlines.exchange = 200ms;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto session = foxy::session(io, opts);
+
+      peer.async_connect(acceptor.local_endpoint(), yield);
+      acceptor.async_accept(session.stream.plain(), yield);
+
+      session.deadline.start();
+      auto const start = clock_type::now();
+
+      auto ec     = boost::system::error_code();
+      auto parser = http::request_parser<http::empty_body>();
+      session.async_read_header(parser, yield[ec]);
+
+      CHECK(ec);
+      CHECK(clock_type::now() - start >= 200ms);
+      CHECK(clock_type::now() - start < 2s);
+    });
+
+    io.run();
+  }
+}
@@ -9,10 +9,13 @@
 //
 
 #include <foxy/session.hpp>
+#include <foxy/strand_stream.hpp>
 #include <foxy/type_traits.hpp>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
 
 #include <boost/beast/core/ostream.hpp>
 
@@ -20,13 +23,28 @@
 #include <boost/beast/experimental/test/stream.hpp>
 #include <boost/beast/experimental/test/fail_count.hpp>
 
+#include <atomic>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <catch2/catch.hpp>
 
 namespace asio = boost::asio;
 namespace http = boost::beast::http;
 
+using strand_session = foxy::basic_session<foxy::strand_stream>;
+
+static_assert(
+  std::is_same<strand_session::executor_type,
+               asio::strand<asio::ip::tcp::socket::executor_type>>::value,
+  "basic_session should take its executor from its stream");
+
+static_assert(strand_session::is_concurrent,
+              "a session behind a strand has to release its storage safely");
+
 static_assert(
   foxy::detail::is_closable_stream_throw<boost::beast::test::stream>::value,
   "Incorrect implementation of foxy::detail::is_closable_stream_throw");
@@ -119,6 +137,37 @@ TEST_CASE("Our basic_session class...")
     CHECK(valid_body);
   }
 
+  SECTION("should not hold up the handler until the timer's wait is cancelled")
+  {
+    asio::io_context io;
+
+    auto req = http::request<http::empty_body>(http::verb::get, "/", 11);
+
+    auto test_stream = boost::beast::test::stream(io);
+    boost::beast::ostream(test_stream.buffer()) << req;
+
+    auto session = std::make_unique<foxy::basic_session<boost::beast::test::stream>>(
+      std::move(test_stream));
+
+    auto parser = http::request_parser<http::empty_body>();
+
+    auto was_invoked = false;
+
+    // the cancelled wait is still queued when our handler runs, tearing down the session here has
+    // to be safe
+    //
+    session->async_read_header(parser, [&](boost::system::error_code ec, std::size_t) {
+      CHECK(!ec);
+      CHECK(parser.is_header_done());
+
+      was_invoked = true;
+      session.reset();
+    });
+
+    io.run();
+    CHECK(was_invoked);
+  }
+
   SECTION("should be able to write a response")
   {
     asio::io_context io;
@@ -164,4 +213,78 @@ TEST_CASE("Our basic_session class...")
     io.run();
     CHECK(valid_serialization);
   }
+
+  SECTION("should run on its stream's strand over a multi-threaded io_context")
+  {
+    asio::io_context io;
+
+    auto acceptor = asio::ip::tcp::acceptor(
+      io, asio::ip::tcp::endpoint(asio::ip::make_address_v4("127.0.0.1"), 0));
+
+    constexpr int num_pairs    = 16;
+    constexpr int num_messages = 50;
+
+    auto servers = std::vector<std::unique_ptr<strand_session>>();
+    auto clients = std::vector<std::unique_ptr<strand_session>>();
+
+    for (int idx = 0; idx < num_pairs; ++idx) {
+      clients.push_back(std::make_unique<strand_session>(io));
+      servers.push_back(std::make_unique<strand_session>(io));
+
+      clients.back()->stream.plain().next_layer().connect(acceptor.local_endpoint());
+      acceptor.accept(servers.back()->stream.plain().next_layer());
+    }
+
+    // Catch isn't thread-safe so the coroutines only tally up what they saw
+    //
+    auto num_exchanged  = std::atomic<int>{0};
+    auto num_off_strand = std::atomic<int>{0};
+
+    for (int idx = 0; idx < num_pairs; ++idx) {
+      auto& server = *servers[idx];
+      auto& client = *clients[idx];
+
+      asio::spawn(server.get_executor(), [&](asio::yield_context yield) {
+        for (int n = 0; n < num_messages; ++n) {
+          auto parser = http::request_parser<http::string_body>();
+          server.async_read(parser, yield);
+          if (!server.get_executor().running_in_this_thread()) { ++num_off_strand; }
+
+          auto res   = http::response<http::string_body>(http::status::ok, 11);
+          res.body() = parser.get().body();
+          res.prepare_payload();
+
+          auto serializer = http::response_serializer<http::string_body>(res);
+          server.async_write(serializer, yield);
+          if (!server.get_executor().running_in_this_thread()) { ++num_off_strand; }
+        }
+      });
+
+      asio::spawn(client.get_executor(), [&](asio::yield_context yield) {
+        for (int n = 0; n < num_messages; ++n) {
+          auto req   = http::request<http::string_body>(http::verb::post, "/", 11);
+          req.body() = "message #" + std::to_string(n);
+          req.prepare_payload();
+
+          auto serializer = http::request_serializer<http::string_body>(req);
+          client.async_write(serializer, yield);
+
+          auto parser = http::response_parser<http::string_body>();
+          client.async_read(parser, yield);
+          if (!client.get_executor().running_in_this_thread()) { ++num_off_strand; }
+
+          if (parser.get().body() == req.body()) { ++num_exchanged; }
+        }
+      });
+    }
+
+    auto threads = std::vector<std::thread>();
+    for (int idx = 0; idx < 4; ++idx) {
+      threads.emplace_back([&] { io.run(); });
+    }
+    for (auto& thread : threads) { thread.join(); }
+
+    CHECK(num_exchanged == num_pairs * num_messages);
+    CHECK(num_off_strand == 0);
+  }
 }
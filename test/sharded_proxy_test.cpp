@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/sharded_proxy.hpp>
+#include <foxy/client_session.hpp>
+
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <string>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Our sharded forward proxy")
+{
+  SECTION("should serve connections from every shard on the same endpoint")
+  {
+    auto const endpoint = tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0);
+
+    auto proxy = foxy::sharded_proxy(endpoint, 4);
+    REQUIRE(proxy.size() == 4);
+
+    proxy.run();
+
+    asio::io_context io;
+
+    auto num_valid_responses = 0;
+
+    asio::spawn([&](asio::yield_context yield) {
+      auto const port = std::to_string(proxy.local_endpoint().port());
+
+      for (auto idx = 0; idx < 32; ++idx) {
+        auto request =
+          http::request<http::empty_body>(http::verb::get, "lol-some-garbage-target", 11);
+        request.keep_alive(false);
+
+        auto client         = foxy::client_session(io);
+        client.opts.timeout = 30s;
+        client.async_connect("127.0.0.1", port, yield);
+
+        http::response_parser<http::string_body> parser;
+        client.async_request(request, parser, yield);
+
+        auto ec = boost::system::error_code();
+        client.stream.plain().shutdown(tcp::socket::shutdown_send, ec);
+        client.stream.plain().close(ec);
+
+        if (parser.get().result() == http::status::bad_request) { ++num_valid_responses; }
+      }
+    });
+
+    io.run();
+
+    proxy.stop();
+    proxy.join();
+
+    REQUIRE(num_valid_responses == 32);
+  }
+}
@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/timer_wheel.hpp>
+#include <foxy/session.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+using clock_type = std::chrono::steady_clock;
+
+TEST_CASE("Our timer wheel")
+{
+  SECTION("should never fire a timer before its expiry")
+  {
+    asio::io_context io;
+
+    // the deadlines span every level of the wheel, the longest ones have to be cascaded down
+    //
+    auto const delays = std::vector<clock_type::duration>{0ms, 5ms, 30ms, 700ms, 1s};
+
+    auto timers = std::vector<std::unique_ptr<foxy::wheel_timer>>();
+    auto fired  = std::vector<clock_type::time_point>(delays.size());
+
+    for (std::size_t idx = 0; idx < delays.size(); ++idx) {
+      timers.push_back(std::make_unique<foxy::wheel_timer>(io));
+      timers.back()->expires_after(delays[idx]);
+      timers.back()->async_wait([&, idx](boost::system::error_code ec) {
+        CHECK(!ec);
+        fired[idx] = clock_type::now();
+      });
+    }
+
+    CHECK(asio::use_service<foxy::timer_wheel>(io).size() == delays.size());
+    io.run();
+    CHECK(asio::use_service<foxy::timer_wheel>(io).size() == 0);
+
+    for (std::size_t idx = 0; idx < delays.size(); ++idx) {
+      CHECK(fired[idx] >= timers[idx]->expiry());
+      CHECK(fired[idx] - timers[idx]->expiry() < 250ms);
+    }
+  }
+
+  SECTION("should abort waits when the timer is cancelled, rearmed or destroyed")
+  {
+    asio::io_context io;
+
+    auto timer  = std::make_unique<foxy::wheel_timer>(io);
+    auto errors = std::vector<boost::system::error_code>();
+
+    auto const record = [&](boost::system::error_code ec) { errors.push_back(ec); };
+
+    timer->expires_after(10s);
+    timer->async_wait(record);
+    timer->async_wait(record);
+    CHECK(timer->cancel() == 2);
+    CHECK(timer->cancel() == 0);
+
+    timer->async_wait(record);
+    CHECK(timer->expires_after(10s) == 1);
+
+    timer->async_wait(record);
+    timer.reset();
+
+    auto const start = clock_type::now();
+    io.run();
+
+    CHECK(clock_type::now() - start < 1s);
+    CHECK(errors == std::vector<boost::system::error_code>(4, asio::error::operation_aborted));
+  }
+
+  SECTION("should be usable as a session's timer")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+    auto peer     = tcp::socket(io);
+
+    auto opts            = foxy::session_opts();
+    opts.timeout         = 100ms;
+    opts.use_timer_wheel = true;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto session = foxy::session(io, opts);
+
+      peer.async_connect(acceptor.local_endpoint(), yield);
+      acceptor.async_accept(session.stream.plain(), yield);
+
+      // the peer never sends anything so the read runs into the session's timeout
+      //
+      auto const start = clock_type::now();
+
+      auto ec     = boost::system::error_code();
+      auto parser = http::request_parser<http::empty_body>();
+      session.async_read_header(parser, yield[ec]);
+
+      CHECK(ec);
+      CHECK(clock_type::now() - start >= 100ms);
+      CHECK(clock_type::now() - start < 1s);
+      CHECK(asio::use_service<foxy::timer_wheel>(io).size() == 0);
+    });
+
+    io.run();
+  }
+}
@@ -0,0 +1,387 @@
+//
+// Copyright (c) 2018-2019 Christian Mazakas (christian dot mazakas at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/LeonineKing1199/foxy
+//
+
+#include <foxy/upstream_pool.hpp>
+#include <foxy/proxy.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using boost::asio::ip::tcp;
+namespace ip   = boost::asio::ip;
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using namespace std::chrono_literals;
+
+namespace
+{
+// serve accepts connections until the acceptor is closed and answers every request on them with a
+// persistent response carrying `body`
+//
+auto
+serve(asio::io_context&       io,
+      tcp::acceptor&          acceptor,
+      std::list<tcp::socket>& upstreams,
+      std::string const       body) -> void
+{
+  asio::spawn(io, [&io, &acceptor, &upstreams, body](asio::yield_context yield) {
+    while (true) {
+      auto ec = boost::system::error_code();
+      upstreams.emplace_back(io);
+      acceptor.async_accept(upstreams.back(), yield[ec]);
+      if (ec) { break; }
+
+      asio::spawn(yield, [&upstream = upstreams.back(), body](asio::yield_context yield) {
+        auto buffer = boost::beast::flat_buffer();
+        while (true) {
+          auto ec      = boost::system::error_code();
+          auto request = http::request<http::empty_body>();
+          http::async_read(upstream, buffer, request, yield[ec]);
+          if (ec) { break; }
+
+          auto response = http::response<http::string_body>(http::status::ok, 11, body);
+          response.prepare_payload();
+
+          http::async_write(upstream, response, yield[ec]);
+          if (ec) { break; }
+        }
+      });
+    }
+  });
+}
+
+// request sends an absolute-form GET for `target` over `downstream` and returns the response body
+//
+auto
+request(tcp::socket& downstream, std::string const& target, asio::yield_context yield)
+  -> std::string
+{
+  auto request = http::request<http::empty_body>(http::verb::get, target, 11);
+  http::async_write(downstream, request, yield);
+
+  auto buffer   = boost::beast::flat_buffer();
+  auto response = http::response<http::string_body>();
+  http::async_read(downstream, buffer, response, yield);
+
+  CHECK(response.keep_alive());
+  return response.body();
+}
+
+// hang_up half-closes the downstream connection and waits for the proxy to do the same
+//
+auto
+hang_up(tcp::socket& downstream, asio::yield_context yield) -> void
+{
+  auto ec   = boost::system::error_code();
+  auto rest = std::string();
+
+  downstream.shutdown(tcp::socket::shutdown_send, ec);
+  asio::async_read(downstream, asio::dynamic_buffer(rest), yield[ec]);
+  CHECK(ec == asio::error::eof);
+
+  downstream.close(ec);
+}
+
+auto
+target_of(tcp::acceptor const& acceptor) -> std::string
+{
+  return "http://127.0.0.1:" + std::to_string(acceptor.local_endpoint().port()) + "/";
+}
+
+} // namespace
+
+TEST_CASE("Our upstream connection pool")
+{
+  auto const key = foxy::upstream_key{"http", "127.0.0.1", "80"};
+
+  SECTION("should hand out fresh sessions and then reuse the released ones")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+    auto pool     = foxy::upstream_pool(io, {});
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto session = foxy::upstream_pool::session_ptr();
+      pool.async_acquire(key, session, yield);
+
+      REQUIRE(session);
+      CHECK(!session->stream.plain().is_open());
+      CHECK(pool.stats().misses == 1);
+
+      auto peer = tcp::socket(io);
+      session->stream.plain().connect(acceptor.local_endpoint());
+      acceptor.accept(peer);
+
+      auto* const raw = session.get();
+      pool.release(key, std::move(session), true);
+      CHECK(pool.num_idle() == 1);
+
+      pool.async_acquire(key, session, yield);
+      CHECK(session.get() == raw);
+      CHECK(pool.stats().hits == 1);
+      CHECK(pool.num_idle() == 0);
+
+      // a remote that's hung up in the meantime isn't handed out again
+      //
+      pool.release(key, std::move(session), true);
+      peer.close();
+
+      pool.async_acquire(key, session, yield);
+      CHECK(!session->stream.plain().is_open());
+      CHECK(pool.stats().misses == 2);
+
+      pool.release(key, std::move(session), false);
+      CHECK(pool.num_idle() == 0);
+    });
+
+    io.run();
+  }
+
+  SECTION("should make acquirers wait once a host reaches its limit")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto opts         = foxy::upstream_pool_opts();
+    opts.max_per_host = 1;
+
+    auto pool = foxy::upstream_pool(io, {}, opts);
+
+    auto first  = foxy::upstream_pool::session_ptr();
+    auto second = foxy::upstream_pool::session_ptr();
+    auto third  = foxy::upstream_pool::session_ptr();
+
+    auto peer = tcp::socket(io);
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      pool.async_acquire(key, first, yield);
+      first->stream.plain().connect(acceptor.local_endpoint());
+      acceptor.accept(peer);
+
+      // other hosts aren't affected by this one being saturated
+      //
+      pool.async_acquire(foxy::upstream_key{"http", "127.0.0.1", "8080"}, third, yield);
+      REQUIRE(third);
+      pool.release(foxy::upstream_key{"http", "127.0.0.1", "8080"}, std::move(third), false);
+
+      auto timer = asio::steady_timer(io);
+      timer.expires_after(10ms);
+      timer.async_wait(yield);
+
+      CHECK(!second);
+      pool.release(key, std::move(first), true);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      pool.async_acquire(key, second, yield);
+
+      REQUIRE(second);
+      CHECK(second->stream.plain().is_open());
+      CHECK(pool.stats().waits == 1);
+      CHECK(pool.stats().hits == 1);
+      CHECK(pool.stats().wait_time >= 10ms);
+
+      // a connection that's discarded frees up its slot for the next acquirer in line
+      //
+      asio::spawn(io, [&](asio::yield_context yield) {
+        pool.async_acquire(key, third, yield);
+
+        REQUIRE(third);
+        CHECK(!third->stream.plain().is_open());
+        CHECK(pool.stats().waits == 2);
+        CHECK(pool.stats().misses == 3);
+      });
+
+      pool.release(key, std::move(second), false);
+    });
+
+    io.run();
+  }
+
+  SECTION("should fail acquirers that waited longer than the acquire timeout")
+  {
+    asio::io_context io;
+
+    auto opts            = foxy::upstream_pool_opts();
+    opts.max_per_host    = 1;
+    opts.acquire_timeout = 10ms;
+
+    auto pool = foxy::upstream_pool(io, {}, opts);
+
+    auto first  = foxy::upstream_pool::session_ptr();
+    auto second = foxy::upstream_pool::session_ptr();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      pool.async_acquire(key, first, yield);
+      REQUIRE(first);
+
+      auto ec = boost::system::error_code();
+      pool.async_acquire(key, second, yield[ec]);
+
+      CHECK(ec == asio::error::timed_out);
+      CHECK(!second);
+
+      // the timed out acquirer is no longer in line for the connection that's released
+      //
+      pool.release(key, std::move(first), false);
+      CHECK(!second);
+
+      pool.async_acquire(key, second, yield);
+      CHECK(second);
+      CHECK(pool.stats().misses == 2);
+    });
+
+    io.run();
+  }
+
+  SECTION("should only take an alert as a TLS remote going away")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto ctx = asio::ssl::context(asio::ssl::context::method::tlsv12_client);
+
+    auto client_opts    = foxy::session_opts();
+    client_opts.ssl_ctx = ctx;
+
+    // the first byte of a TLS record is its content type, 23 is application data and 21 an alert
+    //
+    auto const is_alive_after = [&](char const content_type) {
+      auto session = foxy::client_session(io, client_opts);
+      auto peer    = tcp::socket(io);
+
+      session.stream.ssl().next_layer().connect(acceptor.local_endpoint());
+      acceptor.accept(peer);
+
+      char const record[] = {content_type, 3, 3, 0, 0};
+      asio::write(peer, asio::buffer(record));
+
+      auto& socket = session.stream.ssl().next_layer();
+      while (socket.available() < sizeof(record)) { std::this_thread::yield(); }
+
+      return foxy::upstream_pool::is_alive(session);
+    };
+
+    CHECK(is_alive_after(23));
+    CHECK(!is_alive_after(21));
+  }
+
+  SECTION("should be used by the proxy to reuse upstreams across downstream clients")
+  {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+    auto proxy    = std::make_shared<foxy::proxy>(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true);
+
+    proxy->async_accept();
+
+    auto upstreams = std::list<tcp::socket>();
+    serve(io, acceptor, upstreams, "pooled");
+
+    auto num_responses = 0;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      for (auto idx = 0; idx < 2; ++idx) {
+        auto downstream = tcp::socket(io);
+        downstream.async_connect(proxy->local_endpoint(), yield);
+
+        if (request(downstream, target_of(acceptor), yield) == "pooled") { ++num_responses; }
+        hang_up(downstream, yield);
+      }
+
+      auto ec = boost::system::error_code();
+      proxy->cancel(ec);
+      acceptor.close(ec);
+      for (auto& upstream : upstreams) { upstream.close(ec); }
+    });
+
+    io.run();
+
+    CHECK(num_responses == 2);
+    CHECK(upstreams.size() == 2);
+    CHECK(proxy->pool().stats().misses == 1);
+    CHECK(proxy->pool().stats().hits == 1);
+  }
+
+  SECTION("should let the proxy keep a client's connection alive across absolute-form requests")
+  {
+    asio::io_context io;
+
+    auto endpoint = tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0);
+
+    auto first  = tcp::acceptor(io, endpoint);
+    auto second = tcp::acceptor(io, endpoint);
+    auto proxy  = std::make_shared<foxy::proxy>(io, endpoint, true);
+
+    proxy->async_accept();
+
+    auto first_upstreams  = std::list<tcp::socket>();
+    auto second_upstreams = std::list<tcp::socket>();
+
+    serve(io, first, first_upstreams, "first");
+    serve(io, second, second_upstreams, "second");
+
+    auto bodies = std::vector<std::string>();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto downstream = tcp::socket(io);
+      downstream.async_connect(proxy->local_endpoint(), yield);
+
+      bodies.push_back(request(downstream, target_of(first), yield));
+      bodies.push_back(request(downstream, target_of(first), yield));
+      bodies.push_back(request(downstream, target_of(second), yield));
+      CHECK(proxy->pool().num_idle() == 1);
+
+      bodies.push_back(request(downstream, target_of(first), yield));
+      hang_up(downstream, yield);
+
+      CHECK(proxy->pool().num_idle() == 2);
+
+      auto ec = boost::system::error_code();
+      proxy->cancel(ec);
+      first.close(ec);
+      second.close(ec);
+      for (auto& upstream : first_upstreams) { upstream.close(ec); }
+      for (auto& upstream : second_upstreams) { upstream.close(ec); }
+    });
+
+    io.run();
+
+    CHECK(bodies == std::vector<std::string>{"first", "first", "second", "first"});
+
+    // one connection per upstream, the last request picked the first one back up from the pool
+    //
+    CHECK(first_upstreams.size() == 2);
+    CHECK(second_upstreams.size() == 2);
+    CHECK(proxy->pool().stats().misses == 2);
+    CHECK(proxy->pool().stats().hits == 1);
+  }
+}